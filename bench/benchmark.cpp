@@ -0,0 +1,657 @@
+// Benchmark suite: construction, forward (dense, quantized and sparse),
+// backward, training and CSV loading across a matrix of layer widths,
+// depths and batch sizes. Results go to stdout as JSON; progress goes to
+// stderr.
+//
+//   make bench                      full matrix
+//   ./build/benchmark --quick       smaller matrix for a fast check
+//   ./build/benchmark --output f    write the JSON to f
+//   ./build/benchmark --verify      check every SIMD backend this CPU runs
+//                                   (or just NN_KERNELS) against scalar
+
+#include "neural_network.hpp"
+#include "static_network.hpp"
+#include "quantized_network.hpp"
+#include "sparse_network.hpp"
+#include "kernels.hpp"
+#include "csv_reader.hpp"
+#include "half_float.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace neural_network;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    // Each measurement repeats until it has run at least this long.
+    const double minimumSeconds = 0.2;
+
+    struct Shape
+    {
+        int width;
+        int depth;
+        int batchSize;
+    };
+
+    struct Result
+    {
+        string name;
+        Shape shape;
+        double samplesPerSecond;
+        double gflops;
+        // Per-call latency percentiles; empty for derived results.
+        vector<double> latencyNs;
+        bool derived;
+    };
+
+    double seconds(Clock::duration duration)
+    {
+        return chrono::duration<double>(duration).count();
+    }
+
+    double percentile(vector<double> &values, double fraction)
+    {
+        if (values.empty())
+            return 0.0;
+        size_t index = min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    vector<double> latencyPercentiles(vector<double> latencies)
+    {
+        return {percentile(latencies, 0.50), percentile(latencies, 0.90), percentile(latencies, 0.99)};
+    }
+
+    // Multiply-adds in one forward pass, counted as two flops each.
+    double forwardFlops(const NeuralNetwork &network)
+    {
+        vector<size_t> sizes = network.getLayerSizes();
+        double flops = 0.0;
+        for (size_t l = 0; l + 1 < sizes.size(); ++l)
+            flops += 2.0 * sizes[l] * sizes[l + 1];
+        return flops;
+    }
+
+    datasets::Dataset randomDataset(size_t rows, size_t features, mt19937 &generator)
+    {
+        uniform_real_distribution<float> value(0.0f, 1.0f);
+        datasets::Dataset dataset(features, 1);
+        dataset.reserve(rows);
+
+        vector<float> row(features);
+        for (size_t r = 0; r < rows; ++r)
+        {
+            for (auto &x : row)
+                x = value(generator);
+            float target = value(generator);
+            dataset.addRow(row.data(), &target);
+        }
+        return dataset;
+    }
+
+    Result benchmarkForward(NeuralNetwork &network, const datasets::Dataset &data, const Shape &shape)
+    {
+        InferenceContext context = network.createInferenceContext();
+        const size_t rows = data.size();
+        vector<float> output(network.getOutputSize());
+        vector<double> latencies;
+
+        // Throughput runs untimed per call; latencies come from a second pass
+        // so timer overhead doesn't skew samples/s.
+        size_t samples = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            for (size_t i = 0; i < rows; ++i)
+                network.forward(context, data.featuresAt(i), output.data());
+            samples += rows;
+        } while (seconds(Clock::now() - start) < minimumSeconds);
+        double elapsed = seconds(Clock::now() - start);
+
+        for (size_t i = 0; i < rows; ++i)
+        {
+            Clock::time_point before = Clock::now();
+            network.forward(context, data.featuresAt(i), output.data());
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+        }
+
+        double rate = samples / elapsed;
+        return {"forward", shape, rate, rate * forwardFlops(network) / 1e9, latencyPercentiles(latencies), false};
+    }
+
+    // The production 3-4-4-1 topology through the compile-time network.
+    Result benchmarkStaticForward(const NeuralNetwork &network, const datasets::Dataset &data, const Shape &shape)
+    {
+        const StaticNetwork<3, 4, 4, 1> fixed(network);
+        const size_t rows = data.size();
+        float output = 0.0f;
+        float checksum = 0.0f;
+        vector<double> latencies;
+
+        size_t samples = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                fixed.forward(data.featuresAt(i), &output);
+                checksum += output;
+            }
+            samples += rows;
+        } while (seconds(Clock::now() - start) < minimumSeconds);
+        double elapsed = seconds(Clock::now() - start);
+
+        for (size_t i = 0; i < rows; ++i)
+        {
+            Clock::time_point before = Clock::now();
+            fixed.forward(data.featuresAt(i), &output);
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+        }
+
+        // Keeps the loop from being optimized away.
+        if (checksum == -1.0f)
+            fprintf(stderr, "checksum %f\n", checksum);
+
+        double rate = samples / elapsed;
+        return {"static_forward", shape, rate, rate * forwardFlops(network) / 1e9, latencyPercentiles(latencies), false};
+    }
+
+    // Throughput and latency of forwardBatch(inputs, count, outputs) over
+    // the dataset in batches of shape.batchSize. Like benchmarkForward(),
+    // the throughput loop runs untimed per call and latencies come from a
+    // second pass. GFLOPS count the dense work of network, so every
+    // representation compares directly with forward_batch.
+    template <typename ForwardBatch>
+    Result timeBatches(const string &name, const Shape &shape, const NeuralNetwork &network,
+                       const datasets::Dataset &data, ForwardBatch forwardBatch)
+    {
+        const size_t batch = shape.batchSize;
+        const size_t batchCount = data.size() / batch;
+        const size_t inputSize = network.getInputSize();
+        const float *inputs = data.featureMatrix().data;
+        vector<float> outputs(batch * network.getOutputSize());
+        vector<double> latencies;
+
+        size_t samples = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            for (size_t b = 0; b < batchCount; ++b)
+                forwardBatch(inputs + b * batch * inputSize, batch, outputs.data());
+            samples += batchCount * batch;
+        } while (seconds(Clock::now() - start) < minimumSeconds);
+        double elapsed = seconds(Clock::now() - start);
+
+        for (size_t b = 0; b < batchCount; ++b)
+        {
+            Clock::time_point before = Clock::now();
+            forwardBatch(inputs + b * batch * inputSize, batch, outputs.data());
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+        }
+
+        double rate = samples / elapsed;
+        return {name, shape, rate, rate * forwardFlops(network) / 1e9, latencyPercentiles(latencies), false};
+    }
+
+    // Networks built (and initialized) per second.
+    Result benchmarkConstruct(int inputSize, int outputSize, const Shape &shape)
+    {
+        vector<double> latencies;
+        size_t networks = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            Clock::time_point before = Clock::now();
+            NeuralNetwork network(inputSize, outputSize, shape.depth, shape.width);
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+            ++networks;
+        } while (seconds(Clock::now() - start) < minimumSeconds);
+
+        return {"construct", shape, networks / seconds(Clock::now() - start), 0.0, latencyPercentiles(latencies),
+                false};
+    }
+
+    // Epochs of trainEpoch() over data; gflops are counted against the
+    // dense network, like timeBatches().
+    template <typename TrainEpoch>
+    Result timeEpochs(const string &name, const Shape &shape, const NeuralNetwork &network,
+                      const datasets::Dataset &data, TrainEpoch trainEpoch)
+    {
+        vector<double> latencies;
+        size_t samples = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            Clock::time_point before = Clock::now();
+            trainEpoch();
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+            samples += data.size();
+        } while (seconds(Clock::now() - start) < minimumSeconds);
+
+        double elapsed = seconds(Clock::now() - start);
+        double rate = samples / elapsed;
+        // Forward, delta propagation and gradient accumulation each cost
+        // about one forward pass.
+        return {name, shape, rate, rate * 3.0 * forwardFlops(network) / 1e9, latencyPercentiles(latencies), false};
+    }
+
+    // backpropagate() is private; its cost is what train() spends beyond the
+    // forward pass of each sample.
+    Result deriveBackward(const Result &forward, const Result &train, const NeuralNetwork &network)
+    {
+        double secondsPerSample = max(0.0, 1.0 / train.samplesPerSecond - 1.0 / forward.samplesPerSecond);
+        double rate = secondsPerSample > 0.0 ? 1.0 / secondsPerSample : 0.0;
+        return {"backward", train.shape, rate, rate * 2.0 * forwardFlops(network) / 1e9, {}, true};
+    }
+
+    vector<Result> benchmarkCsv(size_t rows, const string &path, mt19937 &generator)
+    {
+        uniform_real_distribution<float> value(0.0f, 1.0f);
+        {
+            ofstream file(path);
+            file << "age_norm,weight_norm,height_norm,cvd_prob\n";
+            char line[128];
+            for (size_t r = 0; r < rows; ++r)
+            {
+                int length = snprintf(line, sizeof(line), "%.6f,%.6f,%.6f,%.6f\n",
+                                      value(generator), value(generator), value(generator), value(generator));
+                file.write(line, length);
+            }
+        }
+
+        vector<Result> results;
+        for (size_t threads : {size_t(1), size_t(0)})
+        {
+            io::CsvOptions options;
+            options.threadCount = threads;
+
+            vector<double> latencies;
+            size_t loaded = 0;
+            Clock::time_point start = Clock::now();
+            do
+            {
+                Clock::time_point before = Clock::now();
+                io::CsvTable table = io::readCsv(path, options);
+                latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+                loaded += table.rowCount;
+            } while (seconds(Clock::now() - start) < minimumSeconds);
+
+            double rate = loaded / seconds(Clock::now() - start);
+            results.push_back({threads == 1 ? "csv_load" : "csv_load_parallel", {0, 0, 0}, rate, 0.0,
+                               latencyPercentiles(latencies), false});
+        }
+
+        remove(path.c_str());
+        return results;
+    }
+
+    // Parity of one backend against the scalar reference. Sizes cover
+    // full vectors, every tail width and rows that don't fill a block.
+    class KernelCheck
+    {
+    private:
+        const kernels::KernelTable &reference = *kernels::scalarKernels();
+        const kernels::KernelTable &candidate;
+        mt19937 generator{7};
+        size_t failures = 0;
+
+    public:
+        explicit KernelCheck(const kernels::KernelTable &candidate) : candidate(candidate) {}
+
+        size_t getFailures() const { return failures; }
+
+        vector<float> random(size_t n, float scale = 1.0f)
+        {
+            uniform_real_distribution<float> value(-scale, scale);
+            vector<float> values(n);
+            for (auto &x : values)
+                x = value(generator);
+            return values;
+        }
+
+        // Sums run in a different order and the SIMD exp/tanh are
+        // polynomial, so results agree to a few ulp rather than exactly.
+        void compare(const string &what, const float *expected, const float *actual, size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!(fabs(expected[i] - actual[i]) <= 1e-5f + 1e-4f * fabs(expected[i])))
+                {
+                    fprintf(stderr, "  %s: %s[%zu] = %g, scalar %g\n", candidate.name, what.c_str(), i, actual[i],
+                            expected[i]);
+                    ++failures;
+                    return;
+                }
+            }
+        }
+
+        void checkVectorKernels()
+        {
+            for (size_t n = 1; n <= 70; ++n)
+            {
+                const vector<float> x = random(n);
+                const vector<float> y = random(n);
+                const string size = "(n = " + to_string(n) + ")";
+
+                vector<float> expected = y, actual = y;
+                reference.axpy(0.75f, x.data(), expected.data(), n);
+                candidate.axpy(0.75f, x.data(), actual.data(), n);
+                compare("axpy" + size, expected.data(), actual.data(), n);
+
+                vector<float> expectedGradients = y, actualGradients = y;
+                const vector<float> weights = random(n);
+                float expectedSum = reference.dotAccumulate(weights.data(), x.data(), 0.5f, expectedGradients.data(), n);
+                float actualSum = candidate.dotAccumulate(weights.data(), x.data(), 0.5f, actualGradients.data(), n);
+                compare("dotAccumulate" + size, &expectedSum, &actualSum, 1);
+                compare("dotAccumulate gradients" + size, expectedGradients.data(), actualGradients.data(), n);
+
+                expected = y, actual = y;
+                reference.multiply(x.data(), expected.data(), n);
+                candidate.multiply(x.data(), actual.data(), n);
+                compare("multiply" + size, expected.data(), actual.data(), n);
+            }
+        }
+
+        void checkDenseKernels()
+        {
+            for (size_t rows : {1, 3, 4, 5, 9})
+            {
+                for (size_t sourceCount : {1, 3, 8, 19})
+                {
+                    for (size_t targetCount : {1, 2, 4, 7, 8, 9, 16, 17, 33})
+                        checkDense(rows, sourceCount, targetCount);
+                }
+            }
+        }
+
+        void checkDense(size_t rows, size_t sourceCount, size_t targetCount)
+        {
+            const vector<float> sources = random(rows * sourceCount, 2.0f);
+            const vector<float> weights = random(sourceCount * targetCount);
+            const vector<float> biases = random(targetCount);
+            const size_t n = rows * targetCount;
+            const string shape = " " + to_string(rows) + "x" + to_string(sourceCount) + "x" + to_string(targetCount);
+
+            for (size_t a = 0; a < kernels::activationCount; ++a)
+            {
+                const kernels::Activation activation = static_cast<kernels::Activation>(a);
+                if (activation == kernels::Activation::Softmax && targetCount < 2)
+                    continue;
+                const bool derivatives = kernels::isElementwise(activation);
+                const string what = string("denseBatch ") + kernels::activationName(activation) + shape;
+
+                vector<float> expected(n), actual(n), expectedDerivatives(n), actualDerivatives(n);
+                reference.denseBatch(sources.data(), rows, sourceCount, weights.data(), biases.data(), targetCount,
+                                     activation, expected.data(), derivatives ? expectedDerivatives.data() : nullptr);
+                candidate.denseBatch(sources.data(), rows, sourceCount, weights.data(), biases.data(), targetCount,
+                                     activation, actual.data(), derivatives ? actualDerivatives.data() : nullptr);
+                compare(what, expected.data(), actual.data(), n);
+                if (derivatives)
+                    compare(what + " derivatives", expectedDerivatives.data(), actualDerivatives.data(), n);
+            }
+
+            // Weight buffers end in the padding the reduced kernels may read.
+            const size_t weightCount = sourceCount * targetCount;
+            vector<int8_t> int8Weights(weightCount + kernels::reducedPadding, 0);
+            vector<uint16_t> halfWeights(weightCount + kernels::reducedPadding, 0);
+            vector<uint16_t> bfloatWeights(weightCount + kernels::reducedPadding, 0);
+            uniform_int_distribution<int> quantized(-128, 127);
+            for (size_t i = 0; i < weightCount; ++i)
+            {
+                int8Weights[i] = static_cast<int8_t>(quantized(generator));
+                halfWeights[i] = numeric::floatToHalf(weights[i]);
+                bfloatWeights[i] = numeric::floatToBFloat16(weights[i]);
+            }
+            const kernels::ReducedWeights formats[] = {
+                {int8Weights.data(), kernels::WeightFormat::Int8, 0.01f, 3},
+                {halfWeights.data(), kernels::WeightFormat::Float16, 1.0f, 0},
+                {bfloatWeights.data(), kernels::WeightFormat::BFloat16, 1.0f, 0}};
+
+            for (const kernels::ReducedWeights &reduced : formats)
+            {
+                for (kernels::Activation activation : {kernels::Activation::LeakyRelu, kernels::Activation::Sigmoid})
+                {
+                    vector<float> expected(n), actual(n);
+                    reference.denseReduced(sources.data(), rows, sourceCount, reduced, biases.data(), targetCount,
+                                           activation, expected.data());
+                    candidate.denseReduced(sources.data(), rows, sourceCount, reduced, biases.data(), targetCount,
+                                           activation, actual.data());
+                    compare(string("denseReduced ") + precisionName(reduced.format) + " " +
+                                kernels::activationName(activation) + shape,
+                            expected.data(), actual.data(), n);
+                }
+            }
+        }
+
+        void checkSparseKernels()
+        {
+            for (size_t sourceCount : {1, 5, 19})
+            {
+                for (size_t targetCount : {1, 2, 7, 33})
+                {
+                    for (float density : {0.3f, 1.0f})
+                        checkSparse(sourceCount, targetCount, density);
+                }
+            }
+        }
+
+        void checkSparse(size_t sourceCount, size_t targetCount, float density)
+        {
+            const size_t lanes = kernels::sparseLanes;
+            vector<uint32_t> rowOffsets = {0}, columns;
+            bernoulli_distribution keep(density);
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    if (keep(generator))
+                        columns.push_back(j);
+                }
+                rowOffsets.push_back(columns.size());
+            }
+            const vector<float> values = random(columns.size());
+            const kernels::SparseWeights weights = {rowOffsets.data(), columns.data(), values.data()};
+
+            // Source 0 is zero in every lane so the skip is exercised.
+            vector<float> sources = random(sourceCount * lanes, 2.0f);
+            fill(sources.begin(), sources.begin() + lanes, 0.0f);
+            const vector<float> biases = random(targetCount);
+            const size_t n = targetCount * lanes;
+            const string shape = " " + to_string(sourceCount) + "x" + to_string(targetCount) + " (" +
+                                 to_string(columns.size()) + " edges)";
+
+            for (size_t a = 0; a < kernels::activationCount; ++a)
+            {
+                const kernels::Activation activation = static_cast<kernels::Activation>(a);
+                if (activation == kernels::Activation::Softmax && targetCount < 2)
+                    continue;
+                const bool derivatives = kernels::isElementwise(activation);
+                const string what = string("sparseForward ") + kernels::activationName(activation) + shape;
+
+                vector<float> expected(n), actual(n), expectedDerivatives(n), actualDerivatives(n);
+                reference.sparseForward(sources.data(), sourceCount, weights, biases.data(), targetCount, activation,
+                                        expected.data(), derivatives ? expectedDerivatives.data() : nullptr);
+                candidate.sparseForward(sources.data(), sourceCount, weights, biases.data(), targetCount, activation,
+                                        actual.data(), derivatives ? actualDerivatives.data() : nullptr);
+                compare(what, expected.data(), actual.data(), n);
+                if (derivatives)
+                    compare(what + " derivatives", expectedDerivatives.data(), actualDerivatives.data(), n);
+            }
+
+            const vector<float> targetDeltas = random(n);
+            const vector<float> gradients = random(columns.size());
+            vector<float> expectedGradients = gradients, actualGradients = gradients;
+            vector<float> expectedDeltas(sourceCount * lanes), actualDeltas(sourceCount * lanes);
+            reference.sparseBackward(sources.data(), targetDeltas.data(), sourceCount, weights,
+                                     expectedGradients.data(), expectedDeltas.data());
+            candidate.sparseBackward(sources.data(), targetDeltas.data(), sourceCount, weights,
+                                     actualGradients.data(), actualDeltas.data());
+            compare("sparseBackward gradients" + shape, expectedGradients.data(), actualGradients.data(),
+                    columns.size());
+            compare("sparseBackward deltas" + shape, expectedDeltas.data(), actualDeltas.data(), sourceCount * lanes);
+        }
+    };
+
+    // Returns the number of backends that disagree with scalar.
+    int verifyKernels()
+    {
+        vector<kernels::Backend> backends;
+        const char *requested = getenv("NN_KERNELS");
+        for (kernels::Backend backend : {kernels::Backend::Avx2, kernels::Backend::Avx512, kernels::Backend::Neon})
+        {
+            if (kernels::isSupported(backend) && (!requested || strcmp(requested, kernels::backendName(backend)) == 0))
+                backends.push_back(backend);
+        }
+        if (backends.empty())
+            fprintf(stderr, "No SIMD backend to verify on this CPU\n");
+
+        int failed = 0;
+        for (kernels::Backend backend : backends)
+        {
+            kernels::setBackend(backend);
+            KernelCheck check(kernels::active());
+            check.checkVectorKernels();
+            check.checkDenseKernels();
+            check.checkSparseKernels();
+            fprintf(stderr, "%s: %s\n", kernels::backendName(backend),
+                    check.getFailures() ? (to_string(check.getFailures()) + " mismatches").c_str() : "matches scalar");
+            failed += check.getFailures() != 0;
+        }
+        return failed;
+    }
+
+    void writeJson(FILE *out, const vector<Result> &results)
+    {
+        fprintf(out, "{\n  \"kernels\": \"%s\",\n  \"results\": [\n", kernels::active().name);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            fprintf(out, "    {\"benchmark\": \"%s\", \"width\": %d, \"depth\": %d, \"batch\": %d, "
+                         "\"samples_per_second\": %.1f, \"gflops\": %.4f",
+                    r.name.c_str(), r.shape.width, r.shape.depth, r.shape.batchSize, r.samplesPerSecond, r.gflops);
+            if (r.derived)
+                fprintf(out, ", \"derived\": true");
+            if (!r.latencyNs.empty())
+                fprintf(out, ", \"latency_ns\": {\"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f}",
+                        r.latencyNs[0], r.latencyNs[1], r.latencyNs[2]);
+            fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool quick = false;
+    bool verify = false;
+    string outputPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option == "--quick")
+            quick = true;
+        else if (option == "--verify")
+            verify = true;
+        else if (option == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--quick] [--output file] | --verify\n", argv[0]);
+            return 1;
+        }
+    }
+    if (verify)
+        return verifyKernels() ? 1 : 0;
+
+    const vector<int> widths = quick ? vector<int>{4, 64} : vector<int>{4, 16, 64, 256};
+    const vector<int> depths = quick ? vector<int>{2} : vector<int>{1, 2, 4};
+    const vector<int> batchSizes = quick ? vector<int>{32} : vector<int>{1, 32, 256};
+    const size_t rows = quick ? 2048 : 8192;
+    const int inputSize = 3;
+    const int outputSize = 1;
+
+    mt19937 generator(42);
+    datasets::Dataset data = randomDataset(rows, inputSize, generator);
+    vector<Result> results;
+
+    for (int width : widths)
+    {
+        for (int depth : depths)
+        {
+            fprintf(stderr, "width %d, depth %d\n", width, depth);
+            results.push_back(benchmarkConstruct(inputSize, outputSize, {width, depth, 0}));
+            NeuralNetwork network(inputSize, outputSize, depth, width);
+
+            Result forward = benchmarkForward(network, data, {width, depth, 1});
+            results.push_back(forward);
+            if (width == 4 && depth == 2)
+                results.push_back(benchmarkStaticForward(network, data, {width, depth, 1}));
+
+            for (int batchSize : batchSizes)
+            {
+                Shape shape = {width, depth, batchSize};
+                InferenceContext context = network.createInferenceContext();
+                results.push_back(timeBatches("forward_batch", shape, network, data,
+                                              [&](const float *inputs, size_t count, float *outputs)
+                                              { network.forwardBatch(context, inputs, count, outputs); }));
+                for (Precision precision : {Precision::Int8, Precision::Float16, Precision::BFloat16})
+                {
+                    const QuantizedNetwork quantized(network, precision);
+                    results.push_back(timeBatches(string("forward_batch_") + precisionName(precision), shape,
+                                                  network, data,
+                                                  [&](const float *inputs, size_t count, float *outputs)
+                                                  { quantized.forwardBatch(inputs, count, outputs); }));
+                }
+                // CSR inference after pruning that share of every weight matrix.
+                for (float sparsity : {0.5f, 0.7f, 0.9f})
+                {
+                    const SparseNetwork sparse(network, sparsity);
+                    results.push_back(timeBatches("forward_batch_sparse" + to_string(lround(sparsity * 100)), shape,
+                                                  network, data,
+                                                  [&](const float *inputs, size_t count, float *outputs)
+                                                  { sparse.forwardBatch(inputs, count, outputs); }));
+                }
+
+                Result train = timeEpochs("train_epoch", shape, network, data, [&]
+                                          { network.train(data, shape.batchSize, 0.001f); });
+                results.push_back(train);
+                SparseNetwork sparse(network, 0.9f);
+                results.push_back(timeEpochs("train_epoch_sparse90", shape, network, data, [&]
+                                             { sparse.train(data, shape.batchSize, 0.001f); }));
+                results.push_back(deriveBackward(forward, train, network));
+            }
+        }
+    }
+
+    fprintf(stderr, "csv loading\n");
+    for (const Result &r : benchmarkCsv(quick ? 100000 : 1000000, "build/benchmark_data.csv", generator))
+        results.push_back(r);
+
+    FILE *out = stdout;
+    if (!outputPath.empty())
+    {
+        out = fopen(outputPath.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "Could not open %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+    writeJson(out, results);
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "node.hpp"
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+namespace kernels
+{
+    // Activation applied by denseBatch before each target is stored. Values
+    // are stored in model files, so new entries only go at the end.
+    enum class Activation
+    {
+        Identity,
+        // Slope 0.01 below zero; the hidden-layer default.
+        LeakyRelu,
+        Relu,
+        Tanh,
+        // tanh approximation: x * sigmoid(2 sqrt(2/pi) (x + 0.044715 x^3)).
+        Gelu,
+        Sigmoid,
+        // Row-wise over a layer's targets; output layers only, trained
+        // against one-hot targets with cross-entropy.
+        Softmax
+    };
+
+    constexpr size_t activationCount = 7;
+
+    // Lower-case name, e.g. "leaky_relu"; "unknown" for out-of-range values.
+    const char *activationName(Activation activation);
+    // Inverse of activationName(); false for an unknown name.
+    bool parseActivation(const char *name, Activation &activation);
+
+    // Softmax has no elementwise form: its per-element step is the
+    // identity and the kernels normalize each row afterwards.
+    constexpr bool isElementwise(Activation activation) { return activation != Activation::Softmax; }
+
+    template <Activation A>
+    using ActivationTag = std::integral_constant<Activation, A>;
+
+    // Resolves a runtime activation once and calls f(ActivationTag<A>()),
+    // so f can instantiate a kernel per activation and its inner loops
+    // carry no per-element switch. An out-of-range value runs Identity.
+    template <typename F>
+    inline decltype(auto) withActivation(Activation activation, F &&f)
+    {
+        switch (activation)
+        {
+        case Activation::LeakyRelu:
+            return f(ActivationTag<Activation::LeakyRelu>());
+        case Activation::Relu:
+            return f(ActivationTag<Activation::Relu>());
+        case Activation::Tanh:
+            return f(ActivationTag<Activation::Tanh>());
+        case Activation::Gelu:
+            return f(ActivationTag<Activation::Gelu>());
+        case Activation::Sigmoid:
+            return f(ActivationTag<Activation::Sigmoid>());
+        case Activation::Softmax:
+            return f(ActivationTag<Activation::Softmax>());
+        default:
+            return f(ActivationTag<Activation::Identity>());
+        }
+    }
+
+    // GELU's inner argument is x * (geluLinear + geluCubic * x^2).
+    constexpr float geluLinear = 1.5957691216f; // 2 sqrt(2/pi)
+    constexpr float geluCubic = 0.0713548163f;  // 2 sqrt(2/pi) * 0.044715
+
+    // Scalar reference for one element: returns activation(x) and writes
+    // activation'(x) into derivative. The SIMD backends are checked
+    // against it.
+    template <Activation A>
+    inline float activate(float x, float &derivative)
+    {
+        if constexpr (A == Activation::LeakyRelu)
+        {
+            derivative = nodes::reluDerivative(x);
+            return nodes::relu(x);
+        }
+        else if constexpr (A == Activation::Relu)
+        {
+            derivative = x > 0.0f ? 1.0f : 0.0f;
+            return x > 0.0f ? x : 0.0f;
+        }
+        else if constexpr (A == Activation::Tanh)
+        {
+            float t = std::tanh(x);
+            derivative = 1.0f - t * t;
+            return t;
+        }
+        else if constexpr (A == Activation::Gelu)
+        {
+            const float x2 = x * x;
+            float s = nodes::sigmoid(x * (geluLinear + geluCubic * x2));
+            derivative = s + x * s * (1.0f - s) * (geluLinear + 3.0f * geluCubic * x2);
+            return x * s;
+        }
+        else if constexpr (A == Activation::Sigmoid)
+        {
+            float s = nodes::sigmoid(x);
+            derivative = nodes::sigmoidDerivative(s);
+            return s;
+        }
+        else
+        {
+            derivative = 1.0f;
+            return x;
+        }
+    }
+}
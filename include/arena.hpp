@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+namespace memory
+{
+    // Bump allocator handing out zeroed, cache-line aligned float ranges
+    // from a few large blocks. Nothing is freed individually: everything
+    // carved from an arena lives until the arena is destroyed.
+    class Arena
+    {
+    private:
+        struct Block
+        {
+            float *data;
+            size_t capacity;
+            size_t used;
+        };
+
+        vector<Block> blocks;
+        size_t blockSize;
+
+        void addBlock(size_t floatCount);
+
+    public:
+        static const size_t alignment = 64;
+
+        // Floats needed for count values once padded to a cache line.
+        static size_t paddedSize(size_t count);
+
+        // The first block holds `initialSize` floats; later blocks are at
+        // least that large. Size it to the known total to get one block.
+        explicit Arena(size_t initialSize = 1 << 16);
+        ~Arena();
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        float *allocate(size_t count);
+
+        size_t getBlockCount() const { return blocks.size(); }
+        // Floats reserved across all blocks, and how many are handed out.
+        size_t getCapacity() const;
+        size_t getUsed() const;
+    };
+
+    // Non-owning view of floats, typically carved from an Arena.
+    struct FloatSpan
+    {
+        float *values = nullptr;
+        size_t count = 0;
+
+        FloatSpan() = default;
+        FloatSpan(float *values, size_t count) : values(values), count(count) {}
+
+        float *data() { return values; }
+        const float *data() const { return values; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        float &operator[](size_t i) { return values[i]; }
+        const float &operator[](size_t i) const { return values[i]; }
+
+        float *begin() { return values; }
+        float *end() { return values + count; }
+        const float *begin() const { return values; }
+        const float *end() const { return values + count; }
+    };
+}
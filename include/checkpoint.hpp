@@ -0,0 +1,137 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace checkpointing
+{
+    // Everything needed to resume training where a run left off.
+    struct TrainingState
+    {
+        // Filled by NeuralNetwork::captureTrainingState().
+        vector<size_t> layerSizes;
+        // NeuralNetwork::getParameters() layout.
+        vector<float> parameters;
+        string optimizerName;
+        long optimizerSteps = 0;
+        // Optimizer::saveState() layout; empty before the first step.
+        vector<float> optimizerState;
+        // The network's epoch counter. States are taken between epochs,
+        // so a resumed run starts the next epoch from its first sample.
+        int epoch = 0;
+
+        // Trainer bookkeeping, so early stopping and restoreBest carry on.
+        int nextEpoch = 0;
+        int bestEpoch = -1;
+        float bestLoss = 0.0f;
+        int staleEvaluations = 0;
+        vector<float> bestParameters;
+    };
+
+    // Binary checkpoint, native little-endian like the model format:
+    //
+    //   CheckpointHeader
+    //   uint32_t layerSizes[layerCount]
+    //   char optimizerName[nameLength]
+    //   float parameters[parameterCount]
+    //   float optimizerState[optimizerStateCount]
+    //   float bestParameters[bestParameterCount]
+    //
+    // Written to a temporary file and renamed, so a crash mid-write leaves
+    // the previous checkpoint intact.
+    const char checkpointMagic[8] = {'N', 'N', 'C', 'K', 'P', 'T', '\0', '\0'};
+    const uint32_t checkpointVersion = 2;
+
+    struct CheckpointHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t endianTag;
+        uint32_t layerCount;
+        uint32_t nameLength;
+        int64_t optimizerSteps;
+        int32_t epoch;
+        int32_t nextEpoch;
+        int32_t bestEpoch;
+        int32_t staleEvaluations;
+        float bestLoss;
+        uint32_t reserved;
+        uint64_t parameterCount;
+        uint64_t optimizerStateCount;
+        uint64_t bestParameterCount;
+    };
+
+    // Synced to disk before it replaces the previous file (io::commitFile).
+    void writeCheckpoint(const string &path, const TrainingState &state);
+    // Throws runtime_error for a missing, truncated or foreign file.
+    TrainingState readCheckpoint(const string &path);
+    bool checkpointExists(const string &path);
+
+    // Writes snapshots on a background thread so training only pays for
+    // the in-memory copy. A snapshot still waiting when a newer one
+    // arrives is dropped in its favour; the one being written always
+    // completes. Instantiated for the two writers below.
+    template <typename Snapshot>
+    class SnapshotWriter
+    {
+    public:
+        using WriteFunction = void (*)(const string &path, const Snapshot &snapshot);
+
+    private:
+        string path;
+        WriteFunction write;
+        mutex lock;
+        condition_variable wake;
+        condition_variable idle;
+        Snapshot pending;
+        bool hasPending = false;
+        bool writing = false;
+        bool stopping = false;
+        exception_ptr failure;
+        size_t writtenCount = 0;
+        thread worker;
+
+        void run();
+        void rethrowFailure();
+
+    public:
+        SnapshotWriter(const string &path, WriteFunction write);
+        // Finishes the pending snapshot before returning.
+        ~SnapshotWriter();
+
+        SnapshotWriter(const SnapshotWriter &) = delete;
+        SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+        // Takes snapshot by swapping it with an idle buffer, which the
+        // caller gets back to fill next time, so steady-state snapshots
+        // don't allocate. Rethrows an earlier write failure.
+        void submit(Snapshot &snapshot);
+        // Waits until every submitted snapshot is on disk (or dropped);
+        // rethrows a write failure.
+        void flush();
+        size_t getWrittenCount();
+        const string &getPath() const { return path; }
+    };
+
+    // Training state files, through writeCheckpoint().
+    class CheckpointWriter : public SnapshotWriter<TrainingState>
+    {
+    public:
+        explicit CheckpointWriter(const string &path);
+    };
+
+    // Model files from NeuralNetwork::saveImage(), through
+    // model_io::writeModelFile().
+    class ModelWriter : public SnapshotWriter<vector<unsigned char>>
+    {
+    public:
+        explicit ModelWriter(const string &path);
+    };
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+using namespace std;
+
+namespace io
+{
+    struct CsvOptions
+    {
+        // Trailing columns stored as targets; the rest are features.
+        size_t targetColumns = 1;
+        bool skipHeader = true;
+        // Parser threads; 0 uses every hardware thread. Small files are
+        // always parsed on the calling thread.
+        size_t threadCount = 1;
+    };
+
+    // Numeric table split into contiguous row-major feature and target
+    // buffers.
+    struct CsvTable
+    {
+        size_t featureCount = 0;
+        size_t targetCount = 0;
+        size_t rowCount = 0;
+        // Rows dropped for a wrong column count or an unparsable cell.
+        size_t skippedRows = 0;
+        vector<float> features;
+        vector<float> targets;
+
+        const float *featureRow(size_t row) const { return features.data() + row * featureCount; }
+        const float *targetRow(size_t row) const { return targets.data() + row * targetCount; }
+    };
+
+    // Memory-maps the file and parses it with a locale-independent float
+    // parser. The column count comes from the header (or the first row);
+    // rows with a different count are skipped. Throws runtime_error if the
+    // file can't be read.
+    CsvTable readCsv(const string &path, const CsvOptions &options = CsvOptions());
+
+    // Row-at-a-time reader with readCsv()'s parsing rules, for files too
+    // large to hold parsed. Text already consumed is released from memory
+    // as the reader moves on, so memory use stays bounded. threadCount in
+    // the options is ignored.
+    class CsvStream
+    {
+    private:
+        unique_ptr<MappedFile> file;
+        const char *firstRow;
+        const char *position;
+        const char *end;
+        // Start of the text not yet released.
+        const char *retained;
+        size_t columnCount;
+        size_t featureCount;
+        size_t skippedRows = 0;
+        vector<float> row;
+
+    public:
+        CsvStream(const string &path, const CsvOptions &options = CsvOptions());
+
+        // Parses up to maxRows rows into row-major feature and target
+        // buffers and returns how many it read; 0 at the end of the file.
+        size_t read(float *features, float *targets, size_t maxRows);
+        // Back to the first data row.
+        void rewind();
+
+        size_t getFeatureCount() const { return featureCount; }
+        size_t getTargetCount() const { return columnCount - featureCount; }
+        // Rows dropped so far, counted again after a rewind.
+        size_t getSkippedRows() const { return skippedRows; }
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "csv_reader.hpp"
+#include "dataset.hpp"
+
+using namespace std;
+
+namespace datasets
+{
+    // One mini-batch copied into contiguous row-major buffers. Buffers keep
+    // their capacity, so refilling a batch does not allocate.
+    struct Batch
+    {
+        size_t rows = 0;
+        size_t featureCount = 0;
+        size_t targetCount = 0;
+        vector<float> features;
+        vector<float> targets;
+
+        size_t size() const { return rows; }
+        bool empty() const { return rows == 0; }
+        const float *featuresAt(size_t index) const { return features.data() + index * featureCount; }
+        const float *targetsAt(size_t index) const { return targets.data() + index * targetCount; }
+        // Sizes the buffers for rowCount rows.
+        void resize(size_t rowCount, size_t featureCount, size_t targetCount);
+    };
+
+    // Produces one epoch of mini-batches at a time. A BatchPipeline calls
+    // it from a single background thread.
+    class BatchSource
+    {
+    public:
+        virtual ~BatchSource() = default;
+
+        virtual size_t getFeatureCount() const = 0;
+        virtual size_t getTargetCount() const = 0;
+        virtual size_t getBatchSize() const = 0;
+        // Rewinds to the first batch of `epoch`. The shuffle only depends on
+        // the seed and the epoch, so runs are reproducible.
+        virtual void startEpoch(int epoch) = 0;
+        // Fills batch with the next getBatchSize() rows or fewer; false
+        // once the epoch is exhausted.
+        virtual bool next(Batch &batch) = 0;
+    };
+
+    // Gathers an in-memory dataset's rows into batches through a
+    // per-epoch permutation of its own; the dataset's order is left alone.
+    // The dataset must outlive the source.
+    class DatasetBatchSource : public BatchSource
+    {
+    private:
+        const Dataset &dataset;
+        size_t batchSize;
+        bool shuffle;
+        unsigned seed;
+        vector<size_t> order;
+        size_t position = 0;
+
+    public:
+        DatasetBatchSource(const Dataset &dataset, size_t batchSize, bool shuffle = true, unsigned seed = 42);
+
+        size_t getFeatureCount() const override { return dataset.getFeatureCount(); }
+        size_t getTargetCount() const override { return dataset.getTargetCount(); }
+        size_t getBatchSize() const override { return batchSize; }
+        void startEpoch(int epoch) override;
+        bool next(Batch &batch) override;
+    };
+
+    // Streams a CSV file from disk in one pass per epoch, so datasets
+    // larger than RAM train in bounded memory. Shuffling is local: rows
+    // flow through a buffer of shuffleRows and each batch row is drawn from
+    // it at random, so rows move at most about shuffleRows positions.
+    // shuffleRows <= 1 keeps the file order.
+    class CsvBatchSource : public BatchSource
+    {
+    private:
+        io::CsvStream stream;
+        size_t batchSize;
+        size_t shuffleRows;
+        unsigned seed;
+        mt19937 generator;
+        // Shuffle buffer of bufferedRows rows.
+        vector<float> bufferFeatures;
+        vector<float> bufferTargets;
+        size_t bufferedRows = 0;
+
+    public:
+        CsvBatchSource(const string &path, size_t batchSize, size_t shuffleRows = 4096, unsigned seed = 42,
+                       const io::CsvOptions &options = io::CsvOptions());
+
+        size_t getFeatureCount() const override { return stream.getFeatureCount(); }
+        size_t getTargetCount() const override { return stream.getTargetCount(); }
+        size_t getBatchSize() const override { return batchSize; }
+        void startEpoch(int epoch) override;
+        bool next(Batch &batch) override;
+    };
+
+    // Runs a BatchSource on a background thread that fills a ring of
+    // `depth` batches ahead of the consumer. With the default depth of 2
+    // the next batch is assembled while the current one trains.
+    class BatchPipeline
+    {
+    private:
+        unique_ptr<BatchSource> source;
+        vector<Batch> slots;
+        thread producer;
+        mutex lock;
+        condition_variable batchReady;
+        condition_variable slotFree;
+
+        int epoch = 0;
+        // Bumped by startEpoch(); 0 until the first epoch starts.
+        unsigned long generation = 0;
+        // Ring of filled slots starting at head; the consumer's current
+        // batch stays counted until its next call to next().
+        size_t head = 0;
+        size_t filled = 0;
+        bool holding = false;
+        bool exhausted = false;
+        bool stopping = false;
+        exception_ptr failure;
+
+        void produce();
+
+    public:
+        BatchPipeline(unique_ptr<BatchSource> source, size_t depth = 2);
+        ~BatchPipeline();
+
+        BatchPipeline(const BatchPipeline &) = delete;
+        BatchPipeline &operator=(const BatchPipeline &) = delete;
+
+        // Starts preparing `epoch`, dropping what is left of the previous
+        // one. Call it early (e.g. before validation) to overlap the first
+        // batches with other work.
+        void startEpoch(int epoch);
+        // The epoch's next batch, or nullptr once it is done. The batch
+        // stays valid until the following call. Rethrows errors raised by
+        // the source.
+        const Batch *next();
+
+        size_t getFeatureCount() const { return source->getFeatureCount(); }
+        size_t getTargetCount() const { return source->getTargetCount(); }
+        size_t getBatchSize() const { return source->getBatchSize(); }
+    };
+}
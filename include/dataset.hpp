@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+#include "csv_reader.hpp"
+
+using namespace std;
+
+namespace datasets
+{
+    class Dataset;
+
+    // Strided read-only view of row-major float data.
+    struct MatrixView
+    {
+        const float *data;
+        size_t rows;
+        size_t columns;
+        size_t stride;
+
+        const float *row(size_t index) const { return data + index * stride; }
+    };
+
+    // Contiguous range [begin, end) of a dataset's rows in its current order.
+    class DatasetView
+    {
+    private:
+        const Dataset *dataset;
+        size_t first;
+        size_t count;
+
+    public:
+        DatasetView(const Dataset &dataset, size_t begin, size_t end);
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const Dataset &getDataset() const { return *dataset; }
+
+        const float *featuresAt(size_t index) const;
+        const float *targetsAt(size_t index) const;
+    };
+
+    // Samples stored as one contiguous row-major feature matrix and one
+    // target matrix. Rows are visited through an index order, so shuffling
+    // permutes indices and never moves sample data.
+    class Dataset
+    {
+    private:
+        size_t featureCount;
+        size_t targetCount;
+        vector<float> features;
+        vector<float> targets;
+        vector<size_t> order;
+
+    public:
+        Dataset();
+        Dataset(size_t featureCount, size_t targetCount);
+        Dataset(io::CsvTable &&table);
+
+        static Dataset fromCsv(const string &path, const io::CsvOptions &options = io::CsvOptions());
+        // Splits each row into its first featureCount values and the rest.
+        static Dataset fromRows(const vector<vector<float>> &rows, size_t featureCount);
+
+        void reserve(size_t rowCount);
+        void addRow(const float *rowFeatures, const float *rowTargets);
+
+        size_t size() const { return order.size(); }
+        bool empty() const { return order.empty(); }
+        size_t getFeatureCount() const { return featureCount; }
+        size_t getTargetCount() const { return targetCount; }
+
+        // Row `index` in the current order.
+        const float *featuresAt(size_t index) const { return features.data() + order[index] * featureCount; }
+        const float *targetsAt(size_t index) const { return targets.data() + order[index] * targetCount; }
+
+        // Storage-order matrices, unaffected by shuffle(); row i is the i-th
+        // sample added.
+        MatrixView featureMatrix() const { return {features.data(), size(), featureCount, featureCount}; }
+        MatrixView targetMatrix() const { return {targets.data(), size(), targetCount, targetCount}; }
+
+        DatasetView view() const { return DatasetView(*this, 0, size()); }
+        DatasetView view(size_t begin, size_t end) const { return DatasetView(*this, begin, end); }
+
+        void shuffle(mt19937 &generator);
+        void resetOrder();
+    };
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "arena.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace tracking
+{
+    enum class TrackingMode
+    {
+        // One record per captured sample with its raw deltas.
+        Samples,
+        // One record per captured mini-batch with mean and max |delta|.
+        BatchSummary
+    };
+
+    struct TrackingOptions
+    {
+        TrackingMode mode = TrackingMode::Samples;
+        // Capture every Nth sample (Samples) or every Nth batch (BatchSummary).
+        size_t interval = 1;
+        // Records kept in memory. Without a sink the oldest are overwritten;
+        // with one, training waits for the writer once this many are pending.
+        size_t capacity = 1 << 16;
+    };
+
+    // Fixed part of a record. Its values follow as nodeCount deltas (mean
+    // |delta| for summaries) and then nodeCount max |delta|, for every node
+    // from input to output.
+    struct DeltaRecord
+    {
+        int32_t epoch;
+        uint32_t sampleCount;
+        int64_t sample; // First sample of the batch for summaries
+        float loss;     // Mean over sampleCount samples
+        // Two sampled weights, captured instead of copying every edge:
+        // input node 0 -> first next node, first hidden node 0 -> next.
+        float inputWeight;
+        float hiddenWeight;
+    };
+
+    struct DeltaLayout
+    {
+        vector<size_t> layerSizes;
+        TrackingMode mode;
+
+        size_t getNodeCount() const;
+        size_t getValueCount() const { return 2 * getNodeCount(); }
+    };
+
+    // Destination for records streamed off the training thread.
+    class DeltaSink
+    {
+    public:
+        virtual ~DeltaSink() = default;
+
+        virtual void begin(const DeltaLayout &layout) = 0;
+        // `values` holds count * layout.getValueCount() floats.
+        virtual void write(const DeltaRecord *records, const float *values, size_t count) = 0;
+        virtual void finish() {}
+    };
+
+    // The epoch,sample,loss,<deltas>,input_weight_0,hidden0_weight_0 CSV
+    // read by visualize_deltas.py.
+    class CsvDeltaSink : public DeltaSink
+    {
+    private:
+        string filename;
+        ofstream file;
+        size_t nodeCount;
+        size_t valueCount;
+
+    public:
+        CsvDeltaSink(const string &filename);
+
+        void begin(const DeltaLayout &layout) override;
+        void write(const DeltaRecord *records, const float *values, size_t count) override;
+        void finish() override;
+    };
+
+    // Append-only binary log read by delta_log.py, version 1 (native
+    // little-endian):
+    //
+    //   char magic[8] "NNDELTA", uint32 version, mode, layerCount, valueCount
+    //   uint32 layerSizes[layerCount], zero-padded to a multiple of 8 bytes
+    //   records: int32 epoch, uint32 sampleCount, int64 sample,
+    //            float loss, inputWeight, hiddenWeight, uint32 reserved,
+    //            float values[valueCount]
+    //
+    // Each batch of records is flushed as it arrives, so a running job's
+    // log can be read at any time; readers drop a partial trailing record.
+    class BinaryDeltaSink : public DeltaSink
+    {
+    private:
+        string filename;
+        ofstream file;
+        size_t valueCount;
+        uint64_t recordCount;
+        vector<char> buffer;
+
+    public:
+        BinaryDeltaSink(const string &filename);
+
+        void begin(const DeltaLayout &layout) override;
+        void write(const DeltaRecord *records, const float *values, size_t count) override;
+        void finish() override;
+
+        uint64_t getRecordCount() const { return recordCount; }
+    };
+
+    // Samples deltas during training into per-worker stages, commits them
+    // in worker order after each batch (so records don't depend on the
+    // thread count) and keeps them in a preallocated ring. An optional sink
+    // drains the ring from a background thread.
+    class DeltaTracker
+    {
+    private:
+        struct Stage
+        {
+            vector<DeltaRecord> records;
+            vector<float> values;
+            // BatchSummary accumulators
+            vector<float> sumAbs;
+            vector<float> maxAbs;
+            double lossSum = 0.0;
+            size_t sampleCount = 0;
+        };
+
+        DeltaLayout layout;
+        TrackingOptions options;
+        size_t valueCount;
+        vector<Stage> stages;
+
+        mutable mutex lock;
+        condition_variable pendingChanged;
+        vector<DeltaRecord> ringRecords;
+        vector<float> ringValues;
+        uint64_t firstRetained;
+        uint64_t nextRecord;
+        uint64_t nextUnwritten;
+        uint64_t droppedRecords;
+
+        unique_ptr<DeltaSink> sink;
+        thread writer;
+        bool stopping;
+        bool flushRequested;
+        exception_ptr sinkFailure;
+
+        void push(unique_lock<mutex> &guard, const DeltaRecord &record, const float *values);
+        void writerLoop();
+        void stopWriter();
+
+    public:
+        DeltaTracker(const vector<size_t> &layerSizes, const TrackingOptions &options = TrackingOptions());
+        ~DeltaTracker();
+
+        DeltaTracker(const DeltaTracker &) = delete;
+        DeltaTracker &operator=(const DeltaTracker &) = delete;
+
+        const TrackingOptions &getOptions() const { return options; }
+        const DeltaLayout &getLayout() const { return layout; }
+
+        // Streams every record from now on to sink; replaces any previous sink.
+        void setSink(unique_ptr<DeltaSink> sink);
+        // Blocks until every committed record reached the sink, then
+        // rethrows a sink failure if there was one.
+        void flush();
+
+        void prepare(size_t workerCount);
+        bool captures(size_t sample, size_t batchIndex) const;
+        // Called concurrently, one worker per stage.
+        void capture(size_t worker, size_t sample, float loss, const vector<memory::FloatSpan> &layerDeltas);
+        void commit(size_t workerCount, int epoch, size_t batchBegin, float inputWeight, float hiddenWeight);
+
+        size_t size() const;
+        // Records overwritten before any sink could stream them.
+        uint64_t getDroppedCount() const;
+        // Retained records, oldest first.
+        void forEach(const function<void(const DeltaRecord &, const float *)> &visit) const;
+        void clear();
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace numeric
+{
+    // IEEE binary16 and bfloat16 stored as raw 16-bit patterns. Conversions
+    // from float round to nearest even; NaN stays NaN.
+
+    inline uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float bitsToFloat(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline uint16_t floatToBFloat16(float value)
+    {
+        uint32_t bits = floatBits(value);
+        if ((bits & 0x7fffffffu) > 0x7f800000u)
+            return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+        bits += 0x7fffu + ((bits >> 16) & 1u);
+        return static_cast<uint16_t>(bits >> 16);
+    }
+
+    inline float bfloat16ToFloat(uint16_t value)
+    {
+        return bitsToFloat(static_cast<uint32_t>(value) << 16);
+    }
+
+    inline uint16_t floatToHalf(float value)
+    {
+        const uint32_t bits = floatBits(value);
+        const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+        const uint32_t magnitude = bits & 0x7fffffffu;
+
+        if (magnitude > 0x7f800000u)
+            return sign | 0x7e00u;
+        // At or above 65520 rounds to infinity.
+        if (magnitude >= 0x477ff000u)
+            return sign | 0x7c00u;
+        // Below 2^-14: subnormal half; the float add aligns the mantissa and
+        // rounds it to nearest even in one step.
+        if (magnitude < 0x38800000u)
+            return sign | static_cast<uint16_t>(floatBits(bitsToFloat(magnitude) + 0.5f) - floatBits(0.5f));
+
+        uint32_t rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u);
+        return sign | static_cast<uint16_t>((rounded - 0x38000000u) >> 13);
+    }
+
+    inline float halfToFloat(uint16_t value)
+    {
+        const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+        const uint32_t exponent = (value >> 10) & 0x1fu;
+        const uint32_t mantissa = value & 0x3ffu;
+
+        if (exponent == 0x1fu)
+            return bitsToFloat(sign | 0x7f800000u | (mantissa << 13));
+        if (exponent == 0)
+        {
+            // Zero or subnormal: mantissa * 2^-24.
+            const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+            return bitsToFloat(sign | floatBits(magnitude));
+        }
+        return bitsToFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include "dataset.hpp"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+namespace neural_network
+{
+    // What the reduced copies of a NeuralNetwork (QuantizedNetwork,
+    // SparseNetwork) share: the source network's input stage, applied
+    // before the first layer.
+    class InferenceCopy
+    {
+    protected:
+        // Empty unless the source network has an input stage.
+        Normalizer inputNormalizer;
+
+        explicit InferenceCopy(const NeuralNetwork &network);
+
+        // count rows of inputSize values, normalized into scratch when
+        // there is an input stage, else inputs itself.
+        const float *normalizeInputs(const float *inputs, size_t count, float *scratch) const;
+        // Floats normalizeInputs() needs in scratch for rows at a time.
+        size_t normalizeScratchSize(size_t rows, size_t inputSize) const;
+    };
+
+    // Output drift of a copy against the network it was made from.
+    struct CopyDrift
+    {
+        size_t sampleCount = 0;
+        float maxAbsoluteError = 0.0f;
+        float meanAbsoluteError = 0.0f;
+        // Mean loss of each model against the dataset targets, both through
+        // calculateLoss() on the finished outputs.
+        float referenceLoss = 0.0f;
+        float copyLoss = 0.0f;
+    };
+
+    // Runs reference and the copy's forwardBatch over data and compares
+    // the outputs; throws invalid_argument if copyLayerSizes or the
+    // dataset shape don't match reference.
+    CopyDrift measureDrift(const NeuralNetwork &reference, const vector<size_t> &copyLayerSizes,
+                           const function<void(const float *, size_t, float *)> &forwardBatch,
+                           const datasets::Dataset &data);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace serving
+{
+    struct BatchingOptions
+    {
+        // Requests run together in one forwardBatch() call at most.
+        size_t maxBatchSize = 64;
+        // How long the oldest queued request may wait for others to join
+        // its batch.
+        chrono::microseconds maxWait{500};
+    };
+
+    struct ServingStats
+    {
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        double meanBatchSize = 0.0;
+        // Queueing plus inference, over the most recent requests.
+        double p50Milliseconds = 0.0;
+        double p99Milliseconds = 0.0;
+        // Requests per second since the batcher started.
+        double throughput = 0.0;
+    };
+
+    // Coalesces concurrent prediction requests into micro-batches on one
+    // worker thread. A batch closes when it is full or when its oldest
+    // request has waited maxWait, then runs through the batched forward
+    // path with its own InferenceContext. The network must not be trained
+    // while the batcher serves it.
+    class MicroBatcher
+    {
+    private:
+        struct Request
+        {
+            vector<float> inputs;
+            promise<vector<float>> result;
+            chrono::steady_clock::time_point arrival;
+        };
+
+        shared_ptr<const neural_network::NeuralNetwork> network;
+        BatchingOptions options;
+        neural_network::InferenceContext context;
+        vector<float> batchInputs;
+        vector<float> batchOutputs;
+
+        mutex lock;
+        condition_variable queued;
+        deque<Request> queue;
+        bool stopping = false;
+        thread worker;
+
+        mutable mutex statsLock;
+        chrono::steady_clock::time_point started;
+        uint64_t requestCount = 0;
+        uint64_t batchCount = 0;
+        // Ring of the latest latencies, in milliseconds.
+        vector<float> latencies;
+        size_t nextLatency = 0;
+
+        void run();
+        void process(vector<Request> &batch);
+
+    public:
+        MicroBatcher(shared_ptr<const neural_network::NeuralNetwork> network,
+                     const BatchingOptions &options = BatchingOptions());
+        // Finishes the queued requests before returning.
+        ~MicroBatcher();
+
+        MicroBatcher(const MicroBatcher &) = delete;
+        MicroBatcher &operator=(const MicroBatcher &) = delete;
+
+        // Thread-safe. Throws invalid_argument for a wrong input count.
+        future<vector<float>> submit(vector<float> inputs);
+        vector<float> predict(vector<float> inputs) { return submit(move(inputs)).get(); }
+
+        ServingStats getStats() const;
+        const neural_network::NeuralNetwork &getNetwork() const { return *network; }
+    };
+
+    // Line protocol: each line is either comma-separated raw inputs,
+    // answered with the comma-separated outputs, or "stats", answered with
+    // the batcher's counters. Malformed lines get "error: <reason>".
+    // Every line read in one go is submitted before any answer is awaited,
+    // so pipelined clients share batches. Returns at end of input, or after
+    // answering "error: line too long" to a line over 256 KiB.
+    void serveLines(MicroBatcher &batcher, int inputFd, int outputFd);
+    // Listens on address:port (IPv4) and serves each connection with
+    // serveLines() on its own thread, up to 64 at once; a connection beyond
+    // that gets "error: too many connections" and is closed. Never
+    // returns; throws runtime_error if the socket can't be set up.
+    void serveTcp(MicroBatcher &batcher, uint16_t port, const string &address = "127.0.0.1");
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace initialization
+{
+    // SplitMix64 finalizer: a bijective 64-bit hash.
+    inline uint64_t mix64(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Counter-based generator: draw i of a stream is a pure function of
+    // (seed, stream, i), a SplitMix64 step at the counter. Buffers can be
+    // filled in any order and on any number of threads with identical
+    // results, and there is no shared state to lock.
+    class CounterRng
+    {
+    private:
+        uint64_t key;
+
+    public:
+        CounterRng(uint64_t seed, uint64_t stream);
+
+        uint64_t bits(uint64_t counter) const { return mix64(key + (counter + 1) * 0x9E3779B97F4A7C15ull); }
+
+        // Uniform in [0, 1), 24 random bits.
+        float uniform(uint64_t counter) const { return (bits(counter) >> 40) * 0x1.0p-24f; }
+        // Standard normal (Box-Muller) from draws 2 * counter and
+        // 2 * counter + 1.
+        float normal(uint64_t counter) const;
+    };
+
+    enum class Scheme
+    {
+        // U(-range, range), the original fixed initialization.
+        Uniform,
+        // Glorot: variance 2 / (fanIn + fanOut), for tanh/sigmoid layers.
+        XavierUniform,
+        XavierNormal,
+        // Kaiming: variance 2 / fanIn, for (leaky) ReLU and GELU layers.
+        HeUniform,
+        HeNormal
+    };
+
+    const char *schemeName(Scheme scheme);
+    // Inverse of schemeName(); false for an unknown name.
+    bool parseScheme(const char *name, Scheme &scheme);
+
+    struct InitializationOptions
+    {
+        Scheme weights = Scheme::Uniform;
+        // Half-width of Scheme::Uniform weights.
+        float range = 0.5f;
+        // Biases are drawn from U(-biasRange, biasRange); 0 zeroes them,
+        // which is the usual pairing with Xavier and He.
+        float biasRange = 0.5f;
+        // Same seed, same parameters, whatever the thread count.
+        uint64_t seed = 42;
+    };
+
+    // Bulk fills that split large buffers into blocks across pool, when
+    // given; each value depends only on its index.
+    void fillUniform(float *values, size_t n, float low, float high, const CounterRng &rng,
+                     threading::ThreadPool *pool = nullptr);
+    void fillNormal(float *values, size_t n, float standardDeviation, const CounterRng &rng,
+                    threading::ThreadPool *pool = nullptr);
+    // Row-major [fanIn][fanOut] weights drawn from options.weights, using
+    // stream `stream` of options.seed.
+    void fillWeights(float *weights, size_t fanIn, size_t fanOut, const InitializationOptions &options,
+                     uint64_t stream, threading::ThreadPool *pool = nullptr);
+}
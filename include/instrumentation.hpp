@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Hot-path instrumentation. The NN_PROFILE_* hooks compile to nothing
+// unless NN_PROFILE is defined (make PROFILE=1), so regular builds pay
+// nothing for them.
+namespace profiling
+{
+    enum class Phase
+    {
+        Train,
+        Forward,
+        InputForward,
+        HiddenForward,
+        // Every scoring of outputs against targets, the fused training and
+        // evaluate() passes included.
+        Loss,
+        Backpropagate,
+        ReduceGradients,
+        ApplyGradients,
+        CaptureDeltas,
+        ForwardBatch,
+        Count
+    };
+
+    enum class Counter
+    {
+        SamplesTrained,
+        BatchesApplied,
+        SamplesInferred,
+        DeltasCaptured,
+        Count
+    };
+
+    const char *phaseName(Phase phase);
+    const char *counterName(Counter counter);
+
+    struct PhaseTotals
+    {
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;
+    };
+
+    struct EpochProfile
+    {
+        PhaseTotals phases[static_cast<size_t>(Phase::Count)];
+        uint64_t counters[static_cast<size_t>(Counter::Count)] = {};
+    };
+
+    // Process-wide collector. Each thread accumulates into its own block, so
+    // recording never contends; closeEpoch() and the exports read every
+    // block and must run while no instrumented work is in flight (between
+    // train() calls).
+    class Profiler
+    {
+    private:
+        struct TraceEvent
+        {
+            Phase phase;
+            uint64_t start;
+            uint64_t duration;
+        };
+
+        struct ThreadBlock
+        {
+            size_t id;
+            // Written only by the owning thread; atomics keep the reads in
+            // closeEpoch() well defined.
+            atomic<uint64_t> calls[static_cast<size_t>(Phase::Count)];
+            atomic<uint64_t> nanoseconds[static_cast<size_t>(Phase::Count)];
+            atomic<uint64_t> counters[static_cast<size_t>(Counter::Count)];
+            mutex traceLock;
+            vector<TraceEvent> trace;
+
+            ThreadBlock(size_t id);
+        };
+
+        mutex lock;
+        vector<unique_ptr<ThreadBlock>> blocks;
+        map<int, EpochProfile> epochs;
+        chrono::steady_clock::time_point origin;
+        atomic<bool> tracing;
+        size_t traceCapacity;
+
+        Profiler();
+        ThreadBlock &localBlock();
+
+    public:
+        static Profiler &instance();
+
+        uint64_t now() const;
+        void record(Phase phase, uint64_t start, uint64_t duration);
+        void count(Counter counter, uint64_t amount);
+
+        // Chrome trace events are kept only while tracing is on, up to
+        // `capacity` events per thread.
+        void enableTracing(size_t capacity = 1 << 20);
+        void disableTracing() { tracing = false; }
+
+        // Moves everything recorded since the last call into `epoch`.
+        void closeEpoch(int epoch);
+        const map<int, EpochProfile> &getEpochs() const { return epochs; }
+        void reset();
+
+        // Per-epoch phase totals and counters.
+        void exportJson(const string &filename);
+        // chrome://tracing / Perfetto "traceEvents" format.
+        void exportChromeTrace(const string &filename);
+    };
+
+    class ScopedTimer
+    {
+    private:
+        Phase phase;
+        uint64_t start;
+
+    public:
+        ScopedTimer(Phase phase) : phase(phase), start(Profiler::instance().now()) {}
+        ~ScopedTimer() { Profiler::instance().record(phase, start, Profiler::instance().now() - start); }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+    };
+}
+
+#define NN_PROFILE_CONCAT_INNER(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b) NN_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef NN_PROFILE
+#define NN_PROFILE_SCOPE(phase) \
+    profiling::ScopedTimer NN_PROFILE_CONCAT(profileScope, __LINE__)(profiling::Phase::phase)
+#define NN_PROFILE_COUNT(counter, amount) \
+    profiling::Profiler::instance().count(profiling::Counter::counter, (amount))
+#define NN_PROFILE_CLOSE_EPOCH(epoch) profiling::Profiler::instance().closeEpoch(epoch)
+#else
+#define NN_PROFILE_SCOPE(phase) ((void)0)
+#define NN_PROFILE_COUNT(counter, amount) ((void)0)
+#define NN_PROFILE_CLOSE_EPOCH(epoch) ((void)0)
+#endif
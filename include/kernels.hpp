@@ -0,0 +1,117 @@
+#pragma once
+
+#include "activation.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace kernels
+{
+    enum class Backend
+    {
+        Scalar,
+        Avx2,
+        Avx512,
+        Neon
+    };
+
+    enum class WeightFormat
+    {
+        Int8,
+        Float16,
+        BFloat16
+    };
+
+    // Reduced-precision weight buffers end with this many padding entries,
+    // so kernels load whole vectors across the last columns of a row (the
+    // extra lanes are never stored) without reading past the buffer.
+    constexpr size_t reducedPadding = 16;
+
+    // Row-major [source][target] weights. Int8 entries decode as
+    // scale * (q - zeroPoint); Float16 and BFloat16 are raw 16-bit patterns
+    // (see half_float.hpp) and ignore both.
+    struct ReducedWeights
+    {
+        const void *data;
+        WeightFormat format;
+        float scale;
+        int32_t zeroPoint;
+    };
+
+    // Samples the sparse kernels process together. Their activations are
+    // interleaved [node][lane], so every stored edge updates one contiguous
+    // run of lanes: a whole vector on AVX-512, two on AVX2, four on NEON.
+    constexpr size_t sparseLanes = 16;
+
+    // Row-major [source][target] weights in CSR: the edges leaving source i
+    // are rowOffsets[i]..rowOffsets[i + 1], towards columns[e] with
+    // values[e].
+    struct SparseWeights
+    {
+        const uint32_t *rowOffsets;
+        const uint32_t *columns;
+        const float *values;
+    };
+
+    // Dense float kernels used by the layers. Every backend fills the same
+    // table; the scalar one is the reference the others are checked against.
+    struct KernelTable
+    {
+        Backend backend;
+        const char *name;
+
+        // y[i] += a * x[i]
+        void (*axpy)(float a, const float *x, float *y, size_t n);
+        // gradients[i] += value * deltas[i]; returns sum(weights[i] * deltas[i]).
+        float (*dotAccumulate)(const float *weights, const float *deltas, float value,
+                               float *gradients, size_t n);
+        // targets[rows x targetCount] = activation(sources[rows x sourceCount] * weights + biases),
+        // with bias, product and activation fused into one store per target.
+        // A non-null derivatives (same layout as targets) also receives
+        // activation'() for every target, for the backward pass to reuse.
+        // Softmax normalizes each row once its targets are stored; its
+        // derivatives are meaningless and should not be requested.
+        void (*denseBatch)(const float *sources, size_t rowCount, size_t sourceCount,
+                           const float *weights, const float *biases, size_t targetCount,
+                           Activation activation, float *targets, float *derivatives);
+        // values[i] *= factors[i]
+        void (*multiply)(const float *factors, float *values, size_t n);
+
+        // denseBatch over reduced-precision weights, each widened to float
+        // on load; sums and activations stay float. No derivatives.
+        void (*denseReduced)(const float *sources, size_t rowCount, size_t sourceCount,
+                             const ReducedWeights &weights, const float *biases, size_t targetCount,
+                             Activation activation, float *targets);
+
+        // denseBatch over CSR weights for one block of sparseLanes samples,
+        // with sources [sourceCount][sparseLanes] and targets and
+        // derivatives [targetCount][sparseLanes]. Work is per stored edge;
+        // a source that is zero in every lane is skipped. Softmax
+        // normalizes each lane across the targets.
+        void (*sparseForward)(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                              const float *biases, size_t targetCount, Activation activation, float *targets,
+                              float *derivatives);
+        // Backward of sparseForward over the same block: for every edge e
+        // from source i, gradients[e] += sum over lanes of
+        // sources[i] * targetDeltas[columns[e]], and a non-null sourceDeltas
+        // receives sum over e of values[e] * targetDeltas[columns[e]].
+        void (*sparseBackward)(const float *sources, const float *targetDeltas, size_t sourceCount,
+                               const SparseWeights &weights, float *gradients, float *sourceDeltas);
+    };
+
+    // Backend tables; a backend not built for this architecture returns nullptr.
+    const KernelTable *scalarKernels();
+    const KernelTable *avx2Kernels();
+    const KernelTable *avx512Kernels();
+    const KernelTable *neonKernels();
+
+    extern const KernelTable *activeTable;
+
+    // Kernels picked at startup from CPU features (override with
+    // NN_KERNELS=scalar|avx2|avx512|neon).
+    inline const KernelTable &active() { return *activeTable; }
+
+    bool isSupported(Backend backend);
+    // Returns false and leaves the selection unchanged if unsupported.
+    bool setBackend(Backend backend);
+    const char *backendName(Backend backend);
+}
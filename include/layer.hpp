@@ -3,6 +3,8 @@
 #include <vector>
 #include <memory>
 #include "node.hpp"
+#include "parameter_buffer.hpp"
+#include "kernels.hpp"
 
 using namespace std;
 using namespace nodes;
@@ -14,37 +16,63 @@ namespace layers
     class HiddenLayer;
     class OutputLayer;
 
+    // Layers hold parameters only. Activations and deltas live in a
+    // caller-owned Workspace so one set of weights can serve many threads.
+    // Parameters start at zero; NeuralNetwork::initialize() draws them.
+    // Built with allocateParameters = false a layer allocates nothing: the
+    // loader binds its parameters and allocateGradients() adds the
+    // gradients once training starts.
     class Layer
     {
     protected:
+        // Backs every buffer below when set; otherwise each owns its storage.
+        shared_ptr<memory::Arena> arena;
+        size_t nodeCount = 0;
+        bool allocateParameters = true;
+
+        void allocate(ParameterBuffer &buffer, size_t n);
         virtual void initializeNodes(int nodeCount);
-        float generateRandomNormalizedValues(const float range[2]);
 
     public:
-        vector<shared_ptr<Node>> nodes;
+        ParameterBuffer biases;
+        // Applied to this layer's pre-activations by the layer feeding it.
+        kernels::Activation activation = kernels::Activation::Identity;
+        // Bias gradients accumulated across the current mini-batch.
+        ParameterBuffer biasGradients;
 
         virtual ~Layer() = default;
         Layer() = default;
 
-        void resetValues();
+        void resetGradients();
+        // Zeroed gradient buffers carved from arena, unless already there.
+        virtual void allocateGradients(const shared_ptr<memory::Arena> &arena);
+        bool hasGradients() const { return !biasGradients.empty(); }
 
-        size_t getNodeCount() const { return nodes.size(); }
+        size_t getNodeCount() const { return nodeCount; }
     };
 
     class InputLayer : public Layer
     {
     private:
-        void initializeNodes(int nodeCount) override;
         void initializeEdges(shared_ptr<Layer> nextLayer);
 
     public:
-        vector<shared_ptr<Edge>> edges;
+        // Row-major [node][nextNode] weight matrix.
+        ParameterBuffer weights;
+        // Weight gradients accumulated across the current mini-batch.
+        ParameterBuffer weightGradients;
+        shared_ptr<Layer> nextLayer;
 
-        InputLayer(int nodeCount);
+        InputLayer(int nodeCount, shared_ptr<memory::Arena> arena = nullptr, bool allocateParameters = true);
 
-        void setInputValues(const vector<float> &values);
         void attachLayer(shared_ptr<Layer> nextLayer);
-        void forward();
+        void allocateGradients(const shared_ptr<memory::Arena> &arena) override;
+        // Writes the next layer's activated values into nextValues and,
+        // when nextDerivatives is set, their activation derivatives. With
+        // logits the activation is skipped and nextValues gets the raw
+        // pre-activations.
+        void forward(const float *values, float *nextValues, float *nextDerivatives = nullptr,
+                     bool logits = false) const;
     };
 
     class HiddenLayer : public Layer
@@ -53,21 +81,26 @@ namespace layers
         void initializeEdges(shared_ptr<Layer> nextLayer);
 
     public:
-        vector<shared_ptr<Edge>> edges;
+        // Row-major [node][nextNode] weight matrix.
+        ParameterBuffer weights;
+        // Weight gradients accumulated across the current mini-batch.
+        ParameterBuffer weightGradients;
+        shared_ptr<Layer> nextLayer;
 
-        HiddenLayer(int nodeCount);
+        HiddenLayer(int nodeCount, shared_ptr<memory::Arena> arena = nullptr, bool allocateParameters = true);
 
         void attachLayer(shared_ptr<Layer> nextLayer);
-        void processNodes();
-        void forward();
+        void allocateGradients(const shared_ptr<memory::Arena> &arena) override;
+        // values are already activated; writes the next layer's activated
+        // values and, when nextDerivatives is set, their derivatives.
+        // See InputLayer::forward().
+        void forward(const float *values, float *nextValues, float *nextDerivatives = nullptr,
+                     bool logits = false) const;
     };
 
     class OutputLayer : public Layer
     {
     public:
-        OutputLayer(int nodeCount);
-
-        void processNodes();
-        vector<float> getOutput();
+        OutputLayer(int nodeCount, shared_ptr<memory::Arena> arena = nullptr, bool allocateParameters = true);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+namespace io
+{
+    // Whole-file memory mapping, mapped privately: pages are loaded on first
+    // touch and writes go to copy-on-write pages, never to the file.
+    class MappedFile
+    {
+    private:
+        void *address;
+        size_t length;
+
+    public:
+        MappedFile(const string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Hints that the file will be read front to back once.
+        void adviseSequential() const;
+        // Drops the whole pages inside [offset, offset + size) from memory;
+        // they are read back from the file if touched again.
+        void release(size_t offset, size_t size) const;
+
+        unsigned char *data() { return static_cast<unsigned char *>(address); }
+        const unsigned char *data() const { return static_cast<const unsigned char *>(address); }
+        size_t size() const { return length; }
+    };
+
+    // Moves a fully written temporaryPath over path durably: the file is
+    // synced before the rename and its directory after, so a crash leaves
+    // either the old file or the complete new one. Returns false (with
+    // temporaryPath removed) if any step fails.
+    bool commitFile(const string &temporaryPath, const string &path);
+}
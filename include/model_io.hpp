@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "activation.hpp"
+
+using namespace std;
+
+namespace model_io
+{
+    // Binary model format, version 3 (native little-endian floats):
+    //
+    //   FileHeader
+    //   uint32_t layerSizes[layerCount]        input .. output
+    //   uint32_t inputStage                    InputStage (absent in version 1)
+    //   uint32_t activations[layerCount]       kernels::Activation per layer,
+    //                                          Identity for the input (absent
+    //                                          before version 3)
+    //   per layer l, each blob 64-byte aligned:
+    //     float biases[layerSizes[l]]
+    //     float weights[layerSizes[l] * layerSizes[l + 1]]   (not for output)
+    //   unless inputStage is None, 64-byte aligned:
+    //     float inputOffsets[layerSizes[0]]
+    //     float inputScales[layerSizes[0]]
+    //
+    // Blobs keep the in-memory [node][nextNode] layout, so a mapped file can
+    // back the layers directly. Version 1 and 2 files are still read, with
+    // the leaky ReLU hidden layers and sigmoid output they were trained with.
+    const char modelMagic[8] = {'N', 'N', 'M', 'O', 'D', 'E', 'L', '\0'};
+    const uint32_t modelVersion = 3;
+    const uint32_t endianTag = 0x01020304;
+    const size_t blobAlignment = 64;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t endianTag;
+        uint32_t layerCount;
+        uint32_t floatSize;
+        uint64_t fileSize;
+    };
+
+    // Input normalization stored with the model (see Normalizer).
+    enum class InputStage : uint32_t
+    {
+        None = 0,
+        Affine = 1,
+        AffineClamped = 2
+    };
+
+    struct BlobRange
+    {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    // Where every blob of a topology lives; save and load share this.
+    struct ModelLayout
+    {
+        vector<BlobRange> biases;
+        vector<BlobRange> weights; // Empty range for the output layer
+        BlobRange inputOffsets;    // Empty without an input stage
+        BlobRange inputScales;
+        uint64_t fileSize;
+    };
+
+    ModelLayout computeLayout(const vector<size_t> &layerSizes, InputStage inputStage = InputStage::None,
+                              uint32_t version = modelVersion);
+
+    struct ModelTopology
+    {
+        uint32_t version;
+        vector<size_t> layerSizes;
+        InputStage inputStage;
+        vector<kernels::Activation> activations;
+    };
+
+    // Validates the header and returns what it describes.
+    ModelTopology readTopology(const io::MappedFile &file);
+
+    // Writes a complete model image through a temporary file and
+    // io::commitFile(), so readers never see a partial model.
+    void writeModelFile(const string &path, const vector<unsigned char> &image);
+}
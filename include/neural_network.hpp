@@ -1,6 +1,15 @@
 #pragma once
 
 #include "layer.hpp"
+#include "thread_pool.hpp"
+#include "workspace.hpp"
+#include "dataset.hpp"
+#include "data_pipeline.hpp"
+#include "delta_tracker.hpp"
+#include "optimizer.hpp"
+#include "normalizer.hpp"
+#include "initializer.hpp"
+#include "checkpoint.hpp"
 #include <vector>
 #include <memory>
 
@@ -8,61 +17,256 @@ using namespace layers;
 
 namespace neural_network
 {
-    struct DeltaSnapshot
+    // How load() brings parameters into memory: Map uses the mapped file
+    // in place (copy-on-write if trained further), Copy reads it into
+    // owned buffers and releases the file.
+    enum class LoadMode
     {
-        int epoch;
-        int sample;
-        vector<float> inputDeltas;
-        vector<vector<float>> hiddenDeltas; // One vector per hidden layer
-        vector<float> outputDeltas;
-        vector<float> inputWeights; // Sample of weights
-        vector<vector<float>> hiddenWeights;
-        vector<float> inputBiases;
-        vector<vector<float>> hiddenBiases;
-        vector<float> outputBiases;
-        float loss;
+        Map,
+        Copy
+    };
+
+    // Dataset-level metrics from NeuralNetwork::evaluate().
+    struct Evaluation
+    {
+        size_t sampleCount = 0;
+        // Mean loss per sample, as calculateLoss() defines it for the
+        // output activation.
+        float loss = 0.0f;
+        // Mean |output - target| over every output value.
+        float meanAbsoluteError = 0.0f;
+        // Output values within the margin of their target.
+        size_t withinMargin = 0;
     };
 
     class NeuralNetwork
     {
     private:
+        // Backs every layer's parameters and gradients; null for a loaded
+        // network, whose parameters come from the file.
+        shared_ptr<memory::Arena> arena;
         shared_ptr<InputLayer> inputLayer;
         vector<shared_ptr<HiddenLayer>> hiddenLayers;
         shared_ptr<OutputLayer> outputLayer;
 
-        vector<DeltaSnapshot> deltaHistory;
+        // State behind the non-const forward()/forwardBatch()/evaluate();
+        // its workspace doubles as the first training worker's scratch.
+        InferenceContext context;
+        // Scratch for training threads beyond the first.
+        vector<Workspace> extraWorkspaces;
+        unique_ptr<threading::ThreadPool> threadPool;
+
+        unique_ptr<optimization::Optimizer> optimizer;
+        unique_ptr<optimization::LearningRateSchedule> schedule;
+        unique_ptr<Normalizer> inputNormalizer;
+
+        unique_ptr<tracking::DeltaTracker> deltaTracker;
         bool trackDeltas;
         int currentEpoch;
         int currentSample;
+        // Per weight matrix, 1 for kept and 0 for pruned weights; empty
+        // unless prune() was called.
+        vector<vector<float>> pruningMasks;
+
+        // Layer skeleton for layerSizes. With allocateParameters every
+        // parameter and gradient is carved zeroed from one arena; without,
+        // nothing is allocated and parameters stay unbound, for load().
+        // Draws no parameters either way.
+        NeuralNetwork(const vector<size_t> &layerSizes, bool allocateParameters);
 
         void createConnections();
-        int calculateHiddenLayerSize(int inputSize, int outputSize) const;
-        void updateLayer(shared_ptr<InputLayer> layer, float learningRate);
-        void updateLayer(shared_ptr<HiddenLayer> layer, float learningRate);
-        void updateLayer(shared_ptr<OutputLayer> layer, float learningRate);
-        void applyGradients(float learningRate);
-        void backpropagate(vector<float> &expected, float learningRate);
+        static int calculateHiddenLayerSize(int inputSize, int outputSize);
+        static vector<size_t> checkedLayerSizes(int inputSize, int outputSize, int hiddenLayerCount,
+                                                int hiddenLayerSize);
+        // Floats for `copies` sets of every weight and bias, padded the way
+        // the arena pads them.
+        static size_t arenaSize(const vector<size_t> &layerSizes, size_t copies);
+        // Adds the gradient buffers inference doesn't need (the default
+        // context's weight gradients and, for a loaded network, the
+        // layers') before the first train(); a no-op once they exist.
+        void prepareGradients();
+        const Layer &layerAt(size_t index) const;
+        Layer &layerAt(size_t index);
+        const ParameterBuffer &weightsFrom(size_t index) const;
+        ParameterBuffer &weightsFrom(size_t index);
+        ParameterBuffer &weightGradientsFrom(size_t index);
+        Workspace &trainingWorkspace(size_t worker);
+        void checkContext(const InferenceContext &context) const;
+
+        // A training pass also fills workspace.derivatives and stops at the
+        // output logits, which backpropagate() turns into outputs, loss and
+        // deltas in one pass.
+        void forwardSample(Workspace &workspace, const float *inputs, bool training = false) const;
+        void backpropagateLayer(Workspace &workspace, size_t index, bool applyDerivative) const;
+        // Returns the sample's loss.
+        float backpropagate(Workspace &workspace, const float *expected) const;
+        void prepareBatchBuffers(InferenceContext &context) const;
+        // Up to batchChunkSize rows; logits skips the output activation.
+        void forwardChunk(InferenceContext &context, const float *inputs, size_t rowCount, float *outputs,
+                          bool logits) const;
+        void reduceGradients(size_t workerCount);
 
-        void captureDeltas(float loss);
+        // Per-epoch state shared by the train() overloads.
+        struct TrainingPass
+        {
+            vector<optimization::ParameterGroup> groups;
+            float rate = 0.0f;
+            tracking::DeltaTracker *tracker = nullptr;
+            // Per-worker loss sums, added in worker order like the gradients.
+            vector<double> workerLosses;
+        };
+        TrainingPass beginPass(float learningRate);
+        // Mean loss over the samples trained since beginPass().
+        float finishPass(const TrainingPass &pass) const;
+        // Trains samples [first, first + count) of anything with
+        // featuresAt()/targetsAt() as one mini-batch.
+        template <typename Samples>
+        void trainBatch(TrainingPass &pass, const Samples &samples, size_t first, size_t count, size_t batchIndex);
+        // Weights and biases of every layer, input to output.
+        vector<optimization::ParameterGroup> parameterGroups();
+        // getParameters() layout, appended to parameters.
+        void appendParameters(vector<float> &parameters) const;
+        void applyGradients(const vector<optimization::ParameterGroup> &groups, float learningRate, size_t batchCount);
+
+        float sampledWeight(size_t index) const;
 
     public:
         NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount);
 
         NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount, int hiddenLayerSize);
 
+        // Redraws every weight and bias. The constructor applies the default
+        // options, so a fresh network is reproducible; the same options
+        // give the same parameters whatever the thread count. Fills run on
+        // the training threads (see setThreadCount()) once there are any.
+        // Also clears any pruning.
+        void initialize(const initialization::InitializationOptions &options);
+        // Magnitude pruning: zeroes at least `sparsity` of each weight
+        // matrix, smallest |w| first, and keeps them zero through further
+        // training so the network can be fine-tuned. Biases are kept. Only
+        // the zeros are saved; prune() again after load() to keep them
+        // fixed. SparseNetwork turns the result into CSR for inference.
+        void prune(float sparsity);
+        void clearPruning() { pruningMasks.clear(); }
+        bool isPruned() const { return !pruningMasks.empty(); }
+        // Clears the default context's activations. forward() overwrites
+        // every layer, so it is not needed between samples.
         void resetNetwork();
+        // Data-parallel training: each mini-batch is split into contiguous
+        // shards, one per thread, and gradients are reduced in thread order,
+        // so results only depend on the data and the thread count.
+        void setThreadCount(int threadCount);
+        int getThreadCount() const { return extraWorkspaces.size() + 1; }
         vector<float> forward(const vector<float> &inputs);
+        // Runs sampleCount row-major input rows through the network and
+        // writes sampleCount x outputSize results into outputs.
+        void forwardBatch(const float *inputs, size_t sampleCount, float *outputs);
+
+        // Thread-safe inference: the network is only read, all activation
+        // state lives in the caller's context.
+        InferenceContext createInferenceContext() const;
+        void forward(InferenceContext &context, const float *inputs, float *outputs) const;
+        void forwardBatch(InferenceContext &context, const float *inputs, size_t sampleCount, float *outputs) const;
+        // Loss of finished outputs against their targets: binary
+        // cross-entropy averaged over sigmoid outputs, cross-entropy summed
+        // over a softmax row, half the mean squared error otherwise. Logs
+        // are clamped away from 0 and 1. Training and evaluate() take it
+        // from the logits instead, which stays exact at saturation.
         float calculateLoss(const vector<float> &expected);
-        void train(vector<vector<float>> &trainingData, int batchSize = 32);
+        float calculateLoss(const float *outputs, const float *expected) const;
+        // Batched inference fused with the metrics: each chunk's output
+        // logits yield outputs, loss and errors in a single pass. outputs,
+        // when set, receives the size() x outputSize results.
+        Evaluation evaluate(const datasets::Dataset &data, float margin = 0.1f, float *outputs = nullptr);
+        Evaluation evaluate(InferenceContext &context, const datasets::Dataset &data, float margin = 0.1f,
+                            float *outputs = nullptr) const;
+        // Preprocessing stage applied to raw inputs by every forward and
+        // train pass as they are copied into the first layer, and saved
+        // with the model. Inputs and datasets are then given unnormalized.
+        void setInputNormalizer(const Normalizer &normalizer);
+        void clearInputNormalizer();
+        const Normalizer *getInputNormalizer() const { return inputNormalizer.get(); }
+        // Update rule used by train(); plain SGD unless replaced. Passing
+        // nullptr restores SGD.
+        void setOptimizer(unique_ptr<optimization::Optimizer> optimizer);
+        const optimization::Optimizer &getOptimizer() const { return *optimizer; }
+        // Scales the rate given to train() by epoch (see setEpoch()).
+        void setLearningRateSchedule(unique_ptr<optimization::LearningRateSchedule> schedule);
+        float getLearningRate(float baseRate) const;
 
-        void enableDeltaTracking() { trackDeltas = true; }
+        // One epoch over the samples in their current order. Returns the
+        // mean training loss, measured as each sample was trained.
+        float train(const datasets::DatasetView &trainingData, int batchSize = 32, float learningRate = 0.03f);
+        float train(const datasets::Dataset &trainingData, int batchSize = 32, float learningRate = 0.03f);
+        // One epoch over the batches the pipeline delivers, in the
+        // pipeline's batch size; call pipeline.startEpoch() first.
+        float train(datasets::BatchPipeline &pipeline, float learningRate = 0.03f);
+
+        // Replaces the tracker (dropping retained records) and enables it.
+        void configureDeltaTracking(const tracking::TrackingOptions &options);
+        // Enables tracking, with default options if none were configured.
+        void enableDeltaTracking();
         void disableDeltaTracking() { trackDeltas = false; }
-        void clearDeltaHistory() { deltaHistory.clear(); }
+        // Streams records to sink from a background thread as they commit.
+        void setDeltaSink(unique_ptr<tracking::DeltaSink> sink);
+        void flushDeltas();
+        void clearDeltaHistory();
+        const tracking::DeltaTracker *getDeltaTracker() const { return deltaTracker.get(); }
+        // Writes the records still held in memory.
         void exportDeltasToCSV(const string &filename);
         void setEpoch(int epoch) { currentEpoch = epoch; }
 
+        // Versioned binary model file, see model_io.hpp. save() writes to a
+        // temporary file and renames it, so readers never see a partial
+        // model.
+        void save(const string &path) const;
+        // The bytes save() writes, built in image (reusing its capacity) so
+        // a background writer can put them on disk while training goes on.
+        void saveImage(vector<unsigned char> &image) const;
+        static shared_ptr<NeuralNetwork> load(const string &path, LoadMode mode = LoadMode::Map);
+
         int getInputSize() const { return inputLayer ? inputLayer->getNodeCount() : 0; }
         int getOutputSize() const { return outputLayer ? outputLayer->getNodeCount() : 0; }
         int getHiddenLayerCount() const { return hiddenLayers.size(); }
+        // Node counts from input to output.
+        vector<size_t> getLayerSizes() const;
+        // Read-only parameters: the row-major weights leaving layer `index`
+        // (0 = input, last = final hidden layer) and the biases of layer
+        // `index`.
+        const ParameterBuffer &getWeights(size_t index) const;
+        const ParameterBuffer &getBiases(size_t index) const;
+        // Activation applied to layer `index` (1 = first hidden layer, last =
+        // output). Hidden layers default to leaky ReLU and the output to
+        // sigmoid; softmax is accepted on an output of two or more nodes
+        // only. Saved with the model.
+        void setActivation(size_t index, kernels::Activation activation);
+        kernels::Activation getActivation(size_t index) const;
+        // Every weight and bias as one flat copy, layer by layer (weights
+        // leaving a layer, then its biases), e.g. to keep the best
+        // parameters seen during training and restore them later.
+        vector<float> getParameters() const;
+        void setParameters(const vector<float> &parameters);
+
+        // Parameters, optimizer state and the epoch counter, copied
+        // into state's buffers (reusing their capacity) so a background
+        // writer can save them while training goes on. The trainer fields
+        // are left alone.
+        void captureTrainingState(checkpointing::TrainingState &state) const;
+        // Inverse of captureTrainingState(); throws invalid_argument if the
+        // state was taken from a different topology or optimizer.
+        void restoreTrainingState(const checkpointing::TrainingState &state);
+
+        // Debug views over the default context's last forward/backprop: materialize a
+        // Node per entry of layer `index` (0 = input) or an Edge per weight
+        // leaving it. Slow, read-only copies.
+        vector<shared_ptr<Node>> getNodeView(size_t index) const;
+        vector<shared_ptr<Edge>> getEdgeView(size_t index) const;
     };
+
+    // The scoring training uses on one row of output logits, for models
+    // that run their own backward pass (SparseNetwork::train()): writes the
+    // activated outputs and, when deltas is set, dLoss/dlogit, and returns
+    // the row's loss. outputs may alias logits.
+    float scoreLogits(kernels::Activation activation, const float *logits, const float *expected, size_t n,
+                      float *outputs, float *deltas);
 }
\ No newline at end of file
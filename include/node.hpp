@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cmath>
 #include <memory>
 #include <vector>
 
@@ -10,6 +11,14 @@ namespace nodes
     class Node;
     class Edge;
 
+    inline float sigmoid(float x) { return 1.0f / (1.0f + exp(-x)); }
+    inline float sigmoidDerivative(float s) { return s * (1 - s); }
+    inline float relu(float x) { return (x > 0.0f) ? x : 0.01f * x; }
+    inline float reluDerivative(float x) { return (x > 0.0f) ? 1.0f : 0.01f; }
+    // Binary cross-entropy of sigmoid(z) against t, taken from the logit in
+    // log-sigmoid form so saturated outputs stay finite.
+    inline float sigmoidCrossEntropy(float z, float t) { return fmax(z, 0.0f) - z * t + log1p(exp(-fabs(z))); }
+
     class Edge
     {
     public:
@@ -39,4 +48,4 @@ namespace nodes
         void addBias();
         void reset();
     };
-}
\ No newline at end of file
+}
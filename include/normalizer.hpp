@@ -1,16 +1,42 @@
 #pragma once
+#include <cstddef>
 #include <string>
 #include <vector>
+#include "dataset.hpp"
 
 using namespace std;
 
+// Per-feature affine scaling x' = (x - offset) * scale, optionally clamped
+// to [0, 1]. Scales are kept as reciprocals, so applying it never divides.
+// Batches are row-major N x F matrices, normalized in place or into a
+// caller buffer.
 class Normalizer
 {
 private:
-    vector<float> maxValues;
+    vector<float> offsets;
+    vector<float> scales;
+    bool clampToUnit = false;
 
 public:
-    Normalizer(const vector<float> maxValues);
+    Normalizer() = default;
+    // x / maxValues[i], clamped to [0, 1].
+    Normalizer(const vector<float> &maxValues);
+    Normalizer(const vector<float> &offsets, const vector<float> &scales, bool clampToUnit = false);
 
-    vector<float> normalize(vector<float> &features) const;
+    // Maps each feature's [min, max] over the dataset to [0, 1], clamping
+    // values outside it.
+    static Normalizer fitMinMax(const datasets::Dataset &data);
+    // Zero mean and unit variance per feature.
+    static Normalizer fitStandard(const datasets::Dataset &data);
+
+    vector<float> normalize(const vector<float> &features) const;
+    // rowCount x getFeatureCount() values; inputs may equal outputs.
+    void normalize(const float *inputs, size_t rowCount, float *outputs) const;
+    void normalizeInPlace(float *values, size_t rowCount) const { normalize(values, rowCount, values); }
+
+    size_t getFeatureCount() const { return offsets.size(); }
+    bool empty() const { return offsets.empty(); }
+    const vector<float> &getOffsets() const { return offsets; }
+    const vector<float> &getScales() const { return scales; }
+    bool isClamped() const { return clampToUnit; }
 };
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "arena.hpp"
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace optimization
+{
+    // One contiguous run of parameters (a layer's weights or biases) and
+    // the gradients summed for it over the current mini-batch.
+    struct ParameterGroup
+    {
+        float *values;
+        const float *gradients;
+        size_t count;
+    };
+
+    // Turns summed gradients into parameter updates. Per-parameter state
+    // (velocities, moments) lives in one arena block laid out in group
+    // order, allocated on the first step.
+    class Optimizer
+    {
+    protected:
+        unique_ptr<memory::Arena> arena;
+        vector<vector<memory::FloatSpan>> state;
+        long stepCount = 0;
+
+        // Allocates `buffers` zeroed state spans per group the first time,
+        // and checks the groups have not changed shape since.
+        void prepareState(const vector<ParameterGroup> &groups, size_t buffers);
+
+    public:
+        virtual ~Optimizer() = default;
+
+        // gradientScale turns the summed gradients into their mean.
+        virtual void step(const vector<ParameterGroup> &groups, float learningRate, float gradientScale) = 0;
+        // Forgets all state, e.g. after the parameters were replaced.
+        void reset();
+
+        // Appends every state buffer, group by group, to values (nothing
+        // before the first stateful step), for checkpoints.
+        void saveState(vector<float> &values) const;
+        // Inverse of saveState() for the same groups; empty values restore
+        // a stateless optimizer that has taken stepCount steps.
+        void loadState(const vector<ParameterGroup> &groups, const vector<float> &values, long stepCount);
+
+        long getStepCount() const { return stepCount; }
+        virtual const char *getName() const = 0;
+    };
+
+    // Plain SGD, optionally with (Nesterov) momentum and L2 weight decay.
+    class Sgd : public Optimizer
+    {
+    private:
+        float momentum;
+        bool nesterov;
+        float weightDecay;
+
+    public:
+        explicit Sgd(float momentum = 0.0f, bool nesterov = false, float weightDecay = 0.0f);
+
+        void step(const vector<ParameterGroup> &groups, float learningRate, float gradientScale) override;
+        const char *getName() const override;
+    };
+
+    // Adam with bias correction. With decoupledWeightDecay the decay is
+    // applied to the weights directly (AdamW) instead of through the
+    // gradient.
+    class Adam : public Optimizer
+    {
+    private:
+        float beta1;
+        float beta2;
+        float epsilon;
+        float weightDecay;
+        bool decoupledWeightDecay;
+
+    public:
+        explicit Adam(float beta1 = 0.9f, float beta2 = 0.999f, float epsilon = 1e-8f, float weightDecay = 0.0f,
+                      bool decoupledWeightDecay = false);
+
+        void step(const vector<ParameterGroup> &groups, float learningRate, float gradientScale) override;
+        const char *getName() const override;
+    };
+
+    unique_ptr<Optimizer> makeAdamW(float weightDecay = 0.01f, float beta1 = 0.9f, float beta2 = 0.999f);
+
+    // Learning rate as a function of the epoch, given the rate passed to
+    // train().
+    class LearningRateSchedule
+    {
+    public:
+        virtual ~LearningRateSchedule() = default;
+        virtual float rate(int epoch, float baseRate) const = 0;
+    };
+
+    // Multiplies the rate by gamma every stepSize epochs.
+    class StepSchedule : public LearningRateSchedule
+    {
+    private:
+        int stepSize;
+        float gamma;
+
+    public:
+        StepSchedule(int stepSize, float gamma = 0.1f);
+        float rate(int epoch, float baseRate) const override;
+    };
+
+    // Cosine decay from the base rate to minimumRate over totalEpochs.
+    class CosineSchedule : public LearningRateSchedule
+    {
+    private:
+        int totalEpochs;
+        float minimumRate;
+
+    public:
+        CosineSchedule(int totalEpochs, float minimumRate = 0.0f);
+        float rate(int epoch, float baseRate) const override;
+    };
+
+    // Ramps linearly up to the rate of `after` over warmupEpochs, then
+    // follows `after` shifted by the warmup (constant if none).
+    class WarmupSchedule : public LearningRateSchedule
+    {
+    private:
+        int warmupEpochs;
+        unique_ptr<LearningRateSchedule> after;
+
+    public:
+        WarmupSchedule(int warmupEpochs, unique_ptr<LearningRateSchedule> after = nullptr);
+        float rate(int epoch, float baseRate) const override;
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+#include "arena.hpp"
+
+using namespace std;
+
+namespace layers
+{
+    // Contiguous float parameters that either own their storage or alias
+    // memory kept alive by `owner` (a network's arena or a mapped model
+    // file), so loaded weights can be used in place without copying.
+    class ParameterBuffer
+    {
+    private:
+        vector<float> storage;
+        shared_ptr<void> owner;
+        float *values = nullptr;
+        size_t count = 0;
+
+    public:
+        ParameterBuffer() = default;
+
+        ParameterBuffer(const ParameterBuffer &other) { *this = other; }
+        ParameterBuffer &operator=(const ParameterBuffer &other)
+        {
+            if (this == &other)
+                return *this;
+
+            storage = other.storage;
+            owner = other.owner;
+            values = other.owner ? other.values : storage.data();
+            count = other.count;
+            return *this;
+        }
+
+        void assign(size_t n, float value)
+        {
+            owner.reset();
+            storage.assign(n, value);
+            values = storage.data();
+            count = n;
+        }
+
+        // Carves n floats set to value from arena, which the buffer keeps
+        // alive.
+        void allocate(const shared_ptr<memory::Arena> &arena, size_t n, float value)
+        {
+            alias(arena->allocate(n), n, arena);
+            fill(begin(), end(), value);
+        }
+
+        // Aliases n floats at data; `keepAlive` owns the underlying memory.
+        void alias(float *data, size_t n, shared_ptr<void> keepAlive)
+        {
+            storage.clear();
+            storage.shrink_to_fit();
+            owner = move(keepAlive);
+            values = data;
+            count = n;
+        }
+
+        bool isAliased() const { return owner != nullptr; }
+
+        float *data() { return values; }
+        const float *data() const { return values; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        float &operator[](size_t i) { return values[i]; }
+        const float &operator[](size_t i) const { return values[i]; }
+
+        float *begin() { return values; }
+        float *end() { return values + count; }
+        const float *begin() const { return values; }
+        const float *end() const { return values + count; }
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include "inference_copy.hpp"
+#include "dataset.hpp"
+#include "kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+namespace neural_network
+{
+    // Storage format of a QuantizedNetwork's weights. Biases and
+    // activations always stay float.
+    using Precision = kernels::WeightFormat;
+
+    const char *precisionName(Precision precision);
+
+    // Post-training reduced-precision copy of a NeuralNetwork for
+    // inference. Int8 weights are quantized per layer with an asymmetric
+    // scale and zero point, w ~= scale * (q - zeroPoint). The denseReduced
+    // kernels widen weights on load and sum in float, so the weights are
+    // the only thing that loses precision.
+    class QuantizedNetwork : public InferenceCopy
+    {
+    private:
+        struct QuantizedLayer
+        {
+            size_t sourceCount;
+            size_t targetCount;
+            kernels::Activation activation;
+            // Row-major [source][target] like ParameterBuffer weights, plus
+            // kernels::reducedPadding trailing entries.
+            vector<int8_t> int8Weights;
+            vector<uint16_t> halfWeights;
+            float scale = 1.0f;
+            int32_t zeroPoint = 0;
+            vector<float> biases;
+
+            kernels::ReducedWeights weights(Precision precision) const;
+        };
+
+        Precision precision;
+        vector<QuantizedLayer> layers;
+        size_t maxWidth = 0;
+
+    public:
+        QuantizedNetwork(const NeuralNetwork &network, Precision precision);
+
+        // Layer by layer over blocks of samples, like
+        // NeuralNetwork::forwardBatch(). Scratch is allocated per call, so
+        // batch requests for throughput; safe to call from several threads
+        // at once.
+        void forward(const float *inputs, float *outputs) const;
+        void forwardBatch(const float *inputs, size_t sampleCount, float *outputs) const;
+
+        Precision getPrecision() const { return precision; }
+        int getInputSize() const { return layers.front().sourceCount; }
+        int getOutputSize() const { return layers.back().targetCount; }
+        vector<size_t> getLayerSizes() const;
+        // Bytes held by weights and biases, not counting the fixed load
+        // padding.
+        size_t getParameterBytes() const;
+    };
+
+    // How far the quantized model drifts from the float one on a dataset.
+    struct QuantizationReport
+    {
+        Precision precision;
+        size_t sampleCount = 0;
+        // Quantized vs float outputs.
+        float maxAbsoluteError = 0.0f;
+        float meanAbsoluteError = 0.0f;
+        // See CopyDrift.
+        float floatLoss = 0.0f;
+        float quantizedLoss = 0.0f;
+        size_t floatBytes = 0;
+        size_t quantizedBytes = 0;
+    };
+
+    QuantizationReport compareAccuracy(const NeuralNetwork &reference, const QuantizedNetwork &quantized,
+                                       const datasets::Dataset &data);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include "inference_copy.hpp"
+#include "dataset.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace neural_network
+{
+    // Largest magnitude among the floor(sparsity * n) smallest |weights[i]|;
+    // pruning everything at or below it removes at least that fraction.
+    // Returns -1 when nothing is to be pruned.
+    float magnitudeThreshold(const float *weights, size_t n, float sparsity);
+
+    // Sparse copy of a NeuralNetwork for inference and fine-tuning. Each
+    // weight matrix is stored as CSR over its [source][target] layout: row i
+    // holds the edges leaving source node i, as target indices and weights,
+    // so both passes do work per remaining edge instead of per source x
+    // target pair. Biases and activations stay dense. Samples run
+    // kernels::sparseLanes at a time, interleaved so every edge is one
+    // broadcast and FMA over a contiguous run of lanes (the active
+    // KernelTable's sparseForward/sparseBackward). In the benchmark this
+    // overtakes the dense kernels at about 70% sparsity.
+    class SparseNetwork : public InferenceCopy
+    {
+    private:
+        struct SparseLayer
+        {
+            size_t sourceCount;
+            size_t targetCount;
+            kernels::Activation activation;
+            // rowOffsets[i]..rowOffsets[i + 1] index the edges of source i.
+            vector<uint32_t> rowOffsets;
+            vector<uint32_t> targets;
+            vector<float> weights;
+            vector<float> biases;
+
+            kernels::SparseWeights view() const { return {rowOffsets.data(), targets.data(), weights.data()}; }
+        };
+
+        // Normalizes rows [first, first + count) of inputs into rowScratch
+        // and transposes them into lanes, zero-padding the unused lanes.
+        void loadLanes(const float *inputs, size_t count, float *rowScratch, float *lanes) const;
+
+        vector<SparseLayer> layers;
+        // Widest layer, input included; sizes the lane buffers.
+        size_t maxWidth = 0;
+
+    public:
+        // Keeps the weights that are non-zero and, per layer, above the
+        // magnitudeThreshold() for sparsity; 0 only drops weights that are
+        // already zero, e.g. after NeuralNetwork::prune().
+        explicit SparseNetwork(const NeuralNetwork &network, float sparsity = 0.0f);
+
+        // Layer by layer over blocks of sparseLanes samples. Scratch is
+        // allocated per call; safe to call from several threads at once.
+        void forward(const float *inputs, float *outputs) const;
+        void forwardBatch(const float *inputs, size_t sampleCount, float *outputs) const;
+
+        // One epoch of mini-batch SGD over data in order, scored like
+        // NeuralNetwork::train(). Only the stored edges and the biases are
+        // updated, so the sparsity pattern is kept. Returns the mean loss.
+        float train(const datasets::Dataset &data, int batchSize = 32, float learningRate = 0.03f);
+
+        int getInputSize() const { return layers.front().sourceCount; }
+        int getOutputSize() const { return layers.back().targetCount; }
+        vector<size_t> getLayerSizes() const;
+        // Stored weights across all layers, and that as a fraction of the
+        // dense weight count.
+        size_t getEdgeCount() const;
+        float getDensity() const;
+        // Bytes held by the CSR arrays and biases.
+        size_t getParameterBytes() const;
+
+        // Debug view of the edges leaving layer `index` (0 = input), like
+        // NeuralNetwork::getEdgeView() but only the stored ones; paramIndex
+        // is the edge's position in the dense matrix.
+        vector<shared_ptr<Edge>> getEdgeView(size_t index) const;
+    };
+
+    // How far the sparse model drifts from the dense one on a dataset.
+    struct SparsityReport
+    {
+        float density = 1.0f;
+        size_t sampleCount = 0;
+        // Sparse vs dense outputs.
+        float maxAbsoluteError = 0.0f;
+        float meanAbsoluteError = 0.0f;
+        // See CopyDrift.
+        float denseLoss = 0.0f;
+        float sparseLoss = 0.0f;
+        size_t denseBytes = 0;
+        size_t sparseBytes = 0;
+    };
+
+    SparsityReport compareAccuracy(const NeuralNetwork &reference, const SparseNetwork &sparse,
+                                   const datasets::Dataset &data);
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include "node.hpp"
+#include "activation.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace neural_network
+{
+    // Fixed-topology network for inference, e.g. StaticNetwork<3, 4, 4, 1>.
+    // Layer sizes are template arguments, so every loop bound is a
+    // constant, the parameters live inline in one array and forward() never
+    // allocates. Activations are copied per layer from the NeuralNetwork it
+    // is built from once training is done (leaky ReLU hidden layers and a
+    // sigmoid output by default) and resolved once per layer, not per value.
+    template <size_t... Sizes>
+    class StaticNetwork
+    {
+    public:
+        static constexpr size_t layerCount = sizeof...(Sizes);
+        static_assert(layerCount >= 2, "StaticNetwork needs at least an input and an output layer");
+
+        static constexpr array<size_t, layerCount> layerSizes = {Sizes...};
+        static constexpr size_t inputSize = layerSizes[0];
+        static constexpr size_t outputSize = layerSizes[layerCount - 1];
+
+    private:
+        // Per transition l: weights leaving layer l ([node][nextNode]),
+        // then the biases of layer l + 1.
+        static constexpr size_t weightOffset(size_t l)
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i < l; ++i)
+                offset += layerSizes[i] * layerSizes[i + 1] + layerSizes[i + 1];
+            return offset;
+        }
+
+        static constexpr size_t biasOffset(size_t l)
+        {
+            return weightOffset(l) + layerSizes[l] * layerSizes[l + 1];
+        }
+
+        static constexpr array<kernels::Activation, layerCount - 1> defaultActivations()
+        {
+            array<kernels::Activation, layerCount - 1> defaults{};
+            for (size_t l = 0; l + 1 < layerCount; ++l)
+                defaults[l] = (l + 2 == layerCount) ? kernels::Activation::Sigmoid : kernels::Activation::LeakyRelu;
+            return defaults;
+        }
+
+        static constexpr size_t maxWidth()
+        {
+            size_t width = 1;
+            for (size_t l = 1; l < layerCount; ++l)
+                width = layerSizes[l] > width ? layerSizes[l] : width;
+            return width;
+        }
+
+    public:
+        static constexpr size_t parameterCount = weightOffset(layerCount - 1);
+
+    private:
+        alignas(64) array<float, parameterCount> parameters{};
+        // Applied to the targets of transition l.
+        array<kernels::Activation, layerCount - 1> activations = defaultActivations();
+        // Copy of the network's input normalizer, if it has one.
+        array<float, inputSize> inputOffsets{};
+        array<float, inputSize> inputScales{};
+        bool normalizeInputs = false;
+        bool clampInputs = false;
+
+        template <size_t... I, typename F>
+        static inline void unroll(index_sequence<I...>, F &&body)
+        {
+            (body(integral_constant<size_t, I>{}), ...);
+        }
+
+        template <size_t L>
+        inline void forwardLayer(const float *sources, float *targets) const
+        {
+            constexpr size_t sourceCount = layerSizes[L];
+            constexpr size_t targetCount = layerSizes[L + 1];
+            const float *weights = parameters.data() + weightOffset(L);
+            const float *biases = parameters.data() + biasOffset(L);
+
+            array<float, targetCount> sums;
+            for (size_t j = 0; j < targetCount; ++j)
+                sums[j] = biases[j];
+
+            unroll(make_index_sequence<sourceCount>{}, [&](auto i)
+                   {
+                       const float value = sources[i];
+                       const float *row = weights + i * targetCount;
+                       for (size_t j = 0; j < targetCount; ++j)
+                           sums[j] += value * row[j]; });
+
+            kernels::withActivation(activations[L], [&](auto a)
+                                    {
+                                        constexpr kernels::Activation A = decltype(a)::value;
+                                        float derivative;
+                                        for (size_t j = 0; j < targetCount; ++j)
+                                            targets[j] = kernels::activate<A>(sums[j], derivative);
+
+                                        if constexpr (A == kernels::Activation::Softmax)
+                                        {
+                                            const float peak = *max_element(targets, targets + targetCount);
+                                            float sum = 0.0f;
+                                            for (size_t j = 0; j < targetCount; ++j)
+                                                sum += targets[j] = exp(targets[j] - peak);
+                                            for (size_t j = 0; j < targetCount; ++j)
+                                                targets[j] /= sum;
+                                        } });
+        }
+
+        template <size_t... L>
+        inline void forwardLayers(const float *inputs, float *outputs, index_sequence<L...>) const
+        {
+            array<float, maxWidth()> buffers[2];
+            const float *sources = inputs;
+            ((forwardLayer<L>(sources, (L + 2 == layerCount) ? outputs : buffers[L % 2].data()),
+              sources = buffers[L % 2].data()),
+             ...);
+        }
+
+    public:
+        StaticNetwork() = default;
+
+        // Copies the parameters (and input normalizer) of a trained network;
+        // throws if its layer sizes differ from the template arguments.
+        explicit StaticNetwork(const NeuralNetwork &network)
+        {
+            vector<size_t> sizes = network.getLayerSizes();
+            if (sizes.size() != layerCount || !equal(sizes.begin(), sizes.end(), layerSizes.begin()))
+                throw invalid_argument("Network topology doesn't match StaticNetwork layer sizes");
+
+            for (size_t l = 0; l + 1 < layerCount; ++l)
+            {
+                const ParameterBuffer &weights = network.getWeights(l);
+                const ParameterBuffer &biases = network.getBiases(l + 1);
+                copy(weights.begin(), weights.end(), parameters.begin() + weightOffset(l));
+                copy(biases.begin(), biases.end(), parameters.begin() + biasOffset(l));
+                activations[l] = network.getActivation(l + 1);
+            }
+
+            if (const Normalizer *normalizer = network.getInputNormalizer())
+            {
+                copy(normalizer->getOffsets().begin(), normalizer->getOffsets().end(), inputOffsets.begin());
+                copy(normalizer->getScales().begin(), normalizer->getScales().end(), inputScales.begin());
+                normalizeInputs = true;
+                clampInputs = normalizer->isClamped();
+            }
+        }
+
+        // Reads a model file written by NeuralNetwork::save().
+        static StaticNetwork load(const string &path)
+        {
+            return StaticNetwork(*NeuralNetwork::load(path, LoadMode::Map));
+        }
+
+        inline void forward(const float *inputs, float *outputs) const
+        {
+            if (!normalizeInputs)
+                return forwardLayers(inputs, outputs, make_index_sequence<layerCount - 1>{});
+
+            array<float, inputSize> normalized;
+            for (size_t i = 0; i < inputSize; ++i)
+            {
+                normalized[i] = (inputs[i] - inputOffsets[i]) * inputScales[i];
+                if (clampInputs)
+                    normalized[i] = min(max(normalized[i], 0.0f), 1.0f);
+            }
+            forwardLayers(normalized.data(), outputs, make_index_sequence<layerCount - 1>{});
+        }
+
+        inline array<float, outputSize> forward(const array<float, inputSize> &inputs) const
+        {
+            array<float, outputSize> outputs;
+            forward(inputs.data(), outputs.data());
+            return outputs;
+        }
+
+        // sampleCount row-major input rows to sampleCount x outputSize results.
+        void forwardBatch(const float *inputs, size_t sampleCount, float *outputs) const
+        {
+            for (size_t i = 0; i < sampleCount; ++i)
+                forward(inputs + i * inputSize, outputs + i * outputSize);
+        }
+
+        const array<float, parameterCount> &getParameters() const { return parameters; }
+    };
+}
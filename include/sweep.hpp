@@ -0,0 +1,62 @@
+#pragma once
+
+#include "trainer.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace training
+{
+    // One point of a hyperparameter sweep.
+    struct SweepConfiguration
+    {
+        int hiddenLayerCount;
+        int hiddenLayerSize;
+        float learningRate;
+        int batchSize;
+    };
+
+    struct SweepOptions
+    {
+        // Applied to every run; learningRate and batchSize come from each
+        // configuration instead. The shared seed gives every run the same
+        // batch order. A checkpointPath or statePath gets the configuration's
+        // index appended ("best.nnm" becomes "best.nnm.3"), so concurrent
+        // runs never share a file and a rerun of the same grid resumes each
+        // configuration from its own state.
+        TrainingOptions training;
+        // A run's time to target is taken at the first evaluation with a
+        // validation loss at or below this; 0 disables it.
+        float targetLoss = 0.0f;
+        // Concurrent runs; 0 uses every hardware thread.
+        size_t threadCount = 0;
+        // Called on each fresh network before it trains, e.g. to set an
+        // optimizer or schedule. Runs concurrently from several threads.
+        function<void(neural_network::NeuralNetwork &, const SweepConfiguration &)> configure;
+    };
+
+    struct SweepResult
+    {
+        SweepConfiguration configuration;
+        TrainingResult training;
+        // Wall time of the whole run.
+        double seconds = 0.0;
+        // Negative when the run never reached SweepOptions::targetLoss.
+        double secondsToTarget = -1.0;
+        int epochToTarget = -1;
+    };
+
+    // Every combination of the given values.
+    vector<SweepConfiguration> makeGrid(const vector<int> &hiddenLayerCounts, const vector<int> &hiddenLayerSizes,
+                                        const vector<float> &learningRates, const vector<int> &batchSizes);
+
+    // Trains one single-threaded network per configuration, several at
+    // once, all reading the same datasets. Throughput comes from running
+    // experiments side by side rather than from splitting one model across
+    // cores. Results follow the configuration order.
+    vector<SweepResult> runSweep(const vector<SweepConfiguration> &configurations,
+                                 const datasets::Dataset &trainingData, const datasets::Dataset &validationData,
+                                 const SweepOptions &options = SweepOptions());
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace threading
+{
+    // Fixed set of worker threads that run indexed tasks in lock-step.
+    // The calling thread takes part, so a pool of N keeps N - 1 threads.
+    class ThreadPool
+    {
+    private:
+        vector<thread> workers;
+        mutex lock;
+        condition_variable wake;
+        condition_variable finished;
+
+        const function<void(size_t)> *task;
+        size_t taskCount;
+        size_t nextTask;
+        size_t pendingTasks;
+        unsigned long generation;
+        bool stopping;
+        exception_ptr failure;
+
+        void workerLoop();
+        void runTasks(unique_lock<mutex> &guard);
+
+    public:
+        ThreadPool(size_t threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t getThreadCount() const { return workers.size() + 1; }
+
+        // Runs task(0) .. task(taskCount - 1) and returns once all have
+        // finished. The first exception thrown by a task is rethrown here.
+        void run(size_t taskCount, const function<void(size_t)> &task);
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "neural_network.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace training
+{
+    struct TrainingOptions
+    {
+        int maxEpochs = 100;
+        int batchSize = 32;
+        float learningRate = 0.01f;
+        // Epochs between validation passes; the last epoch is always
+        // evaluated.
+        int evaluationInterval = 1;
+        // Evaluations without improvement before training stops; 0 never
+        // stops early.
+        int patience = 10;
+        // How much the validation loss has to drop to count as improvement.
+        float minDelta = 1e-4f;
+        // Put the best parameters back into the network when fit() returns.
+        bool restoreBest = true;
+        // Also save the network here whenever validation loss improves, on
+        // a background thread like the state file.
+        string checkpointPath;
+        // Full training state (parameters, optimizer state, counters and
+        // early-stopping bookkeeping) is written here every stateInterval
+        // epochs, on a background thread. If the file already exists fit()
+        // resumes from it instead of starting over.
+        string statePath;
+        int stateInterval = 1;
+        // Reshuffle the training set before every epoch. Both only apply
+        // to fit(Dataset), a caller's pipeline brings its own batching.
+        bool shuffle = true;
+        unsigned seed = 42;
+    };
+
+    struct EpochReport
+    {
+        int epoch;
+        // Mean loss over the epoch's samples as they were trained.
+        float trainingLoss;
+        bool evaluated;
+        float validationLoss;
+        bool improved;
+        // Evaluations in a row without improvement.
+        int staleEvaluations;
+    };
+
+    struct TrainingResult
+    {
+        int epochsRun = 0;
+        int bestEpoch = -1;
+        float bestLoss = 0.0f;
+        bool stoppedEarly = false;
+        vector<EpochReport> history;
+    };
+
+    // Epoch loop around NeuralNetwork::train(): evaluates a validation set
+    // through the batched inference path every evaluationInterval epochs,
+    // keeps the parameters with the lowest validation loss and stops once
+    // it has not improved for `patience` evaluations.
+    class Trainer
+    {
+    private:
+        neural_network::NeuralNetwork &network;
+        TrainingOptions options;
+        function<void(const EpochReport &)> epochCallback;
+
+        // Reused by every evaluation, so periodic validation never
+        // allocates.
+        neural_network::InferenceContext context;
+
+    public:
+        Trainer(neural_network::NeuralNetwork &network, const TrainingOptions &options = TrainingOptions());
+
+        // Called after every epoch, evaluated or not.
+        void setEpochCallback(function<void(const EpochReport &)> callback) { epochCallback = move(callback); }
+
+        // Without validation data every epoch runs and nothing is restored.
+        // A resumed fit() reports only the epochs it ran itself in history;
+        // epochsRun counts from the original start.
+        // Batches are assembled on a background thread: the next epoch
+        // starts preparing while the current one is validated.
+        TrainingResult fit(const datasets::Dataset &trainingData, const datasets::Dataset &validationData);
+        // Trains on whatever the pipeline streams, in its batch size.
+        TrainingResult fit(datasets::BatchPipeline &trainingData, const datasets::Dataset &validationData);
+        // Mean loss over the dataset, from NeuralNetwork::evaluate().
+        float evaluate(const datasets::Dataset &data);
+
+        const TrainingOptions &getOptions() const { return options; }
+    };
+}
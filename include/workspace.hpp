@@ -0,0 +1,62 @@
+#pragma once
+
+#include "arena.hpp"
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace neural_network
+{
+    // Per-thread activation and gradient scratch for one network topology.
+    // Index 0 is the input layer and the last entry the output layer;
+    // weightGradients[l] matches the weights leaving layer l. All buffers
+    // are spans into a single arena block, and copies get their own block.
+    // Weight gradients are as large as the weights, so a workspace built
+    // without them (inference) only gets them from allocateGradients().
+    struct Workspace
+    {
+        unique_ptr<memory::Arena> arena;
+        vector<memory::FloatSpan> values;
+        // Activation derivatives cached by training forward passes so the
+        // backward pass can scale deltas without re-deriving them.
+        vector<memory::FloatSpan> derivatives;
+        vector<memory::FloatSpan> deltas;
+        vector<memory::FloatSpan> weightGradients;
+        vector<memory::FloatSpan> biasGradients;
+
+        Workspace() = default;
+        Workspace(const vector<size_t> &layerSizes, bool weightGradients = true);
+        Workspace(const Workspace &other);
+        Workspace &operator=(const Workspace &other);
+        Workspace(Workspace &&) = default;
+        Workspace &operator=(Workspace &&) = default;
+
+        size_t getLayerCount() const { return values.size(); }
+        vector<size_t> getLayerSizes() const;
+        // Adds zeroed weight gradients, unless already there.
+        void allocateGradients();
+        bool hasGradients() const { return weightGradients.size() + 1 == values.size(); }
+        void resetGradients();
+    };
+
+    // Per-thread activation state for inference against a shared, const
+    // NeuralNetwork. Create one per serving thread with
+    // NeuralNetwork::createInferenceContext(); no locking is needed.
+    struct InferenceContext
+    {
+        Workspace workspace;
+        // Ping-pong activation tiles reused across forwardBatch calls.
+        vector<float> batchBuffers[2];
+        // Chunk of normalized inputs when the network has an input stage.
+        vector<float> normalizedInputs;
+        // Output logits of the chunk being evaluated.
+        vector<float> logits;
+
+        InferenceContext() = default;
+        InferenceContext(const vector<size_t> &layerSizes);
+
+        const memory::FloatSpan &getOutputs() const { return workspace.values.back(); }
+        bool matches(const vector<size_t> &layerSizes) const;
+    };
+}
@@ -0,0 +1,103 @@
+import struct
+
+import numpy as np
+
+
+MAGIC = b"NNDELTA\0"
+VERSION = 1
+MODES = {0: "samples", 1: "batch_summary"}
+
+
+class DeltaLog:
+    """
+    Reader for the append-only binary delta log written by BinaryDeltaSink.
+
+    The log starts with a small header (magic, version, tracking mode and
+    layer sizes) followed by fixed-size records. Because the trainer appends
+    and flushes records while it runs, the log can be read at any time; a
+    partially written trailing record is ignored.
+    """
+
+    def __init__(self, path):
+        """
+        Parses the header and maps every complete record.
+
+        Args:
+            path (str): Path to the .bin log.
+
+        Raises:
+            ValueError: If the file is not a delta log of a supported version.
+        """
+        with open(path, "rb") as log_file:
+            data = log_file.read()
+
+        if len(data) < 24 or data[:8] != MAGIC:
+            raise ValueError(f"{path} is not a delta log")
+
+        version, mode, layer_count, value_count = struct.unpack_from("<4I", data, 8)
+        if version != VERSION:
+            raise ValueError(f"Unsupported delta log version {version}")
+
+        self.mode = MODES.get(mode, str(mode))
+        self.layer_sizes = list(struct.unpack_from(f"<{layer_count}I", data, 24))
+        self.value_count = value_count
+
+        header_size = (24 + 4 * layer_count + 7) // 8 * 8
+        self.dtype = np.dtype([
+            ("epoch", "<i4"),
+            ("sample_count", "<u4"),
+            ("sample", "<i8"),
+            ("loss", "<f4"),
+            ("input_weight", "<f4"),
+            ("hidden_weight", "<f4"),
+            ("reserved", "<u4"),
+            ("values", "<f4", (value_count,)),
+        ])
+
+        record_count = (len(data) - header_size) // self.dtype.itemsize
+        self.records = np.frombuffer(data, dtype=self.dtype, count=record_count, offset=header_size)
+
+    def column_names(self):
+        """
+        Returns the per-node column prefixes in the same order as the CSV
+        export: input, hidden0..hiddenN, output.
+        """
+        names = []
+        last = len(self.layer_sizes) - 1
+        for layer, size in enumerate(self.layer_sizes):
+            prefix = "input" if layer == 0 else "output" if layer == last else f"hidden{layer - 1}"
+            names.extend(f"{prefix}_{{}}_{i}" for i in range(size))
+        return names
+
+    def to_dataframe(self):
+        """
+        Builds a DataFrame with the columns of the legacy deltas.csv
+        (epoch, sample, loss, *_delta_*, input_weight_0, hidden0_weight_0)
+        plus sample_count and the *_maxabs_* columns.
+        """
+        import pandas as pd
+
+        names = self.column_names()
+        node_count = len(names)
+        values = self.records["values"]
+
+        columns = {
+            "epoch": self.records["epoch"],
+            "sample": self.records["sample"],
+            "loss": self.records["loss"],
+        }
+        for i, name in enumerate(names):
+            columns[name.format("delta")] = values[:, i]
+        columns["input_weight_0"] = self.records["input_weight"]
+        columns["hidden0_weight_0"] = self.records["hidden_weight"]
+        columns["sample_count"] = self.records["sample_count"]
+        for i, name in enumerate(names):
+            columns[name.format("maxabs")] = values[:, node_count + i]
+
+        return pd.DataFrame(columns)
+
+
+def is_delta_log(path):
+    """Returns True if the file starts with the delta log magic."""
+    with open(path, "rb") as log_file:
+        return log_file.read(len(MAGIC)) == MAGIC
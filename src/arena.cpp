@@ -0,0 +1,65 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace memory
+{
+    size_t Arena::paddedSize(size_t count)
+    {
+        const size_t floatsPerLine = alignment / sizeof(float);
+        return (count + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    }
+
+    Arena::Arena(size_t initialSize) : blockSize(paddedSize(initialSize > 0 ? initialSize : 1))
+    {
+        addBlock(blockSize);
+    }
+
+    Arena::~Arena()
+    {
+        for (Block &block : blocks)
+            free(block.data);
+    }
+
+    void Arena::addBlock(size_t floatCount)
+    {
+        float *data = static_cast<float *>(aligned_alloc(alignment, floatCount * sizeof(float)));
+        if (!data)
+            throw bad_alloc();
+
+        memset(data, 0, floatCount * sizeof(float));
+        blocks.push_back({data, floatCount, 0});
+    }
+
+    float *Arena::allocate(size_t count)
+    {
+        const size_t padded = paddedSize(count);
+        if (blocks.back().capacity - blocks.back().used < padded)
+            addBlock(max(blockSize, padded));
+
+        Block &block = blocks.back();
+        float *result = block.data + block.used;
+        block.used += padded;
+        return result;
+    }
+
+    size_t Arena::getCapacity() const
+    {
+        size_t total = 0;
+        for (const Block &block : blocks)
+            total += block.capacity;
+        return total;
+    }
+
+    size_t Arena::getUsed() const
+    {
+        size_t total = 0;
+        for (const Block &block : blocks)
+            total += block.used;
+        return total;
+    }
+}
@@ -0,0 +1,237 @@
+#include "checkpoint.hpp"
+#include "model_io.hpp"
+#include "mapped_file.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace checkpointing
+{
+    namespace
+    {
+        const uint32_t maxLayerCount = 4096;
+        const uint32_t maxNameLength = 64;
+
+        template <typename T>
+        void writeArray(ofstream &file, const T *values, size_t count)
+        {
+            file.write(reinterpret_cast<const char *>(values), count * sizeof(T));
+        }
+
+        template <typename T>
+        void readArray(ifstream &file, T *values, size_t count)
+        {
+            file.read(reinterpret_cast<char *>(values), count * sizeof(T));
+            if (!file)
+                throw runtime_error("Checkpoint file is truncated");
+        }
+    }
+
+    void writeCheckpoint(const string &path, const TrainingState &state)
+    {
+        CheckpointHeader header = {};
+        memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+        header.version = checkpointVersion;
+        header.endianTag = model_io::endianTag;
+        header.layerCount = state.layerSizes.size();
+        header.nameLength = state.optimizerName.size();
+        header.optimizerSteps = state.optimizerSteps;
+        header.epoch = state.epoch;
+        header.nextEpoch = state.nextEpoch;
+        header.bestEpoch = state.bestEpoch;
+        header.staleEvaluations = state.staleEvaluations;
+        header.bestLoss = state.bestLoss;
+        header.parameterCount = state.parameters.size();
+        header.optimizerStateCount = state.optimizerState.size();
+        header.bestParameterCount = state.bestParameters.size();
+
+        vector<uint32_t> layerSizes(state.layerSizes.begin(), state.layerSizes.end());
+
+        const string temporaryPath = path + ".tmp";
+        {
+            ofstream file(temporaryPath, ios::binary | ios::trunc);
+            if (!file.is_open())
+                throw runtime_error("Could not open checkpoint file: " + temporaryPath);
+
+            writeArray(file, &header, 1);
+            writeArray(file, layerSizes.data(), layerSizes.size());
+            writeArray(file, state.optimizerName.data(), state.optimizerName.size());
+            writeArray(file, state.parameters.data(), state.parameters.size());
+            writeArray(file, state.optimizerState.data(), state.optimizerState.size());
+            writeArray(file, state.bestParameters.data(), state.bestParameters.size());
+            if (!file.flush())
+                throw runtime_error("Could not write checkpoint file: " + temporaryPath);
+        }
+
+        if (!io::commitFile(temporaryPath, path))
+            throw runtime_error("Could not replace checkpoint file: " + path);
+    }
+
+    TrainingState readCheckpoint(const string &path)
+    {
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file.is_open())
+            throw runtime_error("Could not open checkpoint file: " + path);
+        const uint64_t fileSize = file.tellg();
+        file.seekg(0);
+
+        CheckpointHeader header;
+        readArray(file, &header, 1);
+        if (memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0)
+            throw runtime_error("Not a checkpoint file");
+        if (header.version != checkpointVersion)
+            throw runtime_error("Unsupported checkpoint version " + to_string(header.version));
+        if (header.endianTag != model_io::endianTag)
+            throw runtime_error("Checkpoint was written on an incompatible platform");
+        if (header.layerCount < 2 || header.layerCount > maxLayerCount || header.nameLength > maxNameLength)
+            throw runtime_error("Checkpoint file has an invalid header");
+
+        // Checked before allocating, so a corrupt count can't ask for more
+        // memory than the file could hold. Each count is bounded first so
+        // the sum below can't wrap around.
+        const uint64_t maxFloatCount = fileSize / sizeof(float);
+        if (header.parameterCount > maxFloatCount || header.optimizerStateCount > maxFloatCount ||
+            header.bestParameterCount > maxFloatCount)
+            throw runtime_error("Checkpoint file is truncated");
+        const uint64_t payload = header.layerCount * sizeof(uint32_t) + header.nameLength +
+                                 (header.parameterCount + header.optimizerStateCount + header.bestParameterCount) *
+                                     sizeof(float);
+        if (fileSize != sizeof(header) + payload)
+            throw runtime_error("Checkpoint file is truncated");
+
+        TrainingState state;
+        vector<uint32_t> layerSizes(header.layerCount);
+        readArray(file, layerSizes.data(), layerSizes.size());
+        state.layerSizes.assign(layerSizes.begin(), layerSizes.end());
+
+        state.optimizerName.resize(header.nameLength);
+        readArray(file, &state.optimizerName[0], state.optimizerName.size());
+        state.parameters.resize(header.parameterCount);
+        readArray(file, state.parameters.data(), state.parameters.size());
+        state.optimizerState.resize(header.optimizerStateCount);
+        readArray(file, state.optimizerState.data(), state.optimizerState.size());
+        state.bestParameters.resize(header.bestParameterCount);
+        readArray(file, state.bestParameters.data(), state.bestParameters.size());
+
+        state.optimizerSteps = header.optimizerSteps;
+        state.epoch = header.epoch;
+        state.nextEpoch = header.nextEpoch;
+        state.bestEpoch = header.bestEpoch;
+        state.staleEvaluations = header.staleEvaluations;
+        state.bestLoss = header.bestLoss;
+        return state;
+    }
+
+    bool checkpointExists(const string &path)
+    {
+        return ifstream(path, ios::binary).is_open();
+    }
+
+    template <typename Snapshot>
+    SnapshotWriter<Snapshot>::SnapshotWriter(const string &path, WriteFunction write) : path(path), write(write)
+    {
+        if (path.empty())
+            throw invalid_argument("Snapshot writer needs a path");
+        worker = thread(&SnapshotWriter::run, this);
+    }
+
+    template <typename Snapshot>
+    SnapshotWriter<Snapshot>::~SnapshotWriter()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    template <typename Snapshot>
+    void SnapshotWriter<Snapshot>::run()
+    {
+        // The worker owns this buffer while writing; it is handed back to
+        // the trainer on the next submit.
+        Snapshot writingSnapshot;
+        unique_lock<mutex> guard(lock);
+
+        while (true)
+        {
+            wake.wait(guard, [&]
+                      { return stopping || hasPending; });
+            if (!hasPending)
+                return;
+
+            swap(writingSnapshot, pending);
+            hasPending = false;
+            writing = true;
+
+            guard.unlock();
+            exception_ptr error;
+            try
+            {
+                write(path, writingSnapshot);
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+            guard.lock();
+
+            writing = false;
+            if (error)
+                failure = error;
+            else
+                ++writtenCount;
+            idle.notify_all();
+        }
+    }
+
+    template <typename Snapshot>
+    void SnapshotWriter<Snapshot>::rethrowFailure()
+    {
+        if (failure)
+        {
+            exception_ptr error = failure;
+            failure = nullptr;
+            rethrow_exception(error);
+        }
+    }
+
+    template <typename Snapshot>
+    void SnapshotWriter<Snapshot>::submit(Snapshot &snapshot)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            rethrowFailure();
+            // Whatever was waiting is superseded; its buffers come back.
+            swap(pending, snapshot);
+            hasPending = true;
+        }
+        wake.notify_one();
+    }
+
+    template <typename Snapshot>
+    void SnapshotWriter<Snapshot>::flush()
+    {
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [&]
+                  { return !hasPending && !writing; });
+        rethrowFailure();
+    }
+
+    template <typename Snapshot>
+    size_t SnapshotWriter<Snapshot>::getWrittenCount()
+    {
+        lock_guard<mutex> guard(lock);
+        return writtenCount;
+    }
+
+    template class SnapshotWriter<TrainingState>;
+    template class SnapshotWriter<vector<unsigned char>>;
+
+    CheckpointWriter::CheckpointWriter(const string &path) : SnapshotWriter(path, writeCheckpoint) {}
+
+    ModelWriter::ModelWriter(const string &path) : SnapshotWriter(path, model_io::writeModelFile) {}
+}
@@ -0,0 +1,248 @@
+#include "csv_reader.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace io
+{
+    namespace
+    {
+        // Below this much text per thread, extra parser threads cost more
+        // than they save.
+        const size_t minimumChunkBytes = 1 << 20;
+        // Consumed text a CsvStream keeps mapped before releasing it.
+        const size_t releaseBytes = 16 << 20;
+
+        struct ParsedChunk
+        {
+            vector<float> features;
+            vector<float> targets;
+            size_t rowCount = 0;
+            size_t skippedRows = 0;
+        };
+
+        inline bool isBlank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        const char *findLineEnd(const char *p, const char *end)
+        {
+            const void *newline = memchr(p, '\n', end - p);
+            return newline ? static_cast<const char *>(newline) : end;
+        }
+
+        bool isBlankLine(const char *p, const char *end)
+        {
+            return all_of(p, end, isBlank);
+        }
+
+        size_t countColumns(const char *p, const char *end)
+        {
+            return 1 + count(p, end, ',');
+        }
+
+        // Parses exactly columnCount comma-separated floats into row.
+        bool parseLine(const char *p, const char *end, float *row, size_t columnCount)
+        {
+            size_t column = 0;
+            while (true)
+            {
+                if (column == columnCount)
+                    return false;
+
+                while (p < end && isBlank(*p))
+                    ++p;
+                // from_chars rejects a leading '+'
+                if (p < end && *p == '+')
+                    ++p;
+
+                from_chars_result result = from_chars(p, end, row[column]);
+                if (result.ec != errc())
+                    return false;
+                p = result.ptr;
+                ++column;
+
+                while (p < end && isBlank(*p))
+                    ++p;
+                if (p == end)
+                    break;
+                if (*p != ',')
+                    return false;
+                ++p;
+            }
+            return column == columnCount;
+        }
+
+        void parseChunk(const char *p, const char *end, size_t columnCount, size_t targetColumns, ParsedChunk &chunk)
+        {
+            const size_t featureCount = columnCount - targetColumns;
+            vector<float> row(columnCount);
+
+            while (p < end)
+            {
+                const char *lineEnd = findLineEnd(p, end);
+
+                if (!isBlankLine(p, lineEnd))
+                {
+                    if (parseLine(p, lineEnd, row.data(), columnCount))
+                    {
+                        chunk.features.insert(chunk.features.end(), row.begin(), row.begin() + featureCount);
+                        chunk.targets.insert(chunk.targets.end(), row.begin() + featureCount, row.end());
+                        ++chunk.rowCount;
+                    }
+                    else
+                    {
+                        ++chunk.skippedRows;
+                    }
+                }
+
+                p = (lineEnd < end) ? lineEnd + 1 : end;
+            }
+        }
+
+        // Skips the byte order mark, leading blank lines and the header, and
+        // returns the first data row along with the column count.
+        const char *skipPreamble(const char *p, const char *end, const CsvOptions &options, size_t &columnCount)
+        {
+            // UTF-8 byte order mark, as written by some spreadsheet exports.
+            if (end - p >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+                p += 3;
+
+            while (p < end && isBlankLine(p, findLineEnd(p, end)))
+                p = min(findLineEnd(p, end) + 1, end);
+
+            const char *firstLineEnd = findLineEnd(p, end);
+            columnCount = countColumns(p, firstLineEnd);
+            if (options.skipHeader)
+                p = min(firstLineEnd + 1, end);
+
+            if (options.targetColumns > columnCount)
+                throw invalid_argument("CSV has fewer columns than requested targets");
+            return p;
+        }
+    }
+
+    CsvTable readCsv(const string &path, const CsvOptions &options)
+    {
+        MappedFile file(path);
+        file.adviseSequential();
+
+        const char *end = reinterpret_cast<const char *>(file.data()) + file.size();
+        size_t columnCount;
+        const char *p = skipPreamble(reinterpret_cast<const char *>(file.data()), end, options, columnCount);
+
+        CsvTable table;
+        table.featureCount = columnCount - options.targetColumns;
+        table.targetCount = options.targetColumns;
+
+        size_t threadCount = options.threadCount ? options.threadCount : max(1u, thread::hardware_concurrency());
+        const size_t chunkCount = max<size_t>(1, min(threadCount, static_cast<size_t>(end - p) / minimumChunkBytes));
+
+        if (chunkCount == 1)
+        {
+            ParsedChunk chunk;
+            parseChunk(p, end, columnCount, options.targetColumns, chunk);
+
+            table.rowCount = chunk.rowCount;
+            table.skippedRows = chunk.skippedRows;
+            table.features = move(chunk.features);
+            table.targets = move(chunk.targets);
+            return table;
+        }
+
+        // Split on line boundaries; each chunk starts right after a newline.
+        vector<const char *> bounds(chunkCount + 1);
+        bounds[0] = p;
+        bounds[chunkCount] = end;
+        for (size_t c = 1; c < chunkCount; ++c)
+        {
+            const char *guess = max(bounds[c - 1], p + (end - p) * c / chunkCount);
+            bounds[c] = min(findLineEnd(guess, end) + 1, end);
+        }
+
+        vector<ParsedChunk> chunks(chunkCount);
+        threading::ThreadPool pool(chunkCount);
+        pool.run(chunkCount, [&](size_t c)
+                 { parseChunk(bounds[c], bounds[c + 1], columnCount, options.targetColumns, chunks[c]); });
+
+        vector<size_t> firstRows(chunkCount);
+        for (size_t c = 0; c < chunkCount; ++c)
+        {
+            firstRows[c] = table.rowCount;
+            table.rowCount += chunks[c].rowCount;
+            table.skippedRows += chunks[c].skippedRows;
+        }
+
+        table.features.resize(table.rowCount * table.featureCount);
+        table.targets.resize(table.rowCount * table.targetCount);
+        pool.run(chunkCount, [&](size_t c)
+                 {
+                     copy(chunks[c].features.begin(), chunks[c].features.end(),
+                          table.features.begin() + firstRows[c] * table.featureCount);
+                     copy(chunks[c].targets.begin(), chunks[c].targets.end(),
+                          table.targets.begin() + firstRows[c] * table.targetCount);
+                     vector<float>().swap(chunks[c].features);
+                     vector<float>().swap(chunks[c].targets); });
+
+        return table;
+    }
+
+    CsvStream::CsvStream(const string &path, const CsvOptions &options) : file(make_unique<MappedFile>(path))
+    {
+        file->adviseSequential();
+
+        const char *begin = reinterpret_cast<const char *>(file->data());
+        end = begin + file->size();
+        firstRow = skipPreamble(begin, end, options, columnCount);
+        featureCount = columnCount - options.targetColumns;
+        position = firstRow;
+        retained = begin;
+        row.resize(columnCount);
+    }
+
+    size_t CsvStream::read(float *features, float *targets, size_t maxRows)
+    {
+        size_t rowCount = 0;
+        while (rowCount < maxRows && position < end)
+        {
+            const char *lineEnd = findLineEnd(position, end);
+
+            if (!isBlankLine(position, lineEnd))
+            {
+                if (parseLine(position, lineEnd, row.data(), columnCount))
+                {
+                    copy(row.begin(), row.begin() + featureCount, features + rowCount * featureCount);
+                    copy(row.begin() + featureCount, row.end(), targets + rowCount * getTargetCount());
+                    ++rowCount;
+                }
+                else
+                {
+                    ++skippedRows;
+                }
+            }
+
+            position = (lineEnd < end) ? lineEnd + 1 : end;
+        }
+
+        if (static_cast<size_t>(position - retained) >= releaseBytes)
+        {
+            const char *begin = reinterpret_cast<const char *>(file->data());
+            file->release(retained - begin, position - retained);
+            retained = position;
+        }
+        return rowCount;
+    }
+
+    void CsvStream::rewind()
+    {
+        position = firstRow;
+        retained = reinterpret_cast<const char *>(file->data());
+        skippedRows = 0;
+    }
+}
@@ -0,0 +1,226 @@
+#include "data_pipeline.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace datasets
+{
+    void Batch::resize(size_t rowCount, size_t featureCount, size_t targetCount)
+    {
+        this->rows = rowCount;
+        this->featureCount = featureCount;
+        this->targetCount = targetCount;
+        this->features.resize(rowCount * featureCount);
+        this->targets.resize(rowCount * targetCount);
+    }
+
+    DatasetBatchSource::DatasetBatchSource(const Dataset &dataset, size_t batchSize, bool shuffle, unsigned seed)
+        : dataset(dataset), batchSize(batchSize), shuffle(shuffle), seed(seed), order(dataset.size())
+    {
+        if (batchSize == 0)
+            throw invalid_argument("Batch size must be positive");
+        iota(order.begin(), order.end(), 0);
+        position = order.size();
+    }
+
+    void DatasetBatchSource::startEpoch(int epoch)
+    {
+        iota(order.begin(), order.end(), 0);
+        if (shuffle)
+        {
+            mt19937 generator(seed + epoch);
+            std::shuffle(order.begin(), order.end(), generator);
+        }
+        position = 0;
+    }
+
+    bool DatasetBatchSource::next(Batch &batch)
+    {
+        if (position >= order.size())
+            return false;
+
+        const size_t rowCount = min(batchSize, order.size() - position);
+        const size_t featureCount = getFeatureCount();
+        const size_t targetCount = getTargetCount();
+        const MatrixView features = dataset.featureMatrix();
+        const MatrixView targets = dataset.targetMatrix();
+        batch.resize(rowCount, featureCount, targetCount);
+
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            const size_t row = order[position + r];
+            copy(features.row(row), features.row(row) + featureCount, batch.features.begin() + r * featureCount);
+            copy(targets.row(row), targets.row(row) + targetCount, batch.targets.begin() + r * targetCount);
+        }
+        position += rowCount;
+        return true;
+    }
+
+    CsvBatchSource::CsvBatchSource(const string &path, size_t batchSize, size_t shuffleRows, unsigned seed,
+                                   const io::CsvOptions &options)
+        : stream(path, options), batchSize(batchSize), shuffleRows(max<size_t>(1, shuffleRows)), seed(seed)
+    {
+        if (batchSize == 0)
+            throw invalid_argument("Batch size must be positive");
+        bufferFeatures.resize(this->shuffleRows * getFeatureCount());
+        bufferTargets.resize(this->shuffleRows * getTargetCount());
+    }
+
+    void CsvBatchSource::startEpoch(int epoch)
+    {
+        stream.rewind();
+        generator.seed(seed + epoch);
+        bufferedRows = stream.read(bufferFeatures.data(), bufferTargets.data(), shuffleRows);
+    }
+
+    bool CsvBatchSource::next(Batch &batch)
+    {
+        if (bufferedRows == 0)
+            return false;
+
+        const size_t featureCount = getFeatureCount();
+        const size_t targetCount = getTargetCount();
+        batch.resize(batchSize, featureCount, targetCount);
+
+        size_t rowCount = 0;
+        for (; rowCount < batchSize && bufferedRows > 0; ++rowCount)
+        {
+            // Emit a random buffered row and refill its slot from the file,
+            // or from the last buffered row once the file runs out.
+            const size_t slot = uniform_int_distribution<size_t>(0, bufferedRows - 1)(generator);
+            float *slotFeatures = bufferFeatures.data() + slot * featureCount;
+            float *slotTargets = bufferTargets.data() + slot * targetCount;
+            copy(slotFeatures, slotFeatures + featureCount, batch.features.begin() + rowCount * featureCount);
+            copy(slotTargets, slotTargets + targetCount, batch.targets.begin() + rowCount * targetCount);
+
+            if (stream.read(slotFeatures, slotTargets, 1) == 0)
+            {
+                --bufferedRows;
+                copy_n(bufferFeatures.data() + bufferedRows * featureCount, featureCount, slotFeatures);
+                copy_n(bufferTargets.data() + bufferedRows * targetCount, targetCount, slotTargets);
+            }
+        }
+
+        batch.resize(rowCount, featureCount, targetCount);
+        return true;
+    }
+
+    BatchPipeline::BatchPipeline(unique_ptr<BatchSource> source, size_t depth)
+        : source(move(source)), slots(depth)
+    {
+        if (!this->source)
+            throw invalid_argument("Batch pipeline needs a source");
+        if (depth < 2)
+            throw invalid_argument("Batch pipeline needs at least two buffers");
+        producer = thread(&BatchPipeline::produce, this);
+    }
+
+    BatchPipeline::~BatchPipeline()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        slotFree.notify_one();
+        producer.join();
+    }
+
+    void BatchPipeline::startEpoch(int epoch)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            this->epoch = epoch;
+            ++generation;
+            head = 0;
+            filled = 0;
+            holding = false;
+            exhausted = false;
+            failure = nullptr;
+        }
+        slotFree.notify_one();
+    }
+
+    const Batch *BatchPipeline::next()
+    {
+        unique_lock<mutex> guard(lock);
+        if (generation == 0)
+            throw logic_error("Batch pipeline epoch not started");
+
+        if (holding)
+        {
+            head = (head + 1) % slots.size();
+            --filled;
+            holding = false;
+            slotFree.notify_one();
+        }
+
+        batchReady.wait(guard, [&]
+                        { return filled > 0 || exhausted; });
+        if (failure)
+        {
+            exception_ptr error = failure;
+            failure = nullptr;
+            rethrow_exception(error);
+        }
+        if (filled == 0)
+            return nullptr;
+
+        holding = true;
+        return &slots[head];
+    }
+
+    void BatchPipeline::produce()
+    {
+        unique_lock<mutex> guard(lock);
+        unsigned long started = 0;
+
+        while (true)
+        {
+            slotFree.wait(guard, [&]
+                          { return stopping || generation != started ||
+                                   (generation != 0 && !exhausted && filled < slots.size()); });
+            if (stopping)
+                return;
+
+            // The source and the slot past the filled ones are only touched
+            // here, so both are filled outside the lock.
+            const unsigned long current = generation;
+            const bool restart = current != started;
+            const int currentEpoch = epoch;
+            Batch &slot = slots[(head + filled) % slots.size()];
+            guard.unlock();
+
+            bool produced = false;
+            exception_ptr error;
+            try
+            {
+                if (restart)
+                    source->startEpoch(currentEpoch);
+                produced = source->next(slot);
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+
+            guard.lock();
+            started = current;
+            // A newer startEpoch() makes this batch stale.
+            if (current != generation)
+                continue;
+
+            if (error)
+            {
+                failure = error;
+                exhausted = true;
+            }
+            else if (produced)
+                ++filled;
+            else
+                exhausted = true;
+            batchReady.notify_one();
+        }
+    }
+}
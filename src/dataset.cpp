@@ -0,0 +1,91 @@
+#include "dataset.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace datasets
+{
+    DatasetView::DatasetView(const Dataset &dataset, size_t begin, size_t end)
+    {
+        if (begin > end || end > dataset.size())
+            throw out_of_range("Dataset view out of range");
+
+        this->dataset = &dataset;
+        this->first = begin;
+        this->count = end - begin;
+    }
+
+    const float *DatasetView::featuresAt(size_t index) const
+    {
+        return dataset->featuresAt(first + index);
+    }
+
+    const float *DatasetView::targetsAt(size_t index) const
+    {
+        return dataset->targetsAt(first + index);
+    }
+
+    Dataset::Dataset() : featureCount(0), targetCount(0)
+    {
+    }
+
+    Dataset::Dataset(size_t featureCount, size_t targetCount)
+        : featureCount(featureCount), targetCount(targetCount)
+    {
+    }
+
+    Dataset::Dataset(io::CsvTable &&table)
+        : featureCount(table.featureCount), targetCount(table.targetCount),
+          features(move(table.features)), targets(move(table.targets)), order(table.rowCount)
+    {
+        this->resetOrder();
+    }
+
+    Dataset Dataset::fromCsv(const string &path, const io::CsvOptions &options)
+    {
+        return Dataset(io::readCsv(path, options));
+    }
+
+    Dataset Dataset::fromRows(const vector<vector<float>> &rows, size_t featureCount)
+    {
+        if (rows.empty())
+            return Dataset();
+
+        Dataset dataset(featureCount, rows[0].size() - min(featureCount, rows[0].size()));
+        dataset.reserve(rows.size());
+
+        for (const auto &row : rows)
+        {
+            if (row.size() != dataset.featureCount + dataset.targetCount)
+                throw invalid_argument("All rows must have the same size");
+            dataset.addRow(row.data(), row.data() + featureCount);
+        }
+        return dataset;
+    }
+
+    void Dataset::reserve(size_t rowCount)
+    {
+        this->features.reserve(rowCount * this->featureCount);
+        this->targets.reserve(rowCount * this->targetCount);
+        this->order.reserve(rowCount);
+    }
+
+    void Dataset::addRow(const float *rowFeatures, const float *rowTargets)
+    {
+        this->order.push_back(this->order.size());
+        this->features.insert(this->features.end(), rowFeatures, rowFeatures + this->featureCount);
+        this->targets.insert(this->targets.end(), rowTargets, rowTargets + this->targetCount);
+    }
+
+    void Dataset::shuffle(mt19937 &generator)
+    {
+        std::shuffle(this->order.begin(), this->order.end(), generator);
+    }
+
+    void Dataset::resetOrder()
+    {
+        iota(this->order.begin(), this->order.end(), 0);
+    }
+}
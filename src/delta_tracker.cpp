@@ -0,0 +1,479 @@
+#include "delta_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tracking
+{
+    size_t DeltaLayout::getNodeCount() const
+    {
+        return accumulate(layerSizes.begin(), layerSizes.end(), size_t(0));
+    }
+
+    CsvDeltaSink::CsvDeltaSink(const string &filename) : filename(filename), nodeCount(0), valueCount(0)
+    {
+    }
+
+    void CsvDeltaSink::begin(const DeltaLayout &layout)
+    {
+        file.open(filename);
+        if (!file.is_open())
+            throw runtime_error("Could not open file for delta export: " + filename);
+
+        nodeCount = layout.getNodeCount();
+        valueCount = layout.getValueCount();
+
+        file << "epoch,sample,loss,";
+        for (size_t l = 0; l < layout.layerSizes.size(); ++l)
+        {
+            string prefix = (l == 0) ? "input" : (l + 1 == layout.layerSizes.size()) ? "output"
+                                                                                      : "hidden" + to_string(l - 1);
+            for (size_t i = 0; i < layout.layerSizes[l]; ++i)
+            {
+                file << prefix << "_delta_" << i << ",";
+            }
+        }
+        file << "input_weight_0,hidden0_weight_0\n";
+    }
+
+    void CsvDeltaSink::write(const DeltaRecord *records, const float *values, size_t count)
+    {
+        // %g matches the default ostream float formatting used before.
+        char cell[32];
+        string line;
+
+        for (size_t r = 0; r < count; ++r, values += valueCount)
+        {
+            const DeltaRecord &record = records[r];
+            line.clear();
+
+            int length = snprintf(cell, sizeof(cell), "%d,%lld,%g", record.epoch, (long long)record.sample, record.loss);
+            line.append(cell, length);
+
+            for (size_t i = 0; i < nodeCount; ++i)
+            {
+                length = snprintf(cell, sizeof(cell), ",%g", values[i]);
+                line.append(cell, length);
+            }
+
+            length = snprintf(cell, sizeof(cell), ",%g,%g\n", record.inputWeight, record.hiddenWeight);
+            line.append(cell, length);
+
+            file.write(line.data(), line.size());
+        }
+
+        if (!file)
+            throw runtime_error("Could not write delta export: " + filename);
+    }
+
+    void CsvDeltaSink::finish()
+    {
+        file.close();
+    }
+
+    namespace
+    {
+        const char deltaLogMagic[8] = {'N', 'N', 'D', 'E', 'L', 'T', 'A', '\0'};
+        const uint32_t deltaLogVersion = 1;
+        const size_t deltaRecordHeaderSize = 32;
+
+        template <typename T>
+        void append(vector<char> &buffer, const T &value)
+        {
+            const char *bytes = reinterpret_cast<const char *>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+        }
+    }
+
+    BinaryDeltaSink::BinaryDeltaSink(const string &filename) : filename(filename), valueCount(0), recordCount(0)
+    {
+    }
+
+    void BinaryDeltaSink::begin(const DeltaLayout &layout)
+    {
+        file.open(filename, ios::binary | ios::trunc);
+        if (!file.is_open())
+            throw runtime_error("Could not open file for delta log: " + filename);
+
+        valueCount = layout.getValueCount();
+        recordCount = 0;
+
+        buffer.clear();
+        buffer.insert(buffer.end(), deltaLogMagic, deltaLogMagic + sizeof(deltaLogMagic));
+        append(buffer, deltaLogVersion);
+        append(buffer, static_cast<uint32_t>(layout.mode));
+        append(buffer, static_cast<uint32_t>(layout.layerSizes.size()));
+        append(buffer, static_cast<uint32_t>(valueCount));
+        for (size_t size : layout.layerSizes)
+            append(buffer, static_cast<uint32_t>(size));
+        buffer.resize((buffer.size() + 7) / 8 * 8, 0);
+
+        file.write(buffer.data(), buffer.size());
+        file.flush();
+        if (!file)
+            throw runtime_error("Could not write delta log: " + filename);
+    }
+
+    void BinaryDeltaSink::write(const DeltaRecord *records, const float *values, size_t count)
+    {
+        buffer.clear();
+        buffer.reserve(count * (deltaRecordHeaderSize + valueCount * sizeof(float)));
+
+        for (size_t r = 0; r < count; ++r, values += valueCount)
+        {
+            const DeltaRecord &record = records[r];
+            append(buffer, record.epoch);
+            append(buffer, record.sampleCount);
+            append(buffer, record.sample);
+            append(buffer, record.loss);
+            append(buffer, record.inputWeight);
+            append(buffer, record.hiddenWeight);
+            append(buffer, uint32_t(0));
+
+            const char *bytes = reinterpret_cast<const char *>(values);
+            buffer.insert(buffer.end(), bytes, bytes + valueCount * sizeof(float));
+        }
+
+        file.write(buffer.data(), buffer.size());
+        file.flush();
+        if (!file)
+            throw runtime_error("Could not write delta log: " + filename);
+        recordCount += count;
+    }
+
+    void BinaryDeltaSink::finish()
+    {
+        file.close();
+    }
+
+    DeltaTracker::DeltaTracker(const vector<size_t> &layerSizes, const TrackingOptions &options)
+        : options(options)
+    {
+        if (options.capacity == 0)
+            throw invalid_argument("Tracking capacity must be positive");
+
+        this->options.interval = max<size_t>(1, options.interval);
+        layout.layerSizes = layerSizes;
+        layout.mode = options.mode;
+        valueCount = layout.getValueCount();
+
+        ringRecords.resize(options.capacity);
+        ringValues.resize(options.capacity * valueCount);
+        firstRetained = 0;
+        nextRecord = 0;
+        nextUnwritten = 0;
+        droppedRecords = 0;
+        stopping = false;
+        flushRequested = false;
+    }
+
+    DeltaTracker::~DeltaTracker()
+    {
+        try
+        {
+            stopWriter();
+        }
+        catch (...)
+        {
+            // Destructors must not throw; call flush() to observe sink errors.
+        }
+    }
+
+    void DeltaTracker::setSink(unique_ptr<DeltaSink> newSink)
+    {
+        stopWriter();
+        if (!newSink)
+            return;
+
+        newSink->begin(layout);
+
+        lock_guard<mutex> guard(lock);
+        sink = move(newSink);
+        nextUnwritten = nextRecord;
+        stopping = false;
+        flushRequested = false;
+        sinkFailure = nullptr;
+        writer = thread(&DeltaTracker::writerLoop, this);
+    }
+
+    void DeltaTracker::stopWriter()
+    {
+        if (!writer.joinable())
+            return;
+
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        pendingChanged.notify_all();
+        writer.join();
+
+        unique_ptr<DeltaSink> finished = move(sink);
+        exception_ptr failure = sinkFailure;
+        sinkFailure = nullptr;
+
+        finished->finish();
+        if (failure)
+            rethrow_exception(failure);
+    }
+
+    void DeltaTracker::flush()
+    {
+        unique_lock<mutex> guard(lock);
+        if (writer.joinable())
+        {
+            flushRequested = true;
+            pendingChanged.notify_all();
+            pendingChanged.wait(guard, [&]
+                                { return nextUnwritten == nextRecord || sinkFailure; });
+        }
+
+        // The failure stays recorded so later commits don't wait on a
+        // writer that has stopped.
+        if (sinkFailure)
+            rethrow_exception(sinkFailure);
+    }
+
+    void DeltaTracker::writerLoop()
+    {
+        // Wake the writer in chunks rather than once per batch.
+        const uint64_t threshold = max<size_t>(1, options.capacity / 8);
+        vector<DeltaRecord> records;
+        vector<float> values;
+
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            pendingChanged.wait(guard, [&]
+                                { return stopping || flushRequested || nextRecord - nextUnwritten >= threshold; });
+
+            if (nextRecord == nextUnwritten)
+            {
+                flushRequested = false;
+                pendingChanged.notify_all();
+                if (stopping)
+                    break;
+                continue;
+            }
+
+            const uint64_t begin = nextUnwritten;
+            const uint64_t end = nextRecord;
+            records.resize(end - begin);
+            values.resize((end - begin) * valueCount);
+            for (uint64_t r = begin; r < end; ++r)
+            {
+                const size_t slot = r % options.capacity;
+                records[r - begin] = ringRecords[slot];
+                copy_n(ringValues.begin() + slot * valueCount, valueCount, values.begin() + (r - begin) * valueCount);
+            }
+
+            guard.unlock();
+            exception_ptr failure;
+            try
+            {
+                sink->write(records.data(), values.data(), records.size());
+            }
+            catch (...)
+            {
+                failure = current_exception();
+            }
+            guard.lock();
+
+            nextUnwritten = end;
+            pendingChanged.notify_all();
+            if (failure)
+            {
+                sinkFailure = failure;
+                break;
+            }
+        }
+    }
+
+    void DeltaTracker::push(unique_lock<mutex> &guard, const DeltaRecord &record, const float *values)
+    {
+        if (writer.joinable())
+        {
+            // Backpressure: never overwrite records the sink hasn't seen.
+            if (nextRecord - nextUnwritten >= options.capacity)
+                pendingChanged.notify_all();
+            pendingChanged.wait(guard, [&]
+                                { return nextRecord - nextUnwritten < options.capacity || sinkFailure; });
+        }
+
+        if (nextRecord - firstRetained == options.capacity)
+        {
+            if (!writer.joinable() || sinkFailure)
+                ++droppedRecords;
+            ++firstRetained;
+        }
+
+        const size_t slot = nextRecord % options.capacity;
+        ringRecords[slot] = record;
+        copy_n(values, valueCount, ringValues.begin() + slot * valueCount);
+        ++nextRecord;
+
+        if (!writer.joinable() || sinkFailure)
+            nextUnwritten = nextRecord;
+    }
+
+    void DeltaTracker::prepare(size_t workerCount)
+    {
+        const size_t nodeCount = layout.getNodeCount();
+        stages.resize(max(stages.size(), workerCount));
+
+        for (auto &stage : stages)
+        {
+            stage.records.clear();
+            stage.values.clear();
+            stage.sumAbs.assign(nodeCount, 0.0f);
+            stage.maxAbs.assign(nodeCount, 0.0f);
+            stage.lossSum = 0.0;
+            stage.sampleCount = 0;
+        }
+    }
+
+    bool DeltaTracker::captures(size_t sample, size_t batchIndex) const
+    {
+        if (options.mode == TrackingMode::Samples)
+            return sample % options.interval == 0;
+        return batchIndex % options.interval == 0;
+    }
+
+    void DeltaTracker::capture(size_t worker, size_t sample, float loss, const vector<memory::FloatSpan> &layerDeltas)
+    {
+        Stage &stage = stages[worker];
+
+        if (options.mode == TrackingMode::Samples)
+        {
+            DeltaRecord record = {};
+            record.sampleCount = 1;
+            record.sample = sample;
+            record.loss = loss;
+            stage.records.push_back(record);
+
+            for (const auto &deltas : layerDeltas)
+                stage.values.insert(stage.values.end(), deltas.begin(), deltas.end());
+            for (const auto &deltas : layerDeltas)
+            {
+                for (float delta : deltas)
+                    stage.values.push_back(fabs(delta));
+            }
+            return;
+        }
+
+        size_t node = 0;
+        for (const auto &deltas : layerDeltas)
+        {
+            for (float delta : deltas)
+            {
+                stage.sumAbs[node] += fabs(delta);
+                stage.maxAbs[node] = max(stage.maxAbs[node], fabs(delta));
+                ++node;
+            }
+        }
+        stage.lossSum += loss;
+        ++stage.sampleCount;
+    }
+
+    void DeltaTracker::commit(size_t workerCount, int epoch, size_t batchBegin, float inputWeight, float hiddenWeight)
+    {
+        unique_lock<mutex> guard(lock);
+        workerCount = min(workerCount, stages.size());
+
+        if (options.mode == TrackingMode::Samples)
+        {
+            for (size_t w = 0; w < workerCount; ++w)
+            {
+                Stage &stage = stages[w];
+                for (size_t r = 0; r < stage.records.size(); ++r)
+                {
+                    DeltaRecord record = stage.records[r];
+                    record.epoch = epoch;
+                    record.inputWeight = inputWeight;
+                    record.hiddenWeight = hiddenWeight;
+                    this->push(guard, record, stage.values.data() + r * valueCount);
+                }
+                stage.records.clear();
+                stage.values.clear();
+            }
+        }
+        else
+        {
+            // Reduce into the first stage, in worker order.
+            Stage &total = stages[0];
+            for (size_t w = 1; w < workerCount; ++w)
+            {
+                Stage &stage = stages[w];
+                for (size_t i = 0; i < total.sumAbs.size(); ++i)
+                {
+                    total.sumAbs[i] += stage.sumAbs[i];
+                    total.maxAbs[i] = max(total.maxAbs[i], stage.maxAbs[i]);
+                }
+                total.lossSum += stage.lossSum;
+                total.sampleCount += stage.sampleCount;
+            }
+
+            if (total.sampleCount > 0)
+            {
+                DeltaRecord record;
+                record.epoch = epoch;
+                record.sampleCount = total.sampleCount;
+                record.sample = batchBegin;
+                record.loss = total.lossSum / total.sampleCount;
+                record.inputWeight = inputWeight;
+                record.hiddenWeight = hiddenWeight;
+
+                total.values.clear();
+                for (float sum : total.sumAbs)
+                    total.values.push_back(sum / total.sampleCount);
+                total.values.insert(total.values.end(), total.maxAbs.begin(), total.maxAbs.end());
+
+                this->push(guard, record, total.values.data());
+            }
+
+            for (size_t w = 0; w < workerCount; ++w)
+            {
+                Stage &stage = stages[w];
+                fill(stage.sumAbs.begin(), stage.sumAbs.end(), 0.0f);
+                fill(stage.maxAbs.begin(), stage.maxAbs.end(), 0.0f);
+                stage.lossSum = 0.0;
+                stage.sampleCount = 0;
+            }
+        }
+
+        guard.unlock();
+        pendingChanged.notify_all();
+    }
+
+    size_t DeltaTracker::size() const
+    {
+        lock_guard<mutex> guard(lock);
+        return nextRecord - firstRetained;
+    }
+
+    uint64_t DeltaTracker::getDroppedCount() const
+    {
+        lock_guard<mutex> guard(lock);
+        return droppedRecords;
+    }
+
+    void DeltaTracker::forEach(const function<void(const DeltaRecord &, const float *)> &visit) const
+    {
+        lock_guard<mutex> guard(lock);
+        for (uint64_t r = firstRetained; r < nextRecord; ++r)
+        {
+            const size_t slot = r % options.capacity;
+            visit(ringRecords[slot], ringValues.data() + slot * valueCount);
+        }
+    }
+
+    void DeltaTracker::clear()
+    {
+        lock_guard<mutex> guard(lock);
+        firstRetained = nextRecord;
+    }
+}
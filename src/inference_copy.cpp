@@ -0,0 +1,78 @@
+#include "inference_copy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace neural_network
+{
+    InferenceCopy::InferenceCopy(const NeuralNetwork &network)
+    {
+        if (network.getInputNormalizer())
+            inputNormalizer = *network.getInputNormalizer();
+    }
+
+    const float *InferenceCopy::normalizeInputs(const float *inputs, size_t count, float *scratch) const
+    {
+        if (inputNormalizer.empty())
+            return inputs;
+        inputNormalizer.normalize(inputs, count, scratch);
+        return scratch;
+    }
+
+    size_t InferenceCopy::normalizeScratchSize(size_t rows, size_t inputSize) const
+    {
+        return inputNormalizer.empty() ? 0 : rows * inputSize;
+    }
+
+    CopyDrift measureDrift(const NeuralNetwork &reference, const vector<size_t> &copyLayerSizes,
+                           const function<void(const float *, size_t, float *)> &forwardBatch,
+                           const datasets::Dataset &data)
+    {
+        if (reference.getLayerSizes() != copyLayerSizes)
+            throw invalid_argument("Network copy topology doesn't match reference");
+        if (data.getFeatureCount() != static_cast<size_t>(reference.getInputSize()) ||
+            data.getTargetCount() != static_cast<size_t>(reference.getOutputSize()))
+            throw invalid_argument("Dataset shape doesn't match network");
+
+        CopyDrift drift;
+        drift.sampleCount = data.size();
+        if (data.empty())
+            return drift;
+
+        const size_t outputSize = reference.getOutputSize();
+        const float *inputs = data.featureMatrix().data;
+        vector<float> referenceOutputs(data.size() * outputSize);
+        vector<float> copyOutputs(data.size() * outputSize);
+
+        InferenceContext context = reference.createInferenceContext();
+        reference.forwardBatch(context, inputs, data.size(), referenceOutputs.data());
+        forwardBatch(inputs, data.size(), copyOutputs.data());
+
+        const datasets::MatrixView targets = data.targetMatrix();
+        double absoluteError = 0.0;
+        // Both losses come from the finished outputs through the same
+        // formula, so their difference is down to the weights alone.
+        double referenceLoss = 0.0;
+        double copyLoss = 0.0;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const float *referenceRow = referenceOutputs.data() + i * outputSize;
+            const float *copyRow = copyOutputs.data() + i * outputSize;
+            for (size_t j = 0; j < outputSize; ++j)
+            {
+                const float error = fabs(copyRow[j] - referenceRow[j]);
+                drift.maxAbsoluteError = max(drift.maxAbsoluteError, error);
+                absoluteError += error;
+            }
+            referenceLoss += reference.calculateLoss(referenceRow, targets.row(i));
+            copyLoss += reference.calculateLoss(copyRow, targets.row(i));
+        }
+
+        drift.meanAbsoluteError = absoluteError / (data.size() * outputSize);
+        drift.referenceLoss = referenceLoss / data.size();
+        drift.copyLoss = copyLoss / data.size();
+        return drift;
+    }
+}
@@ -0,0 +1,393 @@
+#include "inference_server.hpp"
+#include <algorithm>
+#include <atomic>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace serving
+{
+    namespace
+    {
+        // Latencies kept for the percentiles.
+        const size_t latencyWindow = 8192;
+        const size_t readChunkBytes = 1 << 16;
+        // A longer line drops the connection instead of buffering forever.
+        const size_t maxLineBytes = 4 * readChunkBytes;
+        // Connections served at once by serveTcp(); more are turned away.
+        const int maxConnections = 64;
+
+        double percentile(vector<float> values, double fraction)
+        {
+            if (values.empty())
+                return 0.0;
+            const size_t index = min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+            nth_element(values.begin(), values.begin() + index, values.end());
+            return values[index];
+        }
+
+        bool isBlank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        string trim(const string &line)
+        {
+            size_t begin = 0;
+            size_t end = line.size();
+            while (begin < end && isBlank(line[begin]))
+                ++begin;
+            while (end > begin && isBlank(line[end - 1]))
+                --end;
+            return line.substr(begin, end - begin);
+        }
+
+        // Comma-separated floats; false on anything else.
+        bool parseInputs(const string &line, vector<float> &values)
+        {
+            const char *p = line.data();
+            const char *end = p + line.size();
+            values.clear();
+
+            while (true)
+            {
+                while (p < end && isBlank(*p))
+                    ++p;
+                if (p < end && *p == '+')
+                    ++p;
+
+                float value;
+                from_chars_result result = from_chars(p, end, value);
+                if (result.ec != errc())
+                    return false;
+                values.push_back(value);
+                p = result.ptr;
+
+                while (p < end && isBlank(*p))
+                    ++p;
+                if (p == end)
+                    return true;
+                if (*p != ',')
+                    return false;
+                ++p;
+            }
+        }
+
+        string formatOutputs(const vector<float> &outputs)
+        {
+            string text;
+            char number[32];
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                snprintf(number, sizeof(number), i ? ",%.6g" : "%.6g", outputs[i]);
+                text += number;
+            }
+            return text;
+        }
+
+        string formatStats(const ServingStats &stats)
+        {
+            char text[256];
+            snprintf(text, sizeof(text),
+                     "requests=%llu batches=%llu mean_batch=%.2f p50_ms=%.3f p99_ms=%.3f throughput=%.1f",
+                     static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.batches),
+                     stats.meanBatchSize, stats.p50Milliseconds, stats.p99Milliseconds, stats.throughput);
+            return text;
+        }
+
+        bool writeAll(int fd, const string &text)
+        {
+            size_t written = 0;
+            while (written < text.size())
+            {
+                ssize_t count = write(fd, text.data() + written, text.size() - written);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                    return false;
+                written += count;
+            }
+            return true;
+        }
+
+        // One line's answer: ready text, a prediction still in flight, or
+        // stats taken once the answers before it are in.
+        struct PendingAnswer
+        {
+            string text;
+            future<vector<float>> result;
+            bool stats = false;
+        };
+
+        PendingAnswer answer(MicroBatcher &batcher, const string &line, vector<float> &inputs)
+        {
+            PendingAnswer pending;
+            if (line == "stats")
+                pending.stats = true;
+            else if (!parseInputs(line, inputs))
+                pending.text = "error: expected comma-separated numbers";
+            else if (inputs.size() != static_cast<size_t>(batcher.getNetwork().getInputSize()))
+                pending.text = "error: expected " + to_string(batcher.getNetwork().getInputSize()) + " inputs";
+            else
+                pending.result = batcher.submit(inputs);
+            return pending;
+        }
+    }
+
+    MicroBatcher::MicroBatcher(shared_ptr<const neural_network::NeuralNetwork> network,
+                               const BatchingOptions &options)
+        : network(move(network)), options(options)
+    {
+        if (!this->network)
+            throw invalid_argument("Micro-batcher needs a network");
+        if (options.maxBatchSize == 0)
+            throw invalid_argument("Batch size must be positive");
+
+        context = this->network->createInferenceContext();
+        batchInputs.resize(options.maxBatchSize * this->network->getInputSize());
+        batchOutputs.resize(options.maxBatchSize * this->network->getOutputSize());
+        latencies.reserve(latencyWindow);
+        started = chrono::steady_clock::now();
+        worker = thread(&MicroBatcher::run, this);
+    }
+
+    MicroBatcher::~MicroBatcher()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        queued.notify_one();
+        worker.join();
+    }
+
+    future<vector<float>> MicroBatcher::submit(vector<float> inputs)
+    {
+        if (inputs.size() != static_cast<size_t>(network->getInputSize()))
+            throw invalid_argument("Input size doesn't match network input size");
+
+        Request request;
+        request.inputs = move(inputs);
+        request.arrival = chrono::steady_clock::now();
+        future<vector<float>> result = request.result.get_future();
+        {
+            lock_guard<mutex> guard(lock);
+            queue.push_back(move(request));
+        }
+        queued.notify_one();
+        return result;
+    }
+
+    void MicroBatcher::run()
+    {
+        vector<Request> batch;
+        batch.reserve(options.maxBatchSize);
+        unique_lock<mutex> guard(lock);
+
+        while (true)
+        {
+            queued.wait(guard, [&]
+                        { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+
+            // Hold the batch open until it fills or its oldest request has
+            // waited long enough; stopping flushes at once.
+            const auto deadline = queue.front().arrival + options.maxWait;
+            queued.wait_until(guard, deadline, [&]
+                              { return stopping || queue.size() >= options.maxBatchSize; });
+
+            const size_t count = min(queue.size(), options.maxBatchSize);
+            for (size_t i = 0; i < count; ++i)
+            {
+                batch.push_back(move(queue.front()));
+                queue.pop_front();
+            }
+
+            guard.unlock();
+            process(batch);
+            batch.clear();
+            guard.lock();
+        }
+    }
+
+    void MicroBatcher::process(vector<Request> &batch)
+    {
+        const size_t inputSize = network->getInputSize();
+        const size_t outputSize = network->getOutputSize();
+
+        for (size_t i = 0; i < batch.size(); ++i)
+            copy(batch[i].inputs.begin(), batch[i].inputs.end(), batchInputs.begin() + i * inputSize);
+
+        try
+        {
+            network->forwardBatch(context, batchInputs.data(), batch.size(), batchOutputs.data());
+        }
+        catch (...)
+        {
+            for (Request &request : batch)
+                request.result.set_exception(current_exception());
+            return;
+        }
+
+        const auto finished = chrono::steady_clock::now();
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const float *outputs = batchOutputs.data() + i * outputSize;
+            batch[i].result.set_value(vector<float>(outputs, outputs + outputSize));
+        }
+
+        lock_guard<mutex> guard(statsLock);
+        ++batchCount;
+        requestCount += batch.size();
+        for (const Request &request : batch)
+        {
+            const float milliseconds = chrono::duration<float, milli>(finished - request.arrival).count();
+            if (latencies.size() < latencyWindow)
+                latencies.push_back(milliseconds);
+            else
+                latencies[nextLatency] = milliseconds;
+            nextLatency = (nextLatency + 1) % latencyWindow;
+        }
+    }
+
+    ServingStats MicroBatcher::getStats() const
+    {
+        ServingStats stats;
+        vector<float> recent;
+        {
+            lock_guard<mutex> guard(statsLock);
+            stats.requests = requestCount;
+            stats.batches = batchCount;
+            recent = latencies;
+        }
+
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        stats.meanBatchSize = stats.batches ? static_cast<double>(stats.requests) / stats.batches : 0.0;
+        stats.p50Milliseconds = percentile(recent, 0.50);
+        stats.p99Milliseconds = percentile(recent, 0.99);
+        stats.throughput = seconds > 0.0 ? stats.requests / seconds : 0.0;
+        return stats;
+    }
+
+    void serveLines(MicroBatcher &batcher, int inputFd, int outputFd)
+    {
+        vector<char> chunk(readChunkBytes);
+        string partial;
+        vector<float> inputs;
+        vector<PendingAnswer> answers;
+        bool open = true;
+
+        while (open)
+        {
+            ssize_t count = read(inputFd, chunk.data(), chunk.size());
+            if (count < 0 && errno == EINTR)
+                continue;
+            open = count > 0;
+            if (open)
+                partial.append(chunk.data(), count);
+            else if (!partial.empty())
+                partial += '\n';
+
+            // Submit every complete line before waiting on the first answer.
+            size_t begin = 0;
+            for (size_t end; (end = partial.find('\n', begin)) != string::npos; begin = end + 1)
+            {
+                string line = trim(partial.substr(begin, end - begin));
+                if (!line.empty())
+                    answers.push_back(answer(batcher, line, inputs));
+            }
+            partial.erase(0, begin);
+
+            string response;
+            for (PendingAnswer &pending : answers)
+            {
+                if (pending.stats)
+                    pending.text = formatStats(batcher.getStats());
+                else if (pending.result.valid())
+                {
+                    try
+                    {
+                        pending.text = formatOutputs(pending.result.get());
+                    }
+                    catch (const exception &error)
+                    {
+                        pending.text = string("error: ") + error.what();
+                    }
+                }
+                response += pending.text;
+                response += '\n';
+            }
+            answers.clear();
+
+            if (!response.empty() && !writeAll(outputFd, response))
+                return;
+
+            // Whatever is left has no newline yet.
+            if (partial.size() > maxLineBytes)
+            {
+                writeAll(outputFd, "error: line too long\n");
+                return;
+            }
+        }
+    }
+
+    void serveTcp(MicroBatcher &batcher, uint16_t port, const string &address)
+    {
+        // A client hanging up mid-answer must not kill the server.
+        signal(SIGPIPE, SIG_IGN);
+
+        sockaddr_in endpoint = {};
+        endpoint.sin_family = AF_INET;
+        endpoint.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &endpoint.sin_addr) != 1)
+            throw runtime_error("Invalid listen address " + address);
+
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0)
+            throw runtime_error("Could not create socket");
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(listener, reinterpret_cast<sockaddr *>(&endpoint), sizeof(endpoint)) != 0 ||
+            listen(listener, SOMAXCONN) != 0)
+        {
+            close(listener);
+            throw runtime_error("Could not listen on " + address + ":" + to_string(port));
+        }
+
+        // Shared with the detached connection threads, which outlive any
+        // local; serveTcp() never returns.
+        static atomic<int> activeConnections{0};
+
+        while (true)
+        {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection < 0)
+                continue;
+
+            if (activeConnections.fetch_add(1) >= maxConnections)
+            {
+                activeConnections.fetch_sub(1);
+                writeAll(connection, "error: too many connections\n");
+                close(connection);
+                continue;
+            }
+
+            thread([&batcher, connection]
+                   {
+                       serveLines(batcher, connection, connection);
+                       close(connection);
+                       activeConnections.fetch_sub(1); })
+                .detach();
+        }
+    }
+}
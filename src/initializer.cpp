@@ -0,0 +1,106 @@
+#include "initializer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace initialization
+{
+    namespace
+    {
+        // Values per parallel task; smaller buffers are filled inline.
+        const size_t blockSize = 1 << 16;
+
+        const char *const schemeNames[] = {"uniform", "xavier_uniform", "xavier_normal", "he_uniform", "he_normal"};
+        const size_t schemeCount = sizeof(schemeNames) / sizeof(schemeNames[0]);
+
+        template <typename Fill>
+        void fillBlocks(size_t n, threading::ThreadPool *pool, Fill fill)
+        {
+            const size_t blockCount = (n + blockSize - 1) / blockSize;
+            if (!pool || blockCount < 2)
+                return fill(0, n);
+
+            pool->run(blockCount, [&](size_t b)
+                      { fill(b * blockSize, min(n, (b + 1) * blockSize)); });
+        }
+    }
+
+    // Hashing the pair keeps neighbouring seeds and streams unrelated.
+    CounterRng::CounterRng(uint64_t seed, uint64_t stream) : key(mix64(seed ^ mix64(stream + 0x9E3779B97F4A7C15ull)))
+    {
+    }
+
+    float CounterRng::normal(uint64_t counter) const
+    {
+        // 1 - uniform keeps the log argument in (0, 1].
+        const float radius = sqrt(-2.0f * log(1.0f - uniform(2 * counter)));
+        return radius * cos(6.28318530718f * uniform(2 * counter + 1));
+    }
+
+    const char *schemeName(Scheme scheme)
+    {
+        const size_t index = static_cast<size_t>(scheme);
+        return index < schemeCount ? schemeNames[index] : "unknown";
+    }
+
+    bool parseScheme(const char *name, Scheme &scheme)
+    {
+        for (size_t i = 0; i < schemeCount; ++i)
+        {
+            if (strcmp(name, schemeNames[i]) == 0)
+            {
+                scheme = static_cast<Scheme>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fillUniform(float *values, size_t n, float low, float high, const CounterRng &rng,
+                     threading::ThreadPool *pool)
+    {
+        const float width = high - low;
+        fillBlocks(n, pool, [&](size_t begin, size_t end)
+                   {
+                       for (size_t i = begin; i < end; ++i)
+                           values[i] = low + width * rng.uniform(i); });
+    }
+
+    void fillNormal(float *values, size_t n, float standardDeviation, const CounterRng &rng,
+                    threading::ThreadPool *pool)
+    {
+        fillBlocks(n, pool, [&](size_t begin, size_t end)
+                   {
+                       for (size_t i = begin; i < end; ++i)
+                           values[i] = standardDeviation * rng.normal(i); });
+    }
+
+    void fillWeights(float *weights, size_t fanIn, size_t fanOut, const InitializationOptions &options,
+                     uint64_t stream, threading::ThreadPool *pool)
+    {
+        const CounterRng rng(options.seed, stream);
+        const size_t n = fanIn * fanOut;
+        const float glorot = 2.0f / (fanIn + fanOut);
+        const float kaiming = 2.0f / fanIn;
+
+        // Uniform limits are sqrt(3) standard deviations.
+        switch (options.weights)
+        {
+        case Scheme::Uniform:
+            return fillUniform(weights, n, -options.range, options.range, rng, pool);
+        case Scheme::XavierUniform:
+            return fillUniform(weights, n, -sqrt(3.0f * glorot), sqrt(3.0f * glorot), rng, pool);
+        case Scheme::XavierNormal:
+            return fillNormal(weights, n, sqrt(glorot), rng, pool);
+        case Scheme::HeUniform:
+            return fillUniform(weights, n, -sqrt(3.0f * kaiming), sqrt(3.0f * kaiming), rng, pool);
+        case Scheme::HeNormal:
+            return fillNormal(weights, n, sqrt(kaiming), rng, pool);
+        default:
+            throw invalid_argument("Unknown initialization scheme");
+        }
+    }
+}
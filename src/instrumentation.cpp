@@ -0,0 +1,249 @@
+#include "instrumentation.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace profiling
+{
+    namespace
+    {
+        const size_t phaseCount = static_cast<size_t>(Phase::Count);
+        const size_t counterCount = static_cast<size_t>(Counter::Count);
+
+        // Owner-only accumulation: a plain load/store pair avoids a locked
+        // read-modify-write on every timer.
+        inline void bump(atomic<uint64_t> &value, uint64_t amount)
+        {
+            value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+        }
+
+        void writePhases(ofstream &file, const PhaseTotals *phases, const uint64_t *counters)
+        {
+            file << "\"phases\": {";
+            bool first = true;
+            for (size_t p = 0; p < phaseCount; ++p)
+            {
+                if (phases[p].calls == 0)
+                    continue;
+
+                char entry[160];
+                snprintf(entry, sizeof(entry), "%s\"%s\": {\"calls\": %llu, \"total_ms\": %.3f, \"mean_ns\": %.1f}",
+                         first ? "" : ", ", phaseName(static_cast<Phase>(p)), (unsigned long long)phases[p].calls,
+                         phases[p].nanoseconds / 1e6, (double)phases[p].nanoseconds / phases[p].calls);
+                file << entry;
+                first = false;
+            }
+
+            file << "}, \"counters\": {";
+            for (size_t c = 0; c < counterCount; ++c)
+            {
+                file << (c ? ", " : "") << "\"" << counterName(static_cast<Counter>(c)) << "\": " << counters[c];
+            }
+            file << "}";
+        }
+    }
+
+    const char *phaseName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::Train:
+            return "train";
+        case Phase::Forward:
+            return "forward";
+        case Phase::InputForward:
+            return "input_forward";
+        case Phase::HiddenForward:
+            return "hidden_forward";
+        case Phase::Loss:
+            return "loss";
+        case Phase::Backpropagate:
+            return "backpropagate";
+        case Phase::ReduceGradients:
+            return "reduce_gradients";
+        case Phase::ApplyGradients:
+            return "apply_gradients";
+        case Phase::CaptureDeltas:
+            return "capture_deltas";
+        case Phase::ForwardBatch:
+            return "forward_batch";
+        default:
+            return "unknown";
+        }
+    }
+
+    const char *counterName(Counter counter)
+    {
+        switch (counter)
+        {
+        case Counter::SamplesTrained:
+            return "samples_trained";
+        case Counter::BatchesApplied:
+            return "batches_applied";
+        case Counter::SamplesInferred:
+            return "samples_inferred";
+        case Counter::DeltasCaptured:
+            return "deltas_captured";
+        default:
+            return "unknown";
+        }
+    }
+
+    Profiler::ThreadBlock::ThreadBlock(size_t id) : id(id)
+    {
+        for (auto &value : calls)
+            value = 0;
+        for (auto &value : nanoseconds)
+            value = 0;
+        for (auto &value : counters)
+            value = 0;
+    }
+
+    Profiler::Profiler() : origin(chrono::steady_clock::now()), tracing(false), traceCapacity(0)
+    {
+    }
+
+    Profiler &Profiler::instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    Profiler::ThreadBlock &Profiler::localBlock()
+    {
+        thread_local ThreadBlock *block = nullptr;
+        if (!block)
+        {
+            lock_guard<mutex> guard(lock);
+            blocks.push_back(make_unique<ThreadBlock>(blocks.size()));
+            block = blocks.back().get();
+        }
+        return *block;
+    }
+
+    uint64_t Profiler::now() const
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+    }
+
+    void Profiler::record(Phase phase, uint64_t start, uint64_t duration)
+    {
+        ThreadBlock &block = localBlock();
+        const size_t p = static_cast<size_t>(phase);
+        bump(block.calls[p], 1);
+        bump(block.nanoseconds[p], duration);
+
+        if (tracing.load(memory_order_relaxed))
+        {
+            lock_guard<mutex> guard(block.traceLock);
+            if (block.trace.size() < traceCapacity)
+                block.trace.push_back({phase, start, duration});
+        }
+    }
+
+    void Profiler::count(Counter counter, uint64_t amount)
+    {
+        bump(localBlock().counters[static_cast<size_t>(counter)], amount);
+    }
+
+    void Profiler::enableTracing(size_t capacity)
+    {
+        traceCapacity = capacity;
+        tracing = true;
+    }
+
+    void Profiler::closeEpoch(int epoch)
+    {
+        lock_guard<mutex> guard(lock);
+        EpochProfile &profile = epochs[epoch];
+
+        for (auto &block : blocks)
+        {
+            for (size_t p = 0; p < phaseCount; ++p)
+            {
+                profile.phases[p].calls += block->calls[p].exchange(0);
+                profile.phases[p].nanoseconds += block->nanoseconds[p].exchange(0);
+            }
+            for (size_t c = 0; c < counterCount; ++c)
+                profile.counters[c] += block->counters[c].exchange(0);
+        }
+    }
+
+    void Profiler::reset()
+    {
+        lock_guard<mutex> guard(lock);
+        epochs.clear();
+        for (auto &block : blocks)
+        {
+            for (size_t p = 0; p < phaseCount; ++p)
+            {
+                block->calls[p] = 0;
+                block->nanoseconds[p] = 0;
+            }
+            for (auto &value : block->counters)
+                value = 0;
+
+            lock_guard<mutex> traceGuard(block->traceLock);
+            block->trace.clear();
+        }
+    }
+
+    void Profiler::exportJson(const string &filename)
+    {
+        ofstream file(filename);
+        if (!file.is_open())
+            throw runtime_error("Could not open file for profile export: " + filename);
+
+        lock_guard<mutex> guard(lock);
+        EpochProfile total;
+
+        file << "{\n  \"epochs\": [\n";
+        for (auto it = epochs.begin(); it != epochs.end(); ++it)
+        {
+            const EpochProfile &profile = it->second;
+            for (size_t p = 0; p < phaseCount; ++p)
+            {
+                total.phases[p].calls += profile.phases[p].calls;
+                total.phases[p].nanoseconds += profile.phases[p].nanoseconds;
+            }
+            for (size_t c = 0; c < counterCount; ++c)
+                total.counters[c] += profile.counters[c];
+
+            file << "    {\"epoch\": " << it->first << ", ";
+            writePhases(file, profile.phases, profile.counters);
+            file << "}" << (next(it) != epochs.end() ? "," : "") << "\n";
+        }
+        file << "  ],\n  \"total\": {";
+        writePhases(file, total.phases, total.counters);
+        file << "}\n}\n";
+    }
+
+    void Profiler::exportChromeTrace(const string &filename)
+    {
+        ofstream file(filename);
+        if (!file.is_open())
+            throw runtime_error("Could not open file for trace export: " + filename);
+
+        lock_guard<mutex> guard(lock);
+        file << "{\"traceEvents\": [\n";
+
+        bool first = true;
+        char event[192];
+        for (auto &block : blocks)
+        {
+            lock_guard<mutex> traceGuard(block->traceLock);
+            for (const TraceEvent &e : block->trace)
+            {
+                // Chrome trace timestamps are microseconds.
+                snprintf(event, sizeof(event),
+                         "%s{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 0, \"tid\": %zu}",
+                         first ? "" : ",\n", phaseName(e.phase), e.start / 1e3, e.duration / 1e3, block->id);
+                file << event;
+                first = false;
+            }
+        }
+        file << "\n], \"displayTimeUnit\": \"ns\"}\n";
+    }
+}
@@ -0,0 +1,365 @@
+#include "kernels.hpp"
+#include "node.hpp"
+#include "half_float.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace kernels
+{
+    namespace
+    {
+        void axpy(float a, const float *x, float *y, size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+                y[i] += a * x[i];
+        }
+
+        float dotAccumulate(const float *weights, const float *deltas, float value, float *gradients, size_t n)
+        {
+            float sum = 0.0f;
+            for (size_t i = 0; i < n; ++i)
+            {
+                sum += weights[i] * deltas[i];
+                gradients[i] += value * deltas[i];
+            }
+            return sum;
+        }
+
+        // In place, shifted by the row maximum so exp() never overflows.
+        void softmaxRows(float *values, size_t rowCount, size_t n)
+        {
+            for (size_t r = 0; r < rowCount; ++r, values += n)
+            {
+                const float peak = *max_element(values, values + n);
+                float sum = 0.0f;
+                for (size_t j = 0; j < n; ++j)
+                {
+                    values[j] = exp(values[j] - peak);
+                    sum += values[j];
+                }
+
+                const float scale = 1.0f / sum;
+                for (size_t j = 0; j < n; ++j)
+                    values[j] *= scale;
+            }
+        }
+
+        template <Activation A>
+        void denseActivate(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                           const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+
+                copy(biases, biases + targetCount, target);
+
+                const float *row = weights;
+                for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                {
+                    axpy(source[i], row, target, targetCount);
+                }
+
+                float *derivative = derivatives ? derivatives + r * targetCount : nullptr;
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float d;
+                    target[j] = activate<A>(target[j], d);
+                    if (derivative)
+                        derivative[j] = d;
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        void denseBatch(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                        const float *biases, size_t targetCount, Activation activation, float *targets,
+                        float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseActivate<decltype(a)::value>(sources, rowCount, sourceCount, weights, biases,
+                                                               targetCount, targets, derivatives); });
+        }
+
+        void multiply(const float *factors, float *values, size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+                values[i] *= factors[i];
+        }
+
+        template <WeightFormat F>
+        inline float decode(const void *weights, size_t index, float scale, float offset)
+        {
+            if constexpr (F == WeightFormat::Int8)
+                return static_cast<const int8_t *>(weights)[index] * scale + offset;
+            else if constexpr (F == WeightFormat::Float16)
+                return numeric::halfToFloat(static_cast<const uint16_t *>(weights)[index]);
+            else
+                return numeric::bfloat16ToFloat(static_cast<const uint16_t *>(weights)[index]);
+        }
+
+        template <Activation A, WeightFormat F>
+        void denseReducedActivate(const float *sources, size_t rowCount, size_t sourceCount,
+                                  const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                  float *targets)
+        {
+            const float offset = -weights.scale * weights.zeroPoint;
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+
+                copy(biases, biases + targetCount, target);
+                for (size_t i = 0; i < sourceCount; ++i)
+                {
+                    for (size_t j = 0; j < targetCount; ++j)
+                        target[j] += source[i] * decode<F>(weights.data, i * targetCount + j, weights.scale, offset);
+                }
+
+                float d;
+                for (size_t j = 0; j < targetCount; ++j)
+                    target[j] = activate<A>(target[j], d);
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        template <WeightFormat F>
+        void denseReducedAs(const float *sources, size_t rowCount, size_t sourceCount, const ReducedWeights &weights,
+                            const float *biases, size_t targetCount, Activation activation, float *targets)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseReducedActivate<decltype(a)::value, F>(sources, rowCount, sourceCount, weights,
+                                                                         biases, targetCount, targets); });
+        }
+
+        void denseReduced(const float *sources, size_t rowCount, size_t sourceCount, const ReducedWeights &weights,
+                          const float *biases, size_t targetCount, Activation activation, float *targets)
+        {
+            switch (weights.format)
+            {
+            case WeightFormat::Int8:
+                return denseReducedAs<WeightFormat::Int8>(sources, rowCount, sourceCount, weights, biases,
+                                                          targetCount, activation, targets);
+            case WeightFormat::Float16:
+                return denseReducedAs<WeightFormat::Float16>(sources, rowCount, sourceCount, weights, biases,
+                                                             targetCount, activation, targets);
+            default:
+                return denseReducedAs<WeightFormat::BFloat16>(sources, rowCount, sourceCount, weights, biases,
+                                                              targetCount, activation, targets);
+            }
+        }
+
+        // Softmax down each lane of [targetCount][sparseLanes] values.
+        void softmaxLanes(float *values, size_t targetCount)
+        {
+            for (size_t r = 0; r < sparseLanes; ++r)
+            {
+                float peak = values[r];
+                for (size_t j = 1; j < targetCount; ++j)
+                    peak = max(peak, values[j * sparseLanes + r]);
+                float sum = 0.0f;
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float &value = values[j * sparseLanes + r];
+                    value = exp(value - peak);
+                    sum += value;
+                }
+                for (size_t j = 0; j < targetCount; ++j)
+                    values[j * sparseLanes + r] /= sum;
+            }
+        }
+
+        template <Activation A>
+        void sparseActivate(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                            const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            for (size_t j = 0; j < targetCount; ++j)
+                fill(targets + j * sparseLanes, targets + (j + 1) * sparseLanes, biases[j]);
+
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const float *source = sources + i * sparseLanes;
+                if (all_of(source, source + sparseLanes, [](float v)
+                           { return v == 0.0f; }))
+                    continue;
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                    axpy(weights.values[e], source, targets + weights.columns[e] * sparseLanes, sparseLanes);
+            }
+
+            for (size_t i = 0; i < targetCount * sparseLanes; ++i)
+            {
+                float d;
+                targets[i] = activate<A>(targets[i], d);
+                if (derivatives)
+                    derivatives[i] = d;
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxLanes(targets, targetCount);
+        }
+
+        void sparseForward(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                           const float *biases, size_t targetCount, Activation activation, float *targets,
+                           float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { sparseActivate<decltype(a)::value>(sources, sourceCount, weights, biases, targetCount,
+                                                                targets, derivatives); });
+        }
+
+        void sparseBackward(const float *sources, const float *targetDeltas, size_t sourceCount,
+                            const SparseWeights &weights, float *gradients, float *sourceDeltas)
+        {
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const float *source = sources + i * sparseLanes;
+                float delta[sparseLanes] = {};
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    const float *targetDelta = targetDeltas + weights.columns[e] * sparseLanes;
+                    float gradient = 0.0f;
+                    for (size_t r = 0; r < sparseLanes; ++r)
+                    {
+                        delta[r] += weights.values[e] * targetDelta[r];
+                        gradient += source[r] * targetDelta[r];
+                    }
+                    gradients[e] += gradient;
+                }
+                if (sourceDeltas)
+                    copy(delta, delta + sparseLanes, sourceDeltas + i * sparseLanes);
+            }
+        }
+
+        const KernelTable scalarTable = {
+            Backend::Scalar, "scalar",
+            axpy, dotAccumulate, denseBatch, multiply,
+            denseReduced,
+            sparseForward, sparseBackward};
+
+        bool cpuSupports(Backend backend)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            switch (backend)
+            {
+            case Backend::Avx2:
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+                       __builtin_cpu_supports("f16c");
+            case Backend::Avx512:
+                return __builtin_cpu_supports("avx512f");
+            default:
+                break;
+            }
+#endif
+            return backend == Backend::Scalar || backend == Backend::Neon;
+        }
+
+        const KernelTable *tableFor(Backend backend)
+        {
+            switch (backend)
+            {
+            case Backend::Avx2:
+                return avx2Kernels();
+            case Backend::Avx512:
+                return avx512Kernels();
+            case Backend::Neon:
+                return neonKernels();
+            default:
+                return scalarKernels();
+            }
+        }
+
+        bool selectStartupBackend()
+        {
+            const char *requested = getenv("NN_KERNELS");
+            if (requested)
+            {
+                for (Backend backend : {Backend::Scalar, Backend::Avx2, Backend::Avx512, Backend::Neon})
+                {
+                    if (strcmp(requested, backendName(backend)) == 0 && setBackend(backend))
+                        return true;
+                }
+            }
+
+            for (Backend backend : {Backend::Avx512, Backend::Avx2, Backend::Neon})
+            {
+                if (setBackend(backend))
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    const KernelTable *activeTable = &scalarTable;
+
+    namespace
+    {
+        [[maybe_unused]] const bool startupBackendSelected = selectStartupBackend();
+    }
+
+    const KernelTable *scalarKernels()
+    {
+        return &scalarTable;
+    }
+
+    bool isSupported(Backend backend)
+    {
+        return tableFor(backend) != nullptr && cpuSupports(backend);
+    }
+
+    bool setBackend(Backend backend)
+    {
+        if (!isSupported(backend))
+            return false;
+
+        activeTable = tableFor(backend);
+        return true;
+    }
+
+    const char *backendName(Backend backend)
+    {
+        switch (backend)
+        {
+        case Backend::Avx2:
+            return "avx2";
+        case Backend::Avx512:
+            return "avx512";
+        case Backend::Neon:
+            return "neon";
+        default:
+            return "scalar";
+        }
+    }
+
+    namespace
+    {
+        const char *const activationNames[activationCount] = {
+            "identity", "leaky_relu", "relu", "tanh", "gelu", "sigmoid", "softmax"};
+    }
+
+    const char *activationName(Activation activation)
+    {
+        const size_t index = static_cast<size_t>(activation);
+        return index < activationCount ? activationNames[index] : "unknown";
+    }
+
+    bool parseActivation(const char *name, Activation &activation)
+    {
+        for (size_t i = 0; i < activationCount; ++i)
+        {
+            if (strcmp(name, activationNames[i]) == 0)
+            {
+                activation = static_cast<Activation>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+}
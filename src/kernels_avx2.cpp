@@ -0,0 +1,595 @@
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+#include <cstdint>
+
+// F16C ships with every AVX2 CPU and supplies the half-precision loads.
+#define AVX2_TARGET __attribute__((target("avx2,fma,f16c")))
+
+namespace kernels
+{
+    namespace
+    {
+        const int32_t maskTable[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        // Lane mask enabling the first n (< 8) lanes.
+        AVX2_TARGET inline __m256i tailMask(size_t n)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(maskTable + 8 - n));
+        }
+
+        AVX2_TARGET inline float horizontalSum(__m256 v)
+        {
+            __m128 low = _mm256_castps256_ps128(v);
+            __m128 high = _mm256_extractf128_ps(v, 1);
+            low = _mm_add_ps(low, high);
+            low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+            low = _mm_add_ss(low, _mm_movehdup_ps(low));
+            return _mm_cvtss_f32(low);
+        }
+
+        // Cephes-style expf: range reduction by ln2, degree-5 polynomial,
+        // exponent rebuilt from integer bits. Max error ~2 ulp on [-87, 88].
+        AVX2_TARGET inline __m256 exp256(__m256 x)
+        {
+            x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.0f)), _mm256_set1_ps(88.0f));
+
+            __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+                                       _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+            x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+
+            __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+            y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+            y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+            __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+            return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+        }
+
+        AVX2_TARGET inline __m256 sigmoid256(__m256 x)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            __m256 e = exp256(_mm256_sub_ps(_mm256_setzero_ps(), x));
+            return _mm256_div_ps(one, _mm256_add_ps(one, e));
+        }
+
+        AVX2_TARGET inline __m256 relu256(__m256 x)
+        {
+            __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+            return _mm256_blendv_ps(_mm256_mul_ps(x, _mm256_set1_ps(0.01f)), x, positive);
+        }
+
+        AVX2_TARGET inline __m256 reluDerivative256(__m256 x)
+        {
+            __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+            return _mm256_blendv_ps(_mm256_set1_ps(0.01f), _mm256_set1_ps(1.0f), positive);
+        }
+
+        AVX2_TARGET inline __m256 sigmoidDerivative256(__m256 s)
+        {
+            return _mm256_mul_ps(s, _mm256_sub_ps(_mm256_set1_ps(1.0f), s));
+        }
+
+        // Cephes-style tanhf: odd polynomial below |x| = 0.625, otherwise
+        // 1 - 2 / (exp(2|x|) + 1) with the sign put back. Max relative error
+        // ~1.3e-7 over the whole range, so small inputs keep their precision.
+        AVX2_TARGET inline __m256 tanh256(__m256 x)
+        {
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 a = _mm256_andnot_ps(signMask, x);
+
+            const __m256 z = _mm256_mul_ps(x, x);
+            __m256 p = _mm256_set1_ps(-5.70498872745e-3f);
+            p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.06390887954e-2f));
+            p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-5.37397155531e-2f));
+            p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.33314422036e-1f));
+            p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-3.33332819422e-1f));
+            const __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+
+            __m256 e = exp256(_mm256_add_ps(a, a));
+            __m256 large = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, one)));
+            large = _mm256_or_ps(large, _mm256_and_ps(signMask, x));
+
+            return _mm256_blendv_ps(large, small, _mm256_cmp_ps(a, _mm256_set1_ps(0.625f), _CMP_LT_OQ));
+        }
+
+        template <Activation A>
+        AVX2_TARGET inline __m256 activate256(__m256 x, __m256 &derivative)
+        {
+            if constexpr (A == Activation::LeakyRelu)
+            {
+                derivative = reluDerivative256(x);
+                return relu256(x);
+            }
+            else if constexpr (A == Activation::Relu)
+            {
+                __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+                derivative = _mm256_and_ps(positive, _mm256_set1_ps(1.0f));
+                return _mm256_and_ps(positive, x);
+            }
+            else if constexpr (A == Activation::Tanh)
+            {
+                __m256 t = tanh256(x);
+                derivative = _mm256_fnmadd_ps(t, t, _mm256_set1_ps(1.0f));
+                return t;
+            }
+            else if constexpr (A == Activation::Gelu)
+            {
+                const __m256 x2 = _mm256_mul_ps(x, x);
+                __m256 s = sigmoid256(_mm256_mul_ps(x, _mm256_fmadd_ps(_mm256_set1_ps(geluCubic), x2,
+                                                                        _mm256_set1_ps(geluLinear))));
+                __m256 slope = _mm256_fmadd_ps(_mm256_set1_ps(3.0f * geluCubic), x2, _mm256_set1_ps(geluLinear));
+                derivative = _mm256_fmadd_ps(_mm256_mul_ps(x, sigmoidDerivative256(s)), slope, s);
+                return _mm256_mul_ps(x, s);
+            }
+            else if constexpr (A == Activation::Sigmoid)
+            {
+                __m256 s = sigmoid256(x);
+                derivative = sigmoidDerivative256(s);
+                return s;
+            }
+            else
+            {
+                derivative = _mm256_set1_ps(1.0f);
+                return x;
+            }
+        }
+
+        // Activates acc and stores it, plus its derivative when requested.
+        template <Activation A>
+        AVX2_TARGET inline void storeActivated(__m256 acc, float *target, float *derivative, bool full, __m256i mask)
+        {
+            __m256 d;
+            __m256 y = activate256<A>(acc, d);
+            if (full)
+            {
+                _mm256_storeu_ps(target, y);
+                if (derivative)
+                    _mm256_storeu_ps(derivative, d);
+            }
+            else
+            {
+                _mm256_maskstore_ps(target, mask, y);
+                if (derivative)
+                    _mm256_maskstore_ps(derivative, mask, d);
+            }
+        }
+
+        AVX2_TARGET void axpy(float a, const float *x, float *y, size_t n)
+        {
+            const __m256 va = _mm256_set1_ps(a);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+            }
+            if (i < n)
+            {
+                __m256i mask = tailMask(n - i);
+                __m256 vy = _mm256_fmadd_ps(va, _mm256_maskload_ps(x + i, mask), _mm256_maskload_ps(y + i, mask));
+                _mm256_maskstore_ps(y + i, mask, vy);
+            }
+        }
+
+        AVX2_TARGET float dotAccumulate(const float *weights, const float *deltas, float value, float *gradients, size_t n)
+        {
+            const __m256 vvalue = _mm256_set1_ps(value);
+            __m256 sum = _mm256_setzero_ps();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 d = _mm256_loadu_ps(deltas + i);
+                sum = _mm256_fmadd_ps(_mm256_loadu_ps(weights + i), d, sum);
+                _mm256_storeu_ps(gradients + i, _mm256_fmadd_ps(vvalue, d, _mm256_loadu_ps(gradients + i)));
+            }
+            if (i < n)
+            {
+                __m256i mask = tailMask(n - i);
+                __m256 d = _mm256_maskload_ps(deltas + i, mask);
+                sum = _mm256_fmadd_ps(_mm256_maskload_ps(weights + i, mask), d, sum);
+                _mm256_maskstore_ps(gradients + i, mask,
+                                    _mm256_fmadd_ps(vvalue, d, _mm256_maskload_ps(gradients + i, mask)));
+            }
+            return horizontalSum(sum);
+        }
+        AVX2_TARGET inline float horizontalMax(__m256 v)
+        {
+            __m128 low = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            low = _mm_max_ps(low, _mm_movehl_ps(low, low));
+            low = _mm_max_ss(low, _mm_movehdup_ps(low));
+            return _mm_cvtss_f32(low);
+        }
+
+        // In place, shifted by the row maximum so exp256 never overflows.
+        AVX2_TARGET void softmaxRows(float *values, size_t rowCount, size_t n)
+        {
+            for (size_t r = 0; r < rowCount; ++r, values += n)
+            {
+                size_t j = 0;
+                __m256 vpeak = _mm256_set1_ps(values[0]);
+                for (; j + 8 <= n; j += 8)
+                    vpeak = _mm256_max_ps(vpeak, _mm256_loadu_ps(values + j));
+                float peak = horizontalMax(vpeak);
+                for (; j < n; ++j)
+                    peak = values[j] > peak ? values[j] : peak;
+
+                const __m256 shift = _mm256_set1_ps(peak);
+                __m256 vsum = _mm256_setzero_ps();
+                for (j = 0; j + 8 <= n; j += 8)
+                {
+                    __m256 e = exp256(_mm256_sub_ps(_mm256_loadu_ps(values + j), shift));
+                    _mm256_storeu_ps(values + j, e);
+                    vsum = _mm256_add_ps(vsum, e);
+                }
+                const __m256i mask = tailMask(n - j);
+                if (j < n)
+                {
+                    __m256 e = exp256(_mm256_sub_ps(_mm256_maskload_ps(values + j, mask), shift));
+                    _mm256_maskstore_ps(values + j, mask, e);
+                    vsum = _mm256_add_ps(vsum, _mm256_and_ps(e, _mm256_castsi256_ps(mask)));
+                }
+
+                const __m256 scale = _mm256_set1_ps(1.0f / horizontalSum(vsum));
+                for (j = 0; j + 8 <= n; j += 8)
+                    _mm256_storeu_ps(values + j, _mm256_mul_ps(_mm256_loadu_ps(values + j), scale));
+                if (j < n)
+                    _mm256_maskstore_ps(values + j, mask, _mm256_mul_ps(_mm256_maskload_ps(values + j, mask), scale));
+            }
+        }
+
+        // Four rows share every weight load; columns go eight at a time
+        // with a masked tail.
+        template <Activation A>
+        AVX2_TARGET void denseActivate(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                                       const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            size_t r = 0;
+            for (; r + 4 <= rowCount; r += 4)
+            {
+                const float *s0 = sources + r * sourceCount;
+                const float *s1 = s0 + sourceCount;
+                const float *s2 = s1 + sourceCount;
+                const float *s3 = s2 + sourceCount;
+                float *t0 = targets + r * targetCount;
+                float *d0 = derivatives ? derivatives + r * targetCount : nullptr;
+
+                for (size_t j = 0; j < targetCount; j += 8)
+                {
+                    const size_t width = (targetCount - j < 8) ? targetCount - j : 8;
+                    const __m256i mask = tailMask(width == 8 ? 0 : width);
+                    const bool full = width == 8;
+
+                    __m256 bias = full ? _mm256_loadu_ps(biases + j) : _mm256_maskload_ps(biases + j, mask);
+                    __m256 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+
+                    const float *row = weights + j;
+                    for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                    {
+                        __m256 w = full ? _mm256_loadu_ps(row) : _mm256_maskload_ps(row, mask);
+                        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(s0[i]), w, acc0);
+                        acc1 = _mm256_fmadd_ps(_mm256_set1_ps(s1[i]), w, acc1);
+                        acc2 = _mm256_fmadd_ps(_mm256_set1_ps(s2[i]), w, acc2);
+                        acc3 = _mm256_fmadd_ps(_mm256_set1_ps(s3[i]), w, acc3);
+                    }
+
+                    float *t = t0 + j;
+                    float *d = d0 ? d0 + j : nullptr;
+                    storeActivated<A>(acc0, t, d, full, mask);
+                    storeActivated<A>(acc1, t + targetCount, d ? d + targetCount : nullptr, full, mask);
+                    storeActivated<A>(acc2, t + 2 * targetCount, d ? d + 2 * targetCount : nullptr, full, mask);
+                    storeActivated<A>(acc3, t + 3 * targetCount, d ? d + 3 * targetCount : nullptr, full, mask);
+                }
+            }
+
+            for (; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+                float *derivative = derivatives ? derivatives + r * targetCount : nullptr;
+
+                for (size_t j = 0; j < targetCount; j += 8)
+                {
+                    const size_t width = (targetCount - j < 8) ? targetCount - j : 8;
+                    const __m256i mask = tailMask(width == 8 ? 0 : width);
+                    const bool full = width == 8;
+
+                    __m256 acc = full ? _mm256_loadu_ps(biases + j) : _mm256_maskload_ps(biases + j, mask);
+                    const float *row = weights + j;
+                    for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                    {
+                        __m256 w = full ? _mm256_loadu_ps(row) : _mm256_maskload_ps(row, mask);
+                        acc = _mm256_fmadd_ps(_mm256_set1_ps(source[i]), w, acc);
+                    }
+
+                    storeActivated<A>(acc, target + j, derivative ? derivative + j : nullptr, full, mask);
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        AVX2_TARGET void denseBatch(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                                    const float *biases, size_t targetCount, Activation activation, float *targets,
+                                    float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseActivate<decltype(a)::value>(sources, rowCount, sourceCount, weights, biases,
+                                                               targetCount, targets, derivatives); });
+        }
+
+        AVX2_TARGET void multiply(const float *factors, float *values, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                _mm256_storeu_ps(values + i, _mm256_mul_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(factors + i)));
+            }
+            if (i < n)
+            {
+                __m256i mask = tailMask(n - i);
+                _mm256_maskstore_ps(values + i, mask,
+                                    _mm256_mul_ps(_mm256_maskload_ps(values + i, mask), _mm256_maskload_ps(factors + i, mask)));
+            }
+        }
+
+        // Eight weights from entry `index`, widened and decoded to float.
+        template <WeightFormat F>
+        AVX2_TARGET inline __m256 loadReduced(const void *weights, size_t index, __m256 scale, __m256 offset)
+        {
+            if constexpr (F == WeightFormat::Int8)
+            {
+                const int8_t *q = static_cast<const int8_t *>(weights) + index;
+                __m256i values = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(q)));
+                return _mm256_fmadd_ps(_mm256_cvtepi32_ps(values), scale, offset);
+            }
+            else
+            {
+                const uint16_t *h = static_cast<const uint16_t *>(weights) + index;
+                __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h));
+                if constexpr (F == WeightFormat::Float16)
+                    return _mm256_cvtph_ps(halves);
+                else
+                    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(halves), 16));
+            }
+        }
+
+        // Same blocking as denseActivate; thanks to the buffer padding every
+        // weight load is full width and only the stores are masked.
+        template <Activation A, WeightFormat F>
+        AVX2_TARGET void denseReducedActivate(const float *sources, size_t rowCount, size_t sourceCount,
+                                              const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                              float *targets)
+        {
+            const __m256 scale = _mm256_set1_ps(weights.scale);
+            const __m256 offset = _mm256_set1_ps(-weights.scale * weights.zeroPoint);
+
+            size_t r = 0;
+            for (; r + 4 <= rowCount; r += 4)
+            {
+                const float *s0 = sources + r * sourceCount;
+                const float *s1 = s0 + sourceCount;
+                const float *s2 = s1 + sourceCount;
+                const float *s3 = s2 + sourceCount;
+                float *t0 = targets + r * targetCount;
+
+                for (size_t j = 0; j < targetCount; j += 8)
+                {
+                    const size_t width = (targetCount - j < 8) ? targetCount - j : 8;
+                    const __m256i mask = tailMask(width == 8 ? 0 : width);
+                    const bool full = width == 8;
+
+                    __m256 bias = full ? _mm256_loadu_ps(biases + j) : _mm256_maskload_ps(biases + j, mask);
+                    __m256 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+
+                    for (size_t i = 0; i < sourceCount; ++i)
+                    {
+                        __m256 w = loadReduced<F>(weights.data, i * targetCount + j, scale, offset);
+                        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(s0[i]), w, acc0);
+                        acc1 = _mm256_fmadd_ps(_mm256_set1_ps(s1[i]), w, acc1);
+                        acc2 = _mm256_fmadd_ps(_mm256_set1_ps(s2[i]), w, acc2);
+                        acc3 = _mm256_fmadd_ps(_mm256_set1_ps(s3[i]), w, acc3);
+                    }
+
+                    float *t = t0 + j;
+                    storeActivated<A>(acc0, t, nullptr, full, mask);
+                    storeActivated<A>(acc1, t + targetCount, nullptr, full, mask);
+                    storeActivated<A>(acc2, t + 2 * targetCount, nullptr, full, mask);
+                    storeActivated<A>(acc3, t + 3 * targetCount, nullptr, full, mask);
+                }
+            }
+
+            for (; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+
+                for (size_t j = 0; j < targetCount; j += 8)
+                {
+                    const size_t width = (targetCount - j < 8) ? targetCount - j : 8;
+                    const __m256i mask = tailMask(width == 8 ? 0 : width);
+                    const bool full = width == 8;
+
+                    __m256 acc = full ? _mm256_loadu_ps(biases + j) : _mm256_maskload_ps(biases + j, mask);
+                    for (size_t i = 0; i < sourceCount; ++i)
+                    {
+                        __m256 w = loadReduced<F>(weights.data, i * targetCount + j, scale, offset);
+                        acc = _mm256_fmadd_ps(_mm256_set1_ps(source[i]), w, acc);
+                    }
+                    storeActivated<A>(acc, target + j, nullptr, full, mask);
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        template <WeightFormat F>
+        AVX2_TARGET void denseReducedAs(const float *sources, size_t rowCount, size_t sourceCount,
+                                        const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                        Activation activation, float *targets)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseReducedActivate<decltype(a)::value, F>(sources, rowCount, sourceCount, weights,
+                                                                         biases, targetCount, targets); });
+        }
+
+        AVX2_TARGET void denseReduced(const float *sources, size_t rowCount, size_t sourceCount,
+                                      const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                      Activation activation, float *targets)
+        {
+            switch (weights.format)
+            {
+            case WeightFormat::Int8:
+                return denseReducedAs<WeightFormat::Int8>(sources, rowCount, sourceCount, weights, biases,
+                                                          targetCount, activation, targets);
+            case WeightFormat::Float16:
+                return denseReducedAs<WeightFormat::Float16>(sources, rowCount, sourceCount, weights, biases,
+                                                             targetCount, activation, targets);
+            default:
+                return denseReducedAs<WeightFormat::BFloat16>(sources, rowCount, sourceCount, weights, biases,
+                                                              targetCount, activation, targets);
+            }
+        }
+
+        // Lanes are two vector halves throughout.
+        static_assert(sparseLanes == 16, "sparse kernels assume two vectors per node");
+
+        // Softmax down each lane of [targetCount][sparseLanes] values.
+        AVX2_TARGET void softmaxLanes(float *values, size_t targetCount)
+        {
+            for (size_t half = 0; half < sparseLanes; half += 8)
+            {
+                __m256 peak = _mm256_loadu_ps(values + half);
+                for (size_t j = 1; j < targetCount; ++j)
+                    peak = _mm256_max_ps(peak, _mm256_loadu_ps(values + j * sparseLanes + half));
+
+                __m256 sum = _mm256_setzero_ps();
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float *value = values + j * sparseLanes + half;
+                    __m256 e = exp256(_mm256_sub_ps(_mm256_loadu_ps(value), peak));
+                    _mm256_storeu_ps(value, e);
+                    sum = _mm256_add_ps(sum, e);
+                }
+
+                const __m256 scale = _mm256_div_ps(_mm256_set1_ps(1.0f), sum);
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float *value = values + j * sparseLanes + half;
+                    _mm256_storeu_ps(value, _mm256_mul_ps(_mm256_loadu_ps(value), scale));
+                }
+            }
+        }
+
+        // Scatters each source's lanes along its edges: the source stays in
+        // two registers while every edge broadcasts its weight into one
+        // contiguous run of target lanes.
+        template <Activation A>
+        AVX2_TARGET void sparseActivate(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                                        const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            for (size_t j = 0; j < targetCount; ++j)
+            {
+                const __m256 bias = _mm256_set1_ps(biases[j]);
+                _mm256_storeu_ps(targets + j * sparseLanes, bias);
+                _mm256_storeu_ps(targets + j * sparseLanes + 8, bias);
+            }
+
+            const __m256 zero = _mm256_setzero_ps();
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const __m256 s0 = _mm256_loadu_ps(sources + i * sparseLanes);
+                const __m256 s1 = _mm256_loadu_ps(sources + i * sparseLanes + 8);
+                if (!_mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(s0, zero, _CMP_NEQ_UQ),
+                                                     _mm256_cmp_ps(s1, zero, _CMP_NEQ_UQ))))
+                    continue;
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    float *target = targets + weights.columns[e] * sparseLanes;
+                    const __m256 w = _mm256_set1_ps(weights.values[e]);
+                    _mm256_storeu_ps(target, _mm256_fmadd_ps(s0, w, _mm256_loadu_ps(target)));
+                    _mm256_storeu_ps(target + 8, _mm256_fmadd_ps(s1, w, _mm256_loadu_ps(target + 8)));
+                }
+            }
+
+            const __m256i none = tailMask(0);
+            for (size_t i = 0; i < targetCount * sparseLanes; i += 8)
+                storeActivated<A>(_mm256_loadu_ps(targets + i), targets + i, derivatives ? derivatives + i : nullptr,
+                                  true, none);
+
+            if constexpr (A == Activation::Softmax)
+                softmaxLanes(targets, targetCount);
+        }
+
+        AVX2_TARGET void sparseForward(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                                       const float *biases, size_t targetCount, Activation activation,
+                                       float *targets, float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { sparseActivate<decltype(a)::value>(sources, sourceCount, weights, biases, targetCount,
+                                                                targets, derivatives); });
+        }
+
+        AVX2_TARGET void sparseBackward(const float *sources, const float *targetDeltas, size_t sourceCount,
+                                        const SparseWeights &weights, float *gradients, float *sourceDeltas)
+        {
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const __m256 s0 = _mm256_loadu_ps(sources + i * sparseLanes);
+                const __m256 s1 = _mm256_loadu_ps(sources + i * sparseLanes + 8);
+                __m256 delta0 = _mm256_setzero_ps();
+                __m256 delta1 = _mm256_setzero_ps();
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    const float *targetDelta = targetDeltas + weights.columns[e] * sparseLanes;
+                    const __m256 t0 = _mm256_loadu_ps(targetDelta);
+                    const __m256 t1 = _mm256_loadu_ps(targetDelta + 8);
+                    const __m256 w = _mm256_set1_ps(weights.values[e]);
+                    delta0 = _mm256_fmadd_ps(w, t0, delta0);
+                    delta1 = _mm256_fmadd_ps(w, t1, delta1);
+                    gradients[e] += horizontalSum(_mm256_fmadd_ps(s0, t0, _mm256_mul_ps(s1, t1)));
+                }
+
+                if (sourceDeltas)
+                {
+                    _mm256_storeu_ps(sourceDeltas + i * sparseLanes, delta0);
+                    _mm256_storeu_ps(sourceDeltas + i * sparseLanes + 8, delta1);
+                }
+            }
+        }
+
+        const KernelTable avx2Table = {
+            Backend::Avx2, "avx2",
+            axpy, dotAccumulate, denseBatch, multiply,
+            denseReduced,
+            sparseForward, sparseBackward};
+    }
+
+    const KernelTable *avx2Kernels()
+    {
+        return &avx2Table;
+    }
+}
+
+#else
+
+namespace kernels
+{
+    const KernelTable *avx2Kernels()
+    {
+        return nullptr;
+    }
+}
+
+#endif
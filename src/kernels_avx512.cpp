@@ -0,0 +1,526 @@
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// GCC 12's avx512fintrin.h seeds results with _mm512_undefined_ps(), which
+// trips -Wuninitialized once inlined (GCC PR 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+namespace kernels
+{
+    namespace
+    {
+        // Lane mask enabling the first n (<= 16) lanes.
+        inline __mmask16 tailMask(size_t n)
+        {
+            return static_cast<__mmask16>((1u << n) - 1u);
+        }
+
+        // Same Cephes-style expf as the AVX2 path; scalef rebuilds 2^n.
+        AVX512_TARGET inline __m512 exp512(__m512 x)
+        {
+            x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-87.0f)), _mm512_set1_ps(88.0f));
+
+            __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+                                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            x = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+            x = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), x);
+
+            __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+            y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507e-3f));
+            y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073e-3f));
+            y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894e-2f));
+            y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459e-1f));
+            y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201e-1f));
+            y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x), _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+
+            return _mm512_scalef_ps(y, n);
+        }
+
+        AVX512_TARGET inline __m512 sigmoid512(__m512 x)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f);
+            __m512 e = exp512(_mm512_sub_ps(_mm512_setzero_ps(), x));
+            return _mm512_div_ps(one, _mm512_add_ps(one, e));
+        }
+
+        AVX512_TARGET inline __m512 relu512(__m512 x)
+        {
+            __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+            return _mm512_mask_blend_ps(positive, _mm512_mul_ps(x, _mm512_set1_ps(0.01f)), x);
+        }
+
+        AVX512_TARGET inline __m512 reluDerivative512(__m512 x)
+        {
+            __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+            return _mm512_mask_blend_ps(positive, _mm512_set1_ps(0.01f), _mm512_set1_ps(1.0f));
+        }
+
+        AVX512_TARGET inline __m512 sigmoidDerivative512(__m512 s)
+        {
+            return _mm512_mul_ps(s, _mm512_sub_ps(_mm512_set1_ps(1.0f), s));
+        }
+
+        // Same Cephes-style tanhf as the AVX2 path.
+        AVX512_TARGET inline __m512 tanh512(__m512 x)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f);
+            const __m512 a = _mm512_abs_ps(x);
+
+            const __m512 z = _mm512_mul_ps(x, x);
+            __m512 p = _mm512_set1_ps(-5.70498872745e-3f);
+            p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(2.06390887954e-2f));
+            p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(-5.37397155531e-2f));
+            p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(1.33314422036e-1f));
+            p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(-3.33332819422e-1f));
+            const __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(p, z), x, x);
+
+            __m512 e = exp512(_mm512_add_ps(a, a));
+            __m512 large = _mm512_sub_ps(one, _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(e, one)));
+            const __m512i signBit = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+            large = _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(large),
+                                                        _mm512_and_si512(_mm512_castps_si512(x), signBit)));
+
+            __mmask16 isSmall = _mm512_cmp_ps_mask(a, _mm512_set1_ps(0.625f), _CMP_LT_OQ);
+            return _mm512_mask_blend_ps(isSmall, large, small);
+        }
+
+        template <Activation A>
+        AVX512_TARGET inline __m512 activate512(__m512 x, __m512 &derivative)
+        {
+            if constexpr (A == Activation::LeakyRelu)
+            {
+                derivative = reluDerivative512(x);
+                return relu512(x);
+            }
+            else if constexpr (A == Activation::Relu)
+            {
+                __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+                derivative = _mm512_maskz_mov_ps(positive, _mm512_set1_ps(1.0f));
+                return _mm512_maskz_mov_ps(positive, x);
+            }
+            else if constexpr (A == Activation::Tanh)
+            {
+                __m512 t = tanh512(x);
+                derivative = _mm512_fnmadd_ps(t, t, _mm512_set1_ps(1.0f));
+                return t;
+            }
+            else if constexpr (A == Activation::Gelu)
+            {
+                const __m512 x2 = _mm512_mul_ps(x, x);
+                __m512 s = sigmoid512(_mm512_mul_ps(x, _mm512_fmadd_ps(_mm512_set1_ps(geluCubic), x2,
+                                                                        _mm512_set1_ps(geluLinear))));
+                __m512 slope = _mm512_fmadd_ps(_mm512_set1_ps(3.0f * geluCubic), x2, _mm512_set1_ps(geluLinear));
+                derivative = _mm512_fmadd_ps(_mm512_mul_ps(x, sigmoidDerivative512(s)), slope, s);
+                return _mm512_mul_ps(x, s);
+            }
+            else if constexpr (A == Activation::Sigmoid)
+            {
+                __m512 s = sigmoid512(x);
+                derivative = sigmoidDerivative512(s);
+                return s;
+            }
+            else
+            {
+                derivative = _mm512_set1_ps(1.0f);
+                return x;
+            }
+        }
+
+        // Activates acc and stores it, plus its derivative when requested.
+        template <Activation A>
+        AVX512_TARGET inline void storeActivated(__m512 acc, float *target, float *derivative, __mmask16 mask)
+        {
+            __m512 d;
+            _mm512_mask_storeu_ps(target, mask, activate512<A>(acc, d));
+            if (derivative)
+                _mm512_mask_storeu_ps(derivative, mask, d);
+        }
+
+        AVX512_TARGET void axpy(float a, const float *x, float *y, size_t n)
+        {
+            const __m512 va = _mm512_set1_ps(a);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+            }
+            if (i < n)
+            {
+                __mmask16 mask = tailMask(n - i);
+                __m512 vy = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i));
+                _mm512_mask_storeu_ps(y + i, mask, vy);
+            }
+        }
+
+        AVX512_TARGET float dotAccumulate(const float *weights, const float *deltas, float value, float *gradients, size_t n)
+        {
+            const __m512 vvalue = _mm512_set1_ps(value);
+            __m512 sum = _mm512_setzero_ps();
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 d = _mm512_loadu_ps(deltas + i);
+                sum = _mm512_fmadd_ps(_mm512_loadu_ps(weights + i), d, sum);
+                _mm512_storeu_ps(gradients + i, _mm512_fmadd_ps(vvalue, d, _mm512_loadu_ps(gradients + i)));
+            }
+            if (i < n)
+            {
+                __mmask16 mask = tailMask(n - i);
+                __m512 d = _mm512_maskz_loadu_ps(mask, deltas + i);
+                sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, weights + i), d, sum);
+                _mm512_mask_storeu_ps(gradients + i, mask,
+                                      _mm512_fmadd_ps(vvalue, d, _mm512_maskz_loadu_ps(mask, gradients + i)));
+            }
+            return _mm512_reduce_add_ps(sum);
+        }
+
+        // In place, shifted by the row maximum so exp512 never overflows.
+        AVX512_TARGET void softmaxRows(float *values, size_t rowCount, size_t n)
+        {
+            for (size_t r = 0; r < rowCount; ++r, values += n)
+            {
+                __m512 peak = _mm512_set1_ps(values[0]);
+                for (size_t j = 0; j < n; j += 16)
+                {
+                    const __mmask16 mask = tailMask((n - j < 16) ? n - j : 16);
+                    peak = _mm512_mask_max_ps(peak, mask, peak, _mm512_maskz_loadu_ps(mask, values + j));
+                }
+                const __m512 shift = _mm512_set1_ps(_mm512_reduce_max_ps(peak));
+
+                __m512 sum = _mm512_setzero_ps();
+                for (size_t j = 0; j < n; j += 16)
+                {
+                    const __mmask16 mask = tailMask((n - j < 16) ? n - j : 16);
+                    __m512 e = exp512(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, values + j), shift));
+                    _mm512_mask_storeu_ps(values + j, mask, e);
+                    sum = _mm512_mask_add_ps(sum, mask, sum, e);
+                }
+
+                const __m512 scale = _mm512_set1_ps(1.0f / _mm512_reduce_add_ps(sum));
+                for (size_t j = 0; j < n; j += 16)
+                {
+                    const __mmask16 mask = tailMask((n - j < 16) ? n - j : 16);
+                    _mm512_mask_storeu_ps(values + j, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, values + j), scale));
+                }
+            }
+        }
+
+        // Four rows share every weight load; sixteen columns per step with
+        // masked tails.
+        template <Activation A>
+        AVX512_TARGET void denseActivate(const float *sources, size_t rowCount, size_t sourceCount,
+                                         const float *weights, const float *biases, size_t targetCount,
+                                         float *targets, float *derivatives)
+        {
+            size_t r = 0;
+            for (; r + 4 <= rowCount; r += 4)
+            {
+                const float *s0 = sources + r * sourceCount;
+                const float *s1 = s0 + sourceCount;
+                const float *s2 = s1 + sourceCount;
+                const float *s3 = s2 + sourceCount;
+                float *t0 = targets + r * targetCount;
+                float *d0 = derivatives ? derivatives + r * targetCount : nullptr;
+
+                for (size_t j = 0; j < targetCount; j += 16)
+                {
+                    const __mmask16 mask = tailMask((targetCount - j < 16) ? targetCount - j : 16);
+
+                    __m512 bias = _mm512_maskz_loadu_ps(mask, biases + j);
+                    __m512 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+
+                    const float *row = weights + j;
+                    for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                    {
+                        __m512 w = _mm512_maskz_loadu_ps(mask, row);
+                        acc0 = _mm512_fmadd_ps(_mm512_set1_ps(s0[i]), w, acc0);
+                        acc1 = _mm512_fmadd_ps(_mm512_set1_ps(s1[i]), w, acc1);
+                        acc2 = _mm512_fmadd_ps(_mm512_set1_ps(s2[i]), w, acc2);
+                        acc3 = _mm512_fmadd_ps(_mm512_set1_ps(s3[i]), w, acc3);
+                    }
+
+                    float *t = t0 + j;
+                    float *d = d0 ? d0 + j : nullptr;
+                    storeActivated<A>(acc0, t, d, mask);
+                    storeActivated<A>(acc1, t + targetCount, d ? d + targetCount : nullptr, mask);
+                    storeActivated<A>(acc2, t + 2 * targetCount, d ? d + 2 * targetCount : nullptr, mask);
+                    storeActivated<A>(acc3, t + 3 * targetCount, d ? d + 3 * targetCount : nullptr, mask);
+                }
+            }
+
+            for (; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+                float *derivative = derivatives ? derivatives + r * targetCount : nullptr;
+
+                for (size_t j = 0; j < targetCount; j += 16)
+                {
+                    const __mmask16 mask = tailMask((targetCount - j < 16) ? targetCount - j : 16);
+
+                    __m512 acc = _mm512_maskz_loadu_ps(mask, biases + j);
+                    const float *row = weights + j;
+                    for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                    {
+                        acc = _mm512_fmadd_ps(_mm512_set1_ps(source[i]), _mm512_maskz_loadu_ps(mask, row), acc);
+                    }
+                    storeActivated<A>(acc, target + j, derivative ? derivative + j : nullptr, mask);
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        AVX512_TARGET void denseBatch(const float *sources, size_t rowCount, size_t sourceCount,
+                                      const float *weights, const float *biases, size_t targetCount,
+                                      Activation activation, float *targets, float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseActivate<decltype(a)::value>(sources, rowCount, sourceCount, weights, biases,
+                                                               targetCount, targets, derivatives); });
+        }
+
+        AVX512_TARGET void multiply(const float *factors, float *values, size_t n)
+        {
+            for (size_t i = 0; i < n; i += 16)
+            {
+                __mmask16 mask = tailMask((n - i < 16) ? n - i : 16);
+                _mm512_mask_storeu_ps(values + i, mask,
+                                      _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, values + i),
+                                                    _mm512_maskz_loadu_ps(mask, factors + i)));
+            }
+        }
+
+        // Sixteen weights from entry `index`, widened and decoded to float.
+        template <WeightFormat F>
+        AVX512_TARGET inline __m512 loadReduced(const void *weights, size_t index, __m512 scale, __m512 offset)
+        {
+            if constexpr (F == WeightFormat::Int8)
+            {
+                const int8_t *q = static_cast<const int8_t *>(weights) + index;
+                __m512i values = _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(q)));
+                return _mm512_fmadd_ps(_mm512_cvtepi32_ps(values), scale, offset);
+            }
+            else
+            {
+                const uint16_t *h = static_cast<const uint16_t *>(weights) + index;
+                __m256i halves = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h));
+                if constexpr (F == WeightFormat::Float16)
+                    return _mm512_cvtph_ps(halves);
+                else
+                    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(halves), 16));
+            }
+        }
+
+        // Same blocking as denseActivate; thanks to the buffer padding every
+        // weight load is full width and only the stores are masked.
+        template <Activation A, WeightFormat F>
+        AVX512_TARGET void denseReducedActivate(const float *sources, size_t rowCount, size_t sourceCount,
+                                                const ReducedWeights &weights, const float *biases,
+                                                size_t targetCount, float *targets)
+        {
+            const __m512 scale = _mm512_set1_ps(weights.scale);
+            const __m512 offset = _mm512_set1_ps(-weights.scale * weights.zeroPoint);
+
+            size_t r = 0;
+            for (; r + 4 <= rowCount; r += 4)
+            {
+                const float *s0 = sources + r * sourceCount;
+                const float *s1 = s0 + sourceCount;
+                const float *s2 = s1 + sourceCount;
+                const float *s3 = s2 + sourceCount;
+                float *t0 = targets + r * targetCount;
+
+                for (size_t j = 0; j < targetCount; j += 16)
+                {
+                    const __mmask16 mask = tailMask((targetCount - j < 16) ? targetCount - j : 16);
+
+                    __m512 bias = _mm512_maskz_loadu_ps(mask, biases + j);
+                    __m512 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+
+                    for (size_t i = 0; i < sourceCount; ++i)
+                    {
+                        __m512 w = loadReduced<F>(weights.data, i * targetCount + j, scale, offset);
+                        acc0 = _mm512_fmadd_ps(_mm512_set1_ps(s0[i]), w, acc0);
+                        acc1 = _mm512_fmadd_ps(_mm512_set1_ps(s1[i]), w, acc1);
+                        acc2 = _mm512_fmadd_ps(_mm512_set1_ps(s2[i]), w, acc2);
+                        acc3 = _mm512_fmadd_ps(_mm512_set1_ps(s3[i]), w, acc3);
+                    }
+
+                    float *t = t0 + j;
+                    storeActivated<A>(acc0, t, nullptr, mask);
+                    storeActivated<A>(acc1, t + targetCount, nullptr, mask);
+                    storeActivated<A>(acc2, t + 2 * targetCount, nullptr, mask);
+                    storeActivated<A>(acc3, t + 3 * targetCount, nullptr, mask);
+                }
+            }
+
+            for (; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+
+                for (size_t j = 0; j < targetCount; j += 16)
+                {
+                    const __mmask16 mask = tailMask((targetCount - j < 16) ? targetCount - j : 16);
+
+                    __m512 acc = _mm512_maskz_loadu_ps(mask, biases + j);
+                    for (size_t i = 0; i < sourceCount; ++i)
+                    {
+                        __m512 w = loadReduced<F>(weights.data, i * targetCount + j, scale, offset);
+                        acc = _mm512_fmadd_ps(_mm512_set1_ps(source[i]), w, acc);
+                    }
+                    storeActivated<A>(acc, target + j, nullptr, mask);
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        template <WeightFormat F>
+        AVX512_TARGET void denseReducedAs(const float *sources, size_t rowCount, size_t sourceCount,
+                                          const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                          Activation activation, float *targets)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseReducedActivate<decltype(a)::value, F>(sources, rowCount, sourceCount, weights,
+                                                                         biases, targetCount, targets); });
+        }
+
+        AVX512_TARGET void denseReduced(const float *sources, size_t rowCount, size_t sourceCount,
+                                        const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                        Activation activation, float *targets)
+        {
+            switch (weights.format)
+            {
+            case WeightFormat::Int8:
+                return denseReducedAs<WeightFormat::Int8>(sources, rowCount, sourceCount, weights, biases,
+                                                          targetCount, activation, targets);
+            case WeightFormat::Float16:
+                return denseReducedAs<WeightFormat::Float16>(sources, rowCount, sourceCount, weights, biases,
+                                                             targetCount, activation, targets);
+            default:
+                return denseReducedAs<WeightFormat::BFloat16>(sources, rowCount, sourceCount, weights, biases,
+                                                              targetCount, activation, targets);
+            }
+        }
+
+        // One vector holds all the lanes of a node.
+        static_assert(sparseLanes == 16, "sparse kernels assume one vector per node");
+
+        // Softmax down each lane of [targetCount][sparseLanes] values.
+        AVX512_TARGET void softmaxLanes(float *values, size_t targetCount)
+        {
+            __m512 peak = _mm512_loadu_ps(values);
+            for (size_t j = 1; j < targetCount; ++j)
+                peak = _mm512_max_ps(peak, _mm512_loadu_ps(values + j * sparseLanes));
+
+            __m512 sum = _mm512_setzero_ps();
+            for (size_t j = 0; j < targetCount; ++j)
+            {
+                __m512 e = exp512(_mm512_sub_ps(_mm512_loadu_ps(values + j * sparseLanes), peak));
+                _mm512_storeu_ps(values + j * sparseLanes, e);
+                sum = _mm512_add_ps(sum, e);
+            }
+
+            const __m512 scale = _mm512_div_ps(_mm512_set1_ps(1.0f), sum);
+            for (size_t j = 0; j < targetCount; ++j)
+                _mm512_storeu_ps(values + j * sparseLanes, _mm512_mul_ps(_mm512_loadu_ps(values + j * sparseLanes), scale));
+        }
+
+        // Same scatter as the AVX2 path with the source in one register.
+        template <Activation A>
+        AVX512_TARGET void sparseActivate(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                                          const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            for (size_t j = 0; j < targetCount; ++j)
+                _mm512_storeu_ps(targets + j * sparseLanes, _mm512_set1_ps(biases[j]));
+
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const __m512 source = _mm512_loadu_ps(sources + i * sparseLanes);
+                if (!_mm512_cmp_ps_mask(source, _mm512_setzero_ps(), _CMP_NEQ_UQ))
+                    continue;
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    float *target = targets + weights.columns[e] * sparseLanes;
+                    _mm512_storeu_ps(target, _mm512_fmadd_ps(source, _mm512_set1_ps(weights.values[e]),
+                                                             _mm512_loadu_ps(target)));
+                }
+            }
+
+            for (size_t j = 0; j < targetCount; ++j)
+            {
+                float *target = targets + j * sparseLanes;
+                storeActivated<A>(_mm512_loadu_ps(target), target, derivatives ? derivatives + j * sparseLanes : nullptr,
+                                  tailMask(sparseLanes));
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxLanes(targets, targetCount);
+        }
+
+        AVX512_TARGET void sparseForward(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                                         const float *biases, size_t targetCount, Activation activation,
+                                         float *targets, float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { sparseActivate<decltype(a)::value>(sources, sourceCount, weights, biases, targetCount,
+                                                                targets, derivatives); });
+        }
+
+        AVX512_TARGET void sparseBackward(const float *sources, const float *targetDeltas, size_t sourceCount,
+                                          const SparseWeights &weights, float *gradients, float *sourceDeltas)
+        {
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const __m512 source = _mm512_loadu_ps(sources + i * sparseLanes);
+                __m512 delta = _mm512_setzero_ps();
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    const __m512 targetDelta = _mm512_loadu_ps(targetDeltas + weights.columns[e] * sparseLanes);
+                    delta = _mm512_fmadd_ps(_mm512_set1_ps(weights.values[e]), targetDelta, delta);
+                    gradients[e] += _mm512_reduce_add_ps(_mm512_mul_ps(source, targetDelta));
+                }
+
+                if (sourceDeltas)
+                    _mm512_storeu_ps(sourceDeltas + i * sparseLanes, delta);
+            }
+        }
+
+        const KernelTable avx512Table = {
+            Backend::Avx512, "avx512",
+            axpy, dotAccumulate, denseBatch, multiply,
+            denseReduced,
+            sparseForward, sparseBackward};
+    }
+
+    const KernelTable *avx512Kernels()
+    {
+        return &avx512Table;
+    }
+}
+
+#else
+
+namespace kernels
+{
+    const KernelTable *avx512Kernels()
+    {
+        return nullptr;
+    }
+}
+
+#endif
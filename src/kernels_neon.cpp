@@ -0,0 +1,525 @@
+#include "kernels.hpp"
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+#include <cstring>
+
+namespace kernels
+{
+    namespace
+    {
+        // Same Cephes-style expf as the x86 paths.
+        inline float32x4_t exp128(float32x4_t x)
+        {
+            x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-87.0f)), vdupq_n_f32(88.0f));
+
+            int32x4_t n = vcvtnq_s32_f32(vmulq_f32(x, vdupq_n_f32(1.44269504088896341f)));
+            float32x4_t fn = vcvtq_f32_s32(n);
+            x = vfmsq_f32(x, fn, vdupq_n_f32(0.693359375f));
+            x = vfmsq_f32(x, fn, vdupq_n_f32(-2.12194440e-4f));
+
+            float32x4_t y = vdupq_n_f32(1.9875691500e-4f);
+            y = vfmaq_f32(vdupq_n_f32(1.3981999507e-3f), y, x);
+            y = vfmaq_f32(vdupq_n_f32(8.3334519073e-3f), y, x);
+            y = vfmaq_f32(vdupq_n_f32(4.1665795894e-2f), y, x);
+            y = vfmaq_f32(vdupq_n_f32(1.6666665459e-1f), y, x);
+            y = vfmaq_f32(vdupq_n_f32(5.0000001201e-1f), y, x);
+            y = vfmaq_f32(vaddq_f32(x, vdupq_n_f32(1.0f)), y, vmulq_f32(x, x));
+
+            int32x4_t exponent = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23);
+            return vmulq_f32(y, vreinterpretq_f32_s32(exponent));
+        }
+
+        inline float32x4_t sigmoid128(float32x4_t x)
+        {
+            const float32x4_t one = vdupq_n_f32(1.0f);
+            return vdivq_f32(one, vaddq_f32(one, exp128(vnegq_f32(x))));
+        }
+
+        inline float32x4_t relu128(float32x4_t x)
+        {
+            uint32x4_t positive = vcgtq_f32(x, vdupq_n_f32(0.0f));
+            return vbslq_f32(positive, x, vmulq_f32(x, vdupq_n_f32(0.01f)));
+        }
+
+        inline float32x4_t reluDerivative128(float32x4_t x)
+        {
+            uint32x4_t positive = vcgtq_f32(x, vdupq_n_f32(0.0f));
+            return vbslq_f32(positive, vdupq_n_f32(1.0f), vdupq_n_f32(0.01f));
+        }
+
+        inline float32x4_t sigmoidDerivative128(float32x4_t s)
+        {
+            return vmulq_f32(s, vsubq_f32(vdupq_n_f32(1.0f), s));
+        }
+
+        // Same Cephes-style tanhf as the x86 paths.
+        inline float32x4_t tanh128(float32x4_t x)
+        {
+            const float32x4_t one = vdupq_n_f32(1.0f);
+            const float32x4_t a = vabsq_f32(x);
+
+            const float32x4_t z = vmulq_f32(x, x);
+            float32x4_t p = vdupq_n_f32(-5.70498872745e-3f);
+            p = vfmaq_f32(vdupq_n_f32(2.06390887954e-2f), p, z);
+            p = vfmaq_f32(vdupq_n_f32(-5.37397155531e-2f), p, z);
+            p = vfmaq_f32(vdupq_n_f32(1.33314422036e-1f), p, z);
+            p = vfmaq_f32(vdupq_n_f32(-3.33332819422e-1f), p, z);
+            const float32x4_t small = vfmaq_f32(x, vmulq_f32(p, z), x);
+
+            float32x4_t e = exp128(vaddq_f32(a, a));
+            float32x4_t large = vsubq_f32(one, vdivq_f32(vdupq_n_f32(2.0f), vaddq_f32(e, one)));
+            // Copy x's sign onto the magnitude.
+            large = vbslq_f32(vdupq_n_u32(0x80000000u), x, large);
+
+            return vbslq_f32(vcltq_f32(a, vdupq_n_f32(0.625f)), small, large);
+        }
+
+        template <Activation A>
+        inline float32x4_t activate128(float32x4_t x, float32x4_t &derivative)
+        {
+            if constexpr (A == Activation::LeakyRelu)
+            {
+                derivative = reluDerivative128(x);
+                return relu128(x);
+            }
+            else if constexpr (A == Activation::Relu)
+            {
+                uint32x4_t positive = vcgtq_f32(x, vdupq_n_f32(0.0f));
+                derivative = vreinterpretq_f32_u32(vandq_u32(positive, vreinterpretq_u32_f32(vdupq_n_f32(1.0f))));
+                return vreinterpretq_f32_u32(vandq_u32(positive, vreinterpretq_u32_f32(x)));
+            }
+            else if constexpr (A == Activation::Tanh)
+            {
+                float32x4_t t = tanh128(x);
+                derivative = vfmsq_f32(vdupq_n_f32(1.0f), t, t);
+                return t;
+            }
+            else if constexpr (A == Activation::Gelu)
+            {
+                const float32x4_t x2 = vmulq_f32(x, x);
+                float32x4_t s = sigmoid128(vmulq_f32(x, vfmaq_n_f32(vdupq_n_f32(geluLinear), x2, geluCubic)));
+                float32x4_t slope = vfmaq_n_f32(vdupq_n_f32(geluLinear), x2, 3.0f * geluCubic);
+                derivative = vfmaq_f32(s, vmulq_f32(x, sigmoidDerivative128(s)), slope);
+                return vmulq_f32(x, s);
+            }
+            else if constexpr (A == Activation::Sigmoid)
+            {
+                float32x4_t s = sigmoid128(x);
+                derivative = sigmoidDerivative128(s);
+                return s;
+            }
+            else
+            {
+                derivative = vdupq_n_f32(1.0f);
+                return x;
+            }
+        }
+
+        // In place, shifted by the row maximum so exp128 never overflows.
+        // The tail runs padded through one more vector.
+        void softmaxRows(float *values, size_t rowCount, size_t n)
+        {
+            const size_t vectorCount = n & ~size_t(3);
+
+            for (size_t r = 0; r < rowCount; ++r, values += n)
+            {
+                float peak = values[0];
+                if (vectorCount)
+                {
+                    float32x4_t vpeak = vld1q_f32(values);
+                    for (size_t j = 4; j < vectorCount; j += 4)
+                        vpeak = vmaxq_f32(vpeak, vld1q_f32(values + j));
+                    peak = vmaxvq_f32(vpeak);
+                }
+                for (size_t j = vectorCount; j < n; ++j)
+                    peak = values[j] > peak ? values[j] : peak;
+
+                const float32x4_t shift = vdupq_n_f32(peak);
+                float32x4_t vsum = vdupq_n_f32(0.0f);
+                for (size_t j = 0; j < vectorCount; j += 4)
+                {
+                    float32x4_t e = exp128(vsubq_f32(vld1q_f32(values + j), shift));
+                    vst1q_f32(values + j, e);
+                    vsum = vaddq_f32(vsum, e);
+                }
+                float sum = vaddvq_f32(vsum);
+                if (vectorCount < n)
+                {
+                    float tail[4] = {peak, peak, peak, peak};
+                    memcpy(tail, values + vectorCount, (n - vectorCount) * sizeof(float));
+                    vst1q_f32(tail, exp128(vsubq_f32(vld1q_f32(tail), shift)));
+                    for (size_t j = vectorCount; j < n; ++j)
+                    {
+                        values[j] = tail[j - vectorCount];
+                        sum += values[j];
+                    }
+                }
+
+                const float scale = 1.0f / sum;
+                for (size_t j = 0; j < vectorCount; j += 4)
+                    vst1q_f32(values + j, vmulq_n_f32(vld1q_f32(values + j), scale));
+                for (size_t j = vectorCount; j < n; ++j)
+                    values[j] *= scale;
+            }
+        }
+
+        void axpy(float a, const float *x, float *y, size_t n)
+        {
+            const float32x4_t va = vdupq_n_f32(a);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                vst1q_f32(y + i, vfmaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+            }
+            for (; i < n; ++i)
+                y[i] += a * x[i];
+        }
+
+        float dotAccumulate(const float *weights, const float *deltas, float value, float *gradients, size_t n)
+        {
+            const float32x4_t vvalue = vdupq_n_f32(value);
+            float32x4_t vsum = vdupq_n_f32(0.0f);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t d = vld1q_f32(deltas + i);
+                vsum = vfmaq_f32(vsum, vld1q_f32(weights + i), d);
+                vst1q_f32(gradients + i, vfmaq_f32(vld1q_f32(gradients + i), vvalue, d));
+            }
+            float sum = vaddvq_f32(vsum);
+            for (; i < n; ++i)
+            {
+                sum += weights[i] * deltas[i];
+                gradients[i] += value * deltas[i];
+            }
+            return sum;
+        }
+
+        // Columns go four at a time; the scalar tail is padded through the
+        // same vector activation so every lane matches.
+        template <Activation A>
+        void denseActivate(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                           const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            const size_t vectorCount = targetCount & ~size_t(3);
+
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+                float *derivative = derivatives ? derivatives + r * targetCount : nullptr;
+
+                for (size_t j = 0; j < vectorCount; j += 4)
+                {
+                    float32x4_t acc = vld1q_f32(biases + j);
+                    const float *row = weights + j;
+                    for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                    {
+                        acc = vfmaq_n_f32(acc, vld1q_f32(row), source[i]);
+                    }
+
+                    float32x4_t d;
+                    vst1q_f32(target + j, activate128<A>(acc, d));
+                    if (derivative)
+                        vst1q_f32(derivative + j, d);
+                }
+
+                if (vectorCount < targetCount)
+                {
+                    float tail[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (size_t j = vectorCount; j < targetCount; ++j)
+                    {
+                        float acc = biases[j];
+                        const float *row = weights + j;
+                        for (size_t i = 0; i < sourceCount; ++i, row += targetCount)
+                        {
+                            acc += source[i] * *row;
+                        }
+                        tail[j - vectorCount] = acc;
+                    }
+
+                    float32x4_t d;
+                    float tailDerivatives[4];
+                    vst1q_f32(tail, activate128<A>(vld1q_f32(tail), d));
+                    vst1q_f32(tailDerivatives, d);
+                    for (size_t j = vectorCount; j < targetCount; ++j)
+                    {
+                        target[j] = tail[j - vectorCount];
+                        if (derivative)
+                            derivative[j] = tailDerivatives[j - vectorCount];
+                    }
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        void denseBatch(const float *sources, size_t rowCount, size_t sourceCount, const float *weights,
+                        const float *biases, size_t targetCount, Activation activation, float *targets,
+                        float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseActivate<decltype(a)::value>(sources, rowCount, sourceCount, weights, biases,
+                                                               targetCount, targets, derivatives); });
+        }
+
+        void multiply(const float *factors, float *values, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                vst1q_f32(values + i, vmulq_f32(vld1q_f32(values + i), vld1q_f32(factors + i)));
+            }
+            for (; i < n; ++i)
+                values[i] *= factors[i];
+        }
+
+        // Four weights from entry `index`, widened and decoded to float.
+        template <WeightFormat F>
+        inline float32x4_t loadReduced(const void *weights, size_t index, float scale, float offset)
+        {
+            if constexpr (F == WeightFormat::Int8)
+            {
+                int32_t word;
+                memcpy(&word, static_cast<const int8_t *>(weights) + index, sizeof(word));
+                int16x8_t wide = vmovl_s8(vreinterpret_s8_s32(vdup_n_s32(word)));
+                float32x4_t values = vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)));
+                return vfmaq_n_f32(vdupq_n_f32(offset), values, scale);
+            }
+            else
+            {
+                uint16x4_t halves = vld1_u16(static_cast<const uint16_t *>(weights) + index);
+                if constexpr (F == WeightFormat::Float16)
+                    return vcvt_f32_f16(vreinterpret_f16_u16(halves));
+                else
+                    return vreinterpretq_f32_u32(vshll_n_u16(halves, 16));
+            }
+        }
+
+        // The buffer padding lets the column tail run as one more full
+        // vector, stored through a scratch block.
+        template <Activation A, WeightFormat F>
+        void denseReducedActivate(const float *sources, size_t rowCount, size_t sourceCount,
+                                  const ReducedWeights &weights, const float *biases, size_t targetCount,
+                                  float *targets)
+        {
+            const float offset = -weights.scale * weights.zeroPoint;
+            const size_t vectorCount = targetCount & ~size_t(3);
+
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                const float *source = sources + r * sourceCount;
+                float *target = targets + r * targetCount;
+
+                for (size_t j = 0; j < targetCount; j += 4)
+                {
+                    float bias[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    const size_t width = j < vectorCount ? 4 : targetCount - j;
+                    memcpy(bias, biases + j, width * sizeof(float));
+
+                    float32x4_t acc = vld1q_f32(bias);
+                    for (size_t i = 0; i < sourceCount; ++i)
+                    {
+                        float32x4_t w = loadReduced<F>(weights.data, i * targetCount + j, weights.scale, offset);
+                        acc = vfmaq_n_f32(acc, w, source[i]);
+                    }
+
+                    float32x4_t d;
+                    if (width == 4)
+                    {
+                        vst1q_f32(target + j, activate128<A>(acc, d));
+                    }
+                    else
+                    {
+                        vst1q_f32(bias, activate128<A>(acc, d));
+                        memcpy(target + j, bias, width * sizeof(float));
+                    }
+                }
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxRows(targets, rowCount, targetCount);
+        }
+
+        template <WeightFormat F>
+        void denseReducedAs(const float *sources, size_t rowCount, size_t sourceCount, const ReducedWeights &weights,
+                            const float *biases, size_t targetCount, Activation activation, float *targets)
+        {
+            withActivation(activation, [&](auto a)
+                           { denseReducedActivate<decltype(a)::value, F>(sources, rowCount, sourceCount, weights,
+                                                                         biases, targetCount, targets); });
+        }
+
+        void denseReduced(const float *sources, size_t rowCount, size_t sourceCount, const ReducedWeights &weights,
+                          const float *biases, size_t targetCount, Activation activation, float *targets)
+        {
+            switch (weights.format)
+            {
+            case WeightFormat::Int8:
+                return denseReducedAs<WeightFormat::Int8>(sources, rowCount, sourceCount, weights, biases,
+                                                          targetCount, activation, targets);
+            case WeightFormat::Float16:
+                return denseReducedAs<WeightFormat::Float16>(sources, rowCount, sourceCount, weights, biases,
+                                                             targetCount, activation, targets);
+            default:
+                return denseReducedAs<WeightFormat::BFloat16>(sources, rowCount, sourceCount, weights, biases,
+                                                              targetCount, activation, targets);
+            }
+        }
+
+        // Lanes are four vector quarters throughout.
+        static_assert(sparseLanes == 16, "sparse kernels assume four vectors per node");
+
+        // Softmax down each lane of [targetCount][sparseLanes] values.
+        void softmaxLanes(float *values, size_t targetCount)
+        {
+            for (size_t quarter = 0; quarter < sparseLanes; quarter += 4)
+            {
+                float32x4_t peak = vld1q_f32(values + quarter);
+                for (size_t j = 1; j < targetCount; ++j)
+                    peak = vmaxq_f32(peak, vld1q_f32(values + j * sparseLanes + quarter));
+
+                float32x4_t sum = vdupq_n_f32(0.0f);
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float *value = values + j * sparseLanes + quarter;
+                    float32x4_t e = exp128(vsubq_f32(vld1q_f32(value), peak));
+                    vst1q_f32(value, e);
+                    sum = vaddq_f32(sum, e);
+                }
+
+                const float32x4_t scale = vdivq_f32(vdupq_n_f32(1.0f), sum);
+                for (size_t j = 0; j < targetCount; ++j)
+                {
+                    float *value = values + j * sparseLanes + quarter;
+                    vst1q_f32(value, vmulq_f32(vld1q_f32(value), scale));
+                }
+            }
+        }
+
+        // Same scatter as the x86 paths with the source in four registers.
+        template <Activation A>
+        void sparseActivate(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                            const float *biases, size_t targetCount, float *targets, float *derivatives)
+        {
+            for (size_t j = 0; j < targetCount; ++j)
+            {
+                const float32x4_t bias = vdupq_n_f32(biases[j]);
+                for (size_t q = 0; q < sparseLanes; q += 4)
+                    vst1q_f32(targets + j * sparseLanes + q, bias);
+            }
+
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const float *source = sources + i * sparseLanes;
+                const float32x4_t s0 = vld1q_f32(source);
+                const float32x4_t s1 = vld1q_f32(source + 4);
+                const float32x4_t s2 = vld1q_f32(source + 8);
+                const float32x4_t s3 = vld1q_f32(source + 12);
+                const float32x4_t zero = vdupq_n_f32(0.0f);
+                // Lanes equal to zero are all-ones in the compare; skip the
+                // source when every lane is.
+                const uint32x4_t isZero = vandq_u32(vandq_u32(vceqq_f32(s0, zero), vceqq_f32(s1, zero)),
+                                                    vandq_u32(vceqq_f32(s2, zero), vceqq_f32(s3, zero)));
+                if (vminvq_u32(isZero))
+                    continue;
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    float *target = targets + weights.columns[e] * sparseLanes;
+                    const float w = weights.values[e];
+                    vst1q_f32(target, vfmaq_n_f32(vld1q_f32(target), s0, w));
+                    vst1q_f32(target + 4, vfmaq_n_f32(vld1q_f32(target + 4), s1, w));
+                    vst1q_f32(target + 8, vfmaq_n_f32(vld1q_f32(target + 8), s2, w));
+                    vst1q_f32(target + 12, vfmaq_n_f32(vld1q_f32(target + 12), s3, w));
+                }
+            }
+
+            for (size_t i = 0; i < targetCount * sparseLanes; i += 4)
+            {
+                float32x4_t d;
+                vst1q_f32(targets + i, activate128<A>(vld1q_f32(targets + i), d));
+                if (derivatives)
+                    vst1q_f32(derivatives + i, d);
+            }
+
+            if constexpr (A == Activation::Softmax)
+                softmaxLanes(targets, targetCount);
+        }
+
+        void sparseForward(const float *sources, size_t sourceCount, const SparseWeights &weights,
+                           const float *biases, size_t targetCount, Activation activation, float *targets,
+                           float *derivatives)
+        {
+            withActivation(activation, [&](auto a)
+                           { sparseActivate<decltype(a)::value>(sources, sourceCount, weights, biases, targetCount,
+                                                                targets, derivatives); });
+        }
+
+        void sparseBackward(const float *sources, const float *targetDeltas, size_t sourceCount,
+                            const SparseWeights &weights, float *gradients, float *sourceDeltas)
+        {
+            for (size_t i = 0; i < sourceCount; ++i)
+            {
+                const float *source = sources + i * sparseLanes;
+                const float32x4_t s0 = vld1q_f32(source);
+                const float32x4_t s1 = vld1q_f32(source + 4);
+                const float32x4_t s2 = vld1q_f32(source + 8);
+                const float32x4_t s3 = vld1q_f32(source + 12);
+                float32x4_t d0 = vdupq_n_f32(0.0f), d1 = d0, d2 = d0, d3 = d0;
+
+                for (uint32_t e = weights.rowOffsets[i]; e < weights.rowOffsets[i + 1]; ++e)
+                {
+                    const float *targetDelta = targetDeltas + weights.columns[e] * sparseLanes;
+                    const float32x4_t t0 = vld1q_f32(targetDelta);
+                    const float32x4_t t1 = vld1q_f32(targetDelta + 4);
+                    const float32x4_t t2 = vld1q_f32(targetDelta + 8);
+                    const float32x4_t t3 = vld1q_f32(targetDelta + 12);
+                    const float w = weights.values[e];
+                    d0 = vfmaq_n_f32(d0, t0, w);
+                    d1 = vfmaq_n_f32(d1, t1, w);
+                    d2 = vfmaq_n_f32(d2, t2, w);
+                    d3 = vfmaq_n_f32(d3, t3, w);
+                    float32x4_t product = vfmaq_f32(vmulq_f32(s0, t0), s1, t1);
+                    product = vfmaq_f32(vfmaq_f32(product, s2, t2), s3, t3);
+                    gradients[e] += vaddvq_f32(product);
+                }
+
+                if (sourceDeltas)
+                {
+                    float *delta = sourceDeltas + i * sparseLanes;
+                    vst1q_f32(delta, d0);
+                    vst1q_f32(delta + 4, d1);
+                    vst1q_f32(delta + 8, d2);
+                    vst1q_f32(delta + 12, d3);
+                }
+            }
+        }
+
+        const KernelTable neonTable = {
+            Backend::Neon, "neon",
+            axpy, dotAccumulate, denseBatch, multiply,
+            denseReduced,
+            sparseForward, sparseBackward};
+    }
+
+    const KernelTable *neonKernels()
+    {
+        return &neonTable;
+    }
+}
+
+#else
+
+namespace kernels
+{
+    const KernelTable *neonKernels()
+    {
+        return nullptr;
+    }
+}
+
+#endif
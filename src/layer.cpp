@@ -1,5 +1,5 @@
 #include "layer.hpp"
-#include <random>
+#include "kernels.hpp"
 #include <stdexcept>
 #include <algorithm>
 
@@ -8,120 +8,105 @@ using namespace nodes;
 
 namespace layers
 {
-    float Layer::generateRandomNormalizedValues(const float range[2])
+    namespace
     {
-        static random_device rd;
-        static mt19937 gen(rd());
-        uniform_real_distribution<float> dist(range[0], range[1]);
-        return dist(gen);
+        // Writes activation(nextBiases + values * weights) into nextValues in
+        // a single pass, so nextValues needs no prior reset.
+        void project(const float *values, size_t valueCount, const ParameterBuffer &weights,
+                     const Layer &nextLayer, float *nextValues, float *nextDerivatives, bool logits)
+        {
+            const kernels::Activation activation = logits ? kernels::Activation::Identity : nextLayer.activation;
+            kernels::active().denseBatch(values, 1, valueCount, weights.data(), nextLayer.biases.data(),
+                                         nextLayer.getNodeCount(), activation, nextValues, nextDerivatives);
+        }
+    }
+
+    void Layer::allocate(ParameterBuffer &buffer, size_t n)
+    {
+        if (this->arena)
+            buffer.allocate(this->arena, n, 0.0f);
+        else
+            buffer.assign(n, 0.0f);
     }
 
     void Layer::initializeNodes(int nodeCount)
     {
-        this->nodes.clear();
-        this->nodes.reserve(nodeCount);
+        this->nodeCount = nodeCount;
+        if (!this->allocateParameters)
+            return;
+        this->allocate(this->biasGradients, nodeCount);
+        this->allocate(this->biases, nodeCount);
+    }
 
-        float biasRange[2] = {-0.5f, 0.5f};
-        for (int i = 0; i < nodeCount; ++i)
-        {
-            float bias = this->generateRandomNormalizedValues(biasRange);
-            shared_ptr<Node> node = make_shared<Node>(0.0f, bias);
-            this->nodes.push_back(node);
-        }
+    void Layer::resetGradients()
+    {
+        fill(this->biasGradients.begin(), this->biasGradients.end(), 0.0f);
     }
 
-    void Layer::resetValues()
+    void Layer::allocateGradients(const shared_ptr<memory::Arena> &arena)
     {
-        for (const auto &node : this->nodes)
-        {
-            node->reset();
-        }
+        if (this->biasGradients.empty())
+            this->biasGradients.allocate(arena, this->nodeCount, 0.0f);
     }
 
-    InputLayer::InputLayer(int nodeCount)
+    InputLayer::InputLayer(int nodeCount, shared_ptr<memory::Arena> arena, bool allocateParameters)
     {
+        this->arena = move(arena);
+        this->allocateParameters = allocateParameters;
         if (nodeCount <= 0)
             throw invalid_argument("Node count must be positive");
         initializeNodes(nodeCount);
     }
 
-    void InputLayer::initializeNodes(int nodeCount)
-    {
-        this->nodes.clear();
-        this->nodes.reserve(nodeCount);
-
-        for (int i = 0; i < nodeCount; i++)
-        {
-            shared_ptr<Node> node = make_shared<Node>(0.0f);
-            this->nodes.push_back(node);
-        }
-    }
-
     void InputLayer::initializeEdges(shared_ptr<Layer> nextLayer)
     {
-        if (!nextLayer || nextLayer->nodes.empty())
+        if (!nextLayer || nextLayer->getNodeCount() == 0)
             throw invalid_argument("Cannot attach to null or empty layer");
 
-        this->edges.clear();
-        this->edges.reserve(nodes.size() * nextLayer->nodes.size());
-
-        float weightRange[2] = {-0.5f, 0.5f};
-        for (const auto &sourceNode : this->nodes)
-        {
-            for (const auto &targetNode : nextLayer->nodes)
-            {
-                float weight = generateRandomNormalizedValues(weightRange);
-                this->edges.push_back(make_shared<Edge>(sourceNode, targetNode, weight));
-            }
-        }
+        this->nextLayer = nextLayer;
+        if (!this->allocateParameters)
+            return;
+        this->allocate(this->weights, getNodeCount() * nextLayer->getNodeCount());
+        this->allocate(this->weightGradients, this->weights.size());
     }
 
-    void InputLayer::setInputValues(const vector<float> &values)
+    void InputLayer::attachLayer(shared_ptr<Layer> nextLayer)
     {
-        if (values.size() != this->nodes.size())
-            throw invalid_argument("Input size doesn't match layer size");
-
-        for (size_t i = 0; i < values.size(); ++i)
-            this->nodes[i]->value = values[i];
+        this->initializeEdges(nextLayer);
     }
 
-    void InputLayer::attachLayer(shared_ptr<Layer> nextLayer)
+    void InputLayer::allocateGradients(const shared_ptr<memory::Arena> &arena)
     {
-        this->initializeEdges(nextLayer);
+        Layer::allocateGradients(arena);
+        if (this->weightGradients.empty())
+            this->weightGradients.allocate(arena, getNodeCount() * this->nextLayer->getNodeCount(), 0.0f);
     }
 
-    void InputLayer::forward()
+    void InputLayer::forward(const float *values, float *nextValues, float *nextDerivatives, bool logits) const
     {
-        for (const auto &edge : this->edges)
-        {
-            edge->targetNode->value += edge->sourceNode->value * edge->weight;
-        }
+        project(values, getNodeCount(), this->weights, *this->nextLayer, nextValues, nextDerivatives, logits);
     }
 
-    HiddenLayer::HiddenLayer(int nodeCount)
+    HiddenLayer::HiddenLayer(int nodeCount, shared_ptr<memory::Arena> arena, bool allocateParameters)
     {
+        this->arena = move(arena);
+        this->allocateParameters = allocateParameters;
         if (nodeCount <= 0)
             throw invalid_argument("Node count must be positive");
         initializeNodes(nodeCount);
+        this->activation = kernels::Activation::LeakyRelu;
     }
 
     void HiddenLayer::initializeEdges(shared_ptr<Layer> nextLayer)
     {
-        if (!nextLayer || nextLayer->nodes.empty())
+        if (!nextLayer || nextLayer->getNodeCount() == 0)
             throw invalid_argument("Cannot attach to null or empty layer");
 
-        this->edges.clear();
-        this->edges.reserve(nodes.size() * nextLayer->nodes.size());
-
-        float weightRange[2] = {-0.5f, 0.5f};
-        for (const auto &sourceNode : this->nodes)
-        {
-            for (const auto &targetNode : nextLayer->nodes)
-            {
-                float weight = generateRandomNormalizedValues(weightRange);
-                this->edges.push_back(make_shared<Edge>(sourceNode, targetNode, weight));
-            }
-        }
+        this->nextLayer = nextLayer;
+        if (!this->allocateParameters)
+            return;
+        this->allocate(this->weights, getNodeCount() * nextLayer->getNodeCount());
+        this->allocate(this->weightGradients, this->weights.size());
     }
 
     void HiddenLayer::attachLayer(shared_ptr<Layer> nextLayer)
@@ -129,48 +114,26 @@ namespace layers
         this->initializeEdges(nextLayer);
     }
 
-    void HiddenLayer::processNodes()
+    void HiddenLayer::allocateGradients(const shared_ptr<memory::Arena> &arena)
     {
-        for (const auto &node : this->nodes)
-        {
-            node->addBias();
-            node->relu();
-        }
+        Layer::allocateGradients(arena);
+        if (this->weightGradients.empty())
+            this->weightGradients.allocate(arena, getNodeCount() * this->nextLayer->getNodeCount(), 0.0f);
     }
 
-    void HiddenLayer::forward()
+    void HiddenLayer::forward(const float *values, float *nextValues, float *nextDerivatives, bool logits) const
     {
-        this->processNodes();
-        for (const auto &edge : this->edges)
-        {
-            edge->targetNode->value += edge->sourceNode->value * edge->weight;
-        }
+        project(values, getNodeCount(), this->weights, *this->nextLayer, nextValues, nextDerivatives, logits);
     }
 
-    OutputLayer::OutputLayer(int nodeCount)
+    OutputLayer::OutputLayer(int nodeCount, shared_ptr<memory::Arena> arena, bool allocateParameters)
     {
+        this->arena = move(arena);
+        this->allocateParameters = allocateParameters;
         if (nodeCount <= 0)
             throw invalid_argument("Node count must be positive");
         initializeNodes(nodeCount);
-    }
-
-    void OutputLayer::processNodes()
-    {
-        for (const auto &node : this->nodes)
-        {
-            node->addBias();
-            node->sigmoid();
-        }
-    }
-
-    vector<float> OutputLayer::getOutput()
-    {
-        this->processNodes();
-        vector<float> outputs;
-        outputs.reserve(this->nodes.size());
-        for (const auto &node : this->nodes)
-            outputs.push_back(node->value);
-        return outputs;
+        this->activation = kernels::Activation::Sigmoid;
     }
 
 }
@@ -11,69 +11,63 @@
  * - 2 camadas ocultas com ativação ReLU
  * - 1 neurônio de saída com ativação sigmoid (probabilidade CVD)
  * - Função de perda: entropia cruzada binária
- * - Otimizador: gradiente descendente com taxa de aprendizado fixa
+ * - Otimizador: Adam em mini-lotes, com aquecimento e decaimento cosseno da taxa
  */
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <chrono>
+#include <algorithm>
 #include "neural_network.hpp"
 #include "normalizer.hpp"
+#include "dataset.hpp"
+#include "instrumentation.hpp"
+#include "static_network.hpp"
+#include "trainer.hpp"
+#include "sweep.hpp"
+#include "inference_server.hpp"
+#include "quantized_network.hpp"
+#include "sparse_network.hpp"
 
 using namespace std;
 using namespace neural_network;
+using namespace datasets;
+
+/// Topologia de produção com tamanhos fixos em tempo de compilação (3→4→4→1)
+using RedeProducao = StaticNetwork<3, 4, 4, 1>;
 
 /**
- * @brief Lê dados de um arquivo CSV e retorna uma matriz de valores float
+ * @brief Lê dados de um arquivo CSV para um Dataset contíguo
  *
  * Formato esperado do CSV:
  * - Primeira linha: cabeçalho (ignorado)
  * - Colunas: age_norm,weight_norm,height_norm,cvd_prob
  * - Valores normalizados entre 0 e 1
  *
+ * O arquivo é mapeado em memória e interpretado por io::readCsv, em paralelo
+ * para arquivos grandes; linhas com número de colunas diferente do cabeçalho
+ * são descartadas. A última coluna é o alvo, as demais são entradas.
+ *
  * @param filename Caminho para o arquivo CSV
- * @return vector<vector<float>> Matriz com os dados lidos, cada linha representa uma amostra
+ * @return Dataset Amostras lidas (vazio se o arquivo não puder ser lido)
  */
-vector<vector<float>> lerCSV(const string &filename)
+Dataset lerCSV(const string &filename)
 {
-    vector<vector<float>> dados;
-    ifstream arquivo(filename);
+    io::CsvOptions opcoes;
+    opcoes.threadCount = 0; // Todas as threads disponíveis
 
-    if (!arquivo.is_open())
+    Dataset dados;
+    try
     {
-        printf("Erro: Não foi possível abrir o arquivo %s\n", filename.c_str());
-        return dados;
+        dados = Dataset::fromCsv(filename, opcoes);
     }
-
-    string linha;
-
-    // Pula a linha do cabeçalho
-    getline(arquivo, linha);
-
-    // Lê as linhas de dados
-    while (getline(arquivo, linha))
+    catch (const exception &)
     {
-        vector<float> linha_dados;
-        stringstream ss(linha);
-        string celula;
-
-        // Separa cada valor por vírgula
-        while (getline(ss, celula, ','))
-        {
-            linha_dados.push_back(stof(celula));
-        }
-
-        // Só adiciona linhas com 4 colunas (3 entradas + 1 saída)
-        if (linha_dados.size() == 4)
-        {
-            dados.push_back(linha_dados);
-        }
+        printf("Erro: Não foi possível abrir o arquivo %s\n", filename.c_str());
+        return dados;
     }
 
-    arquivo.close();
     printf("Carregadas %zu amostras de %s\n", dados.size(), filename.c_str());
 
     return dados;
@@ -91,7 +85,7 @@ vector<vector<float>> lerCSV(const string &filename)
  * @param dados Conjunto de dados para avaliação
  * @param nome_conjunto Nome do conjunto (ex: "teste", "validação")
  */
-void avaliarRede(NeuralNetwork *rede, const vector<vector<float>> &dados, const string &nome_conjunto)
+void avaliarRede(NeuralNetwork *rede, const Dataset &dados, const string &nome_conjunto)
 {
     if (dados.empty())
     {
@@ -99,43 +93,100 @@ void avaliarRede(NeuralNetwork *rede, const vector<vector<float>> &dados, const
         return;
     }
 
-    float perda_total = 0.0f;
-    float erro_absoluto_total = 0.0f;
-    int predicoes_proximas = 0;
     const float margem_erro = 0.1f; // 10% de margem de erro aceitável
 
     printf("\nAvaliando conjunto %s (%zu amostras)...\n", nome_conjunto.c_str(), dados.size());
 
-    for (const auto &amostra : dados)
-    {
-        // Separa entradas (3 primeiros valores) e alvo (último valor)
-        vector<float> entradas(amostra.begin(), amostra.begin() + 3);
-        vector<float> alvo = {amostra.back()};
+    // Inferência em lote sobre o Dataset com perda, erro e margem calculados
+    // numa única passada sobre as saídas
+    Evaluation avaliacao = rede->evaluate(dados, margem_erro);
+    float precisao = (float)avaliacao.withinMargin / dados.size() * 100.0f;
 
-        // Inferência
-        vector<float> saida = rede->forward(entradas);
+    printf("Resultados %s:\n", nome_conjunto.c_str());
+    printf("  Perda média: %.4f\n", avaliacao.loss);
+    printf("  Erro absoluto médio: %.4f\n", avaliacao.meanAbsoluteError);
+    printf("  Predições dentro de %.0f%%: %.1f%% (%zu/%zu)\n",
+           margem_erro * 100, precisao, avaliacao.withinMargin, dados.size());
+}
 
-        // Calcula métricas
-        float perda = rede->calculateLoss(alvo);
-        float erro_abs = abs(saida[0] - alvo[0]);
+/**
+ * @brief Compara versões de precisão reduzida da rede com a rede em float
+ *
+ * Para cada formato (int8 com escala/ponto zero por camada, fp16 e bf16)
+ * mostra o tamanho dos parâmetros, o desvio das saídas em relação à rede
+ * original e a perda no conjunto de dados.
+ *
+ * @param rede Rede neural treinada (referência em float)
+ * @param dados Conjunto de dados para a comparação
+ */
+void avaliarQuantizacao(const NeuralNetwork &rede, const Dataset &dados)
+{
+    printf("\n--- Inferência em Precisão Reduzida (%zu amostras) ---\n", dados.size());
 
-        perda_total += perda;
-        erro_absoluto_total += erro_abs;
+    for (Precision precisao : {Precision::Int8, Precision::Float16, Precision::BFloat16})
+    {
+        QuantizedNetwork rede_quantizada(rede, precisao);
+        QuantizationReport relatorio = compareAccuracy(rede, rede_quantizada, dados);
 
-        if (erro_abs <= margem_erro)
-            predicoes_proximas++;
+        printf("  %-4s: %zu de %zu bytes, desvio máx. %.4f (médio %.5f), perda %.4f (float: %.4f)\n",
+               precisionName(precisao), relatorio.quantizedBytes, relatorio.floatBytes,
+               relatorio.maxAbsoluteError, relatorio.meanAbsoluteError, relatorio.quantizedLoss,
+               relatorio.floatLoss);
     }
+}
 
-    // Calcula médias
-    float perda_media = perda_total / dados.size();
-    float erro_medio = erro_absoluto_total / dados.size();
-    float precisao = (float)predicoes_proximas / dados.size() * 100.0f;
+/**
+ * @brief Compara versões podadas (esparsas) da rede com a rede densa
+ *
+ * Para cada nível de poda copia a rede, remove os pesos de menor magnitude
+ * de cada camada com prune() e faz algumas épocas de ajuste fino com as
+ * máscaras aplicadas, para que os pesos restantes compensem os removidos.
+ * Só então a cópia é convertida para CSR; mostra o tamanho dos parâmetros,
+ * o desvio das saídas em relação à rede original e a perda no conjunto de
+ * dados. A rede original não é alterada.
+ *
+ * @param rede Rede neural treinada (referência densa)
+ * @param dados_treinamento Conjunto usado no ajuste fino
+ * @param dados_validacao Conjunto usado para escolher a melhor época do ajuste fino
+ * @param dados Conjunto de dados para a comparação
+ */
+void avaliarPoda(const NeuralNetwork &rede, const Dataset &dados_treinamento, const Dataset &dados_validacao,
+                 const Dataset &dados)
+{
+    printf("\n--- Inferência Esparsa por Poda de Magnitude (%zu amostras) ---\n", dados.size());
 
-    printf("Resultados %s:\n", nome_conjunto.c_str());
-    printf("  Perda média: %.4f\n", perda_media);
-    printf("  Erro absoluto médio: %.4f\n", erro_medio);
-    printf("  Predições dentro de %.0f%%: %.1f%% (%d/%zu)\n",
-           margem_erro * 100, precisao, predicoes_proximas, dados.size());
+    const vector<size_t> tamanhos = rede.getLayerSizes();
+    const int camadas_ocultas = rede.getHiddenLayerCount();
+    const vector<float> parametros = rede.getParameters();
+
+    training::TrainingOptions opcoes;
+    opcoes.maxEpochs = 5; // Ajuste fino curto a partir da rede já treinada
+    opcoes.batchSize = 32;
+    opcoes.learningRate = 0.005f;
+
+    for (float esparsidade : {0.25f, 0.5f, 0.75f})
+    {
+        NeuralNetwork rede_podada(rede.getInputSize(), rede.getOutputSize(), camadas_ocultas,
+                                  camadas_ocultas ? tamanhos[1] : 1);
+        for (int camada = 1; camada <= camadas_ocultas + 1; ++camada)
+            rede_podada.setActivation(camada, rede.getActivation(camada));
+        if (rede.getInputNormalizer())
+            rede_podada.setInputNormalizer(*rede.getInputNormalizer());
+        rede_podada.setParameters(parametros);
+
+        rede_podada.prune(esparsidade);
+        rede_podada.setOptimizer(make_unique<optimization::Adam>());
+        training::Trainer(rede_podada, opcoes).fit(dados_treinamento, dados_validacao);
+
+        SparseNetwork rede_esparsa(rede_podada);
+        SparsityReport relatorio = compareAccuracy(rede, rede_esparsa, dados);
+
+        printf("  %2.0f%% podado: %zu de %zu bytes, desvio máx. %.4f (médio %.5f), perda %.4f (densa: %.4f)%s\n",
+               esparsidade * 100.0f, relatorio.sparseBytes, relatorio.denseBytes, relatorio.maxAbsoluteError,
+               relatorio.meanAbsoluteError, relatorio.sparseLoss, relatorio.denseLoss,
+               // Cada peso em CSR guarda também o índice do destino
+               relatorio.sparseBytes >= relatorio.denseBytes ? " - CSR não compensa nesta densidade" : "");
+    }
 }
 
 /**
@@ -148,41 +199,337 @@ void avaliarRede(NeuralNetwork *rede, const vector<vector<float>> &dados, const
  * @param dados_teste Conjunto de dados para demonstração
  * @param num_exemplos Número de exemplos para mostrar (máximo 10)
  */
-void demonstrarPredicoes(NeuralNetwork *rede, const vector<vector<float>> &dados_teste, int num_exemplos = 5)
+void demonstrarPredicoes(NeuralNetwork *rede, const Dataset &dados_teste, int num_exemplos = 5)
 {
     printf("\n--- Exemplos de Predições ---\n");
     printf("Formato: [idade_norm, peso_norm, altura_norm] -> Predito vs Real\n");
 
     int exemplos_mostrados = min(num_exemplos, (int)dados_teste.size());
 
+    MatrixView entradas = dados_teste.featureMatrix();
+    vector<float> saidas(exemplos_mostrados);
+    rede->forwardBatch(entradas.data, exemplos_mostrados, saidas.data());
+
     for (int i = 0; i < exemplos_mostrados; ++i)
     {
-        const auto &amostra = dados_teste[i];
-        vector<float> entradas(amostra.begin(), amostra.begin() + 3);
-        float alvo = amostra.back();
-
-        vector<float> saida = rede->forward(entradas);
+        const float *entrada = entradas.row(i);
+        float alvo = dados_teste.targetMatrix().row(i)[0];
 
         printf("Exemplo %d: [%.3f, %.3f, %.3f] -> %.4f vs %.4f (erro: %.4f)\n",
-               i + 1, entradas[0], entradas[1], entradas[2],
-               saida[0], alvo, abs(saida[0] - alvo));
+               i + 1, entrada[0], entrada[1], entrada[2],
+               saidas[i], alvo, abs(saidas[i] - alvo));
     }
 }
 
+/**
+ * @brief Treina a rede neural com validação periódica e parada antecipada
+ *
+ * Executa até o número máximo de épocas em mini-lotes, rastreando deltas.
+ * A cada época a perda é medida no conjunto de validação (inferência em
+ * lote); o treinamento para quando ela deixa de melhorar e a rede volta aos
+ * parâmetros da melhor época.
+ *
+ * @param rede Ponteiro para a rede neural a ser treinada
+ * @param dados_treinamento Conjunto de dados de treinamento (embaralhado a cada época)
+ * @param dados_validacao Conjunto usado para a parada antecipada
+ * @param arquivo_estado Estado do treinamento, gravado em segundo plano a cada época e
+ *        retomado se já existir (vazio desativa)
+ */
+void treinarRede(NeuralNetwork *rede, Dataset &dados_treinamento, const Dataset &dados_validacao,
+                 const string &arquivo_estado)
+{
+    printf("\nIniciando treinamento...\n");
+
+    training::TrainingOptions opcoes;
+    opcoes.maxEpochs = 100;
+    opcoes.batchSize = 32;
+    opcoes.learningRate = 0.01f; // Taxa base, aplicada à média dos gradientes de cada lote
+    opcoes.evaluationInterval = 1;
+    opcoes.patience = 10; // Avaliações sem melhora antes de parar
+    opcoes.statePath = arquivo_estado;
+
+    // Adam converge em poucas épocas; 2 épocas de aquecimento e depois decaimento
+    // cosseno até 5% da taxa base evitam saturar a sigmoide no fim do treinamento
+    const int epocas_aquecimento = 2;
+    rede->setOptimizer(make_unique<optimization::Adam>());
+    rede->setLearningRateSchedule(make_unique<optimization::WarmupSchedule>(
+        epocas_aquecimento,
+        make_unique<optimization::CosineSchedule>(opcoes.maxEpochs - epocas_aquecimento,
+                                                  opcoes.learningRate * 0.05f)));
+
+    // Rastreia 1 a cada 10 amostras e grava os deltas em deltas.bin em segundo plano;
+    // o log pode ser lido por visualize_deltas.py durante o treinamento
+    tracking::TrackingOptions rastreamento;
+    rastreamento.interval = 10;
+    rede->configureDeltaTracking(rastreamento);
+    rede->setDeltaSink(make_unique<tracking::BinaryDeltaSink>("deltas.bin"));
+    printf("Rastreando deltas durante todo o treinamento...\n");
+
+#ifdef NN_PROFILE
+    // Build com PROFILE=1: registra também a linha do tempo para trace.json
+    profiling::Profiler::instance().enableTracing(1 << 18);
+#endif
+
+    if (!arquivo_estado.empty() && checkpointing::checkpointExists(arquivo_estado))
+        printf("Retomando o treinamento a partir de %s...\n", arquivo_estado.c_str());
+
+    training::Trainer treinador(*rede, opcoes);
+    treinador.setEpochCallback([&](const training::EpochReport &relatorio)
+                               {
+                                   if (relatorio.evaluated)
+                                       printf("Época %d/%d: Perda de treino = %.4f, validação = %.4f%s\n",
+                                              relatorio.epoch, opcoes.maxEpochs, relatorio.trainingLoss,
+                                              relatorio.validationLoss,
+                                              relatorio.improved ? " (melhor)" : ""); });
+
+    auto inicio_treinamento = chrono::high_resolution_clock::now();
+
+    training::TrainingResult resultado = treinador.fit(dados_treinamento, dados_validacao);
+
+    auto fim_treinamento = chrono::high_resolution_clock::now();
+    auto duracao = chrono::duration_cast<chrono::milliseconds>(fim_treinamento - inicio_treinamento);
+
+    printf("Treinamento concluído em %.2f segundos (%d épocas).\n", duracao.count() / 1000.0,
+           resultado.epochsRun);
+    if (resultado.stoppedEarly)
+        printf("Parada antecipada: sem melhora na validação por %d épocas.\n", opcoes.patience);
+    if (resultado.bestEpoch >= 0)
+        printf("Melhor época: %d (perda de validação %.4f), parâmetros restaurados.\n", resultado.bestEpoch,
+               resultado.bestLoss);
+
+#ifdef NN_PROFILE
+    profiling::Profiler::instance().disableTracing();
+    profiling::Profiler::instance().exportJson("profile.json");
+    profiling::Profiler::instance().exportChromeTrace("trace.json");
+    printf("Perfil por época gravado em profile.json e linha do tempo em trace.json (abra em chrome://tracing)\n");
+#endif
+}
+
+/**
+ * @brief Busca de hiperparâmetros em paralelo
+ *
+ * Treina uma grade de configurações (camadas ocultas, neurônios por camada,
+ * taxa de aprendizado e tamanho do lote) ao mesmo tempo, uma rede por
+ * núcleo, todas lendo os mesmos conjuntos de dados. Mostra as configurações
+ * ordenadas pela melhor perda de validação e o tempo até atingir a perda alvo.
+ *
+ * @param dados_treinamento Conjunto de dados de treinamento (compartilhado, somente leitura)
+ * @param dados_validacao Conjunto usado para a parada antecipada e a comparação
+ * @param epocas Número máximo de épocas por configuração
+ */
+void buscarHiperparametros(const Dataset &dados_treinamento, const Dataset &dados_validacao, int epocas)
+{
+    vector<training::SweepConfiguration> grade =
+        training::makeGrid({1, 2, 3}, {4, 8, 16}, {0.003f, 0.01f, 0.03f}, {16, 32, 64});
+
+    training::SweepOptions opcoes;
+    opcoes.training.maxEpochs = epocas;
+    opcoes.training.patience = 10;
+    opcoes.training.restoreBest = false;
+    opcoes.targetLoss = 0.265f; // Perda de validação considerada "boa o bastante"
+    // Mesmo otimizador do treinamento principal
+    opcoes.configure = [](NeuralNetwork &rede, const training::SweepConfiguration &)
+    { rede.setOptimizer(make_unique<optimization::Adam>()); };
+
+    printf("\n=== BUSCA DE HIPERPARÂMETROS ===\n");
+    printf("Treinando %zu configurações em paralelo (até %d épocas cada)...\n", grade.size(), epocas);
+
+    auto inicio = chrono::high_resolution_clock::now();
+    vector<training::SweepResult> resultados =
+        training::runSweep(grade, dados_treinamento, dados_validacao, opcoes);
+    auto fim = chrono::high_resolution_clock::now();
+
+    // Execuções que nunca avaliaram (ou divergiram) vão para o fim
+    auto perda = [](const training::SweepResult &r)
+    { return r.training.bestEpoch >= 0 ? r.training.bestLoss : INFINITY; };
+    sort(resultados.begin(), resultados.end(), [&](const training::SweepResult &a, const training::SweepResult &b)
+         { return perda(a) < perda(b); });
+
+    double tempo_total = 0.0;
+    for (const auto &r : resultados)
+        tempo_total += r.seconds;
+    double duracao = chrono::duration<double>(fim - inicio).count();
+    printf("Busca concluída em %.2f s (%.2f s somando todas as execuções, %.1fx em paralelo)\n", duracao,
+           tempo_total, tempo_total / duracao);
+
+    printf("\n%-8s %-11s %-8s %-6s %-10s %-9s %-10s %s\n", "Camadas", "Neurônios", "Taxa", "Lote", "Perda",
+           "Épocas", "Tempo (s)", "Até alvo");
+    for (const auto &r : resultados)
+    {
+        char ate_alvo[32] = "-";
+        if (r.epochToTarget >= 0)
+            snprintf(ate_alvo, sizeof(ate_alvo), "%.2f s (época %d)", r.secondsToTarget, r.epochToTarget);
+
+        printf("%-8d %-10d %-8.3f %-6d %-10.4f %-8d %-10.2f %s\n", r.configuration.hiddenLayerCount,
+               r.configuration.hiddenLayerSize, r.configuration.learningRate, r.configuration.batchSize, perda(r),
+               r.training.epochsRun, r.seconds, ate_alvo);
+    }
+}
+
+/**
+ * @brief Modo servidor: atende predições de um modelo salvo até o fim da entrada
+ *
+ * Cada linha recebida traz as entradas brutas separadas por vírgula (idade,
+ * peso, altura) e é respondida com o risco previsto; "stats" responde com os
+ * contadores de latência (p50/p99) e vazão. Requisições simultâneas são
+ * agrupadas em micro-lotes de até 64 amostras, esperando no máximo
+ * `espera_us` microssegundos pela mais antiga. As mensagens de estado vão
+ * para stderr para não misturar com o protocolo.
+ *
+ * @param arquivo_modelo Modelo salvo a ser servido
+ * @param endereco "-" para stdin/stdout ou a porta TCP (escuta em 127.0.0.1)
+ * @param espera_us Espera máxima de uma requisição pelo seu lote
+ * @param normalizador Normalização aplicada se o modelo não tiver uma própria
+ * @return int Código de saída (0 = sucesso, 1 = erro)
+ */
+int servirModelo(const string &arquivo_modelo, const string &endereco, int espera_us,
+                 const Normalizer &normalizador)
+{
+    shared_ptr<NeuralNetwork> rede;
+    try
+    {
+        rede = NeuralNetwork::load(arquivo_modelo);
+    }
+    catch (const exception &erro)
+    {
+        fprintf(stderr, "Erro: Não foi possível carregar o modelo %s: %s\n", arquivo_modelo.c_str(), erro.what());
+        return 1;
+    }
+
+    // Os clientes enviam valores brutos, como nos exemplos personalizados
+    if (!rede->getInputNormalizer())
+        rede->setInputNormalizer(normalizador);
+
+    serving::BatchingOptions opcoes;
+    opcoes.maxWait = chrono::microseconds(espera_us);
+    serving::MicroBatcher agrupador(rede, opcoes);
+
+    if (endereco == "-")
+    {
+        fprintf(stderr, "Servindo %s em stdin/stdout (espera máxima %d us)\n", arquivo_modelo.c_str(), espera_us);
+        serving::serveLines(agrupador, 0, 1);
+        serving::ServingStats estatisticas = agrupador.getStats();
+        fprintf(stderr, "%llu requisições em %llu lotes (média %.1f), p50 %.3f ms, p99 %.3f ms, %.0f req/s\n",
+                (unsigned long long)estatisticas.requests, (unsigned long long)estatisticas.batches,
+                estatisticas.meanBatchSize, estatisticas.p50Milliseconds, estatisticas.p99Milliseconds,
+                estatisticas.throughput);
+        return 0;
+    }
+
+    int porta = atoi(endereco.c_str());
+    if (porta <= 0 || porta > 65535)
+    {
+        fprintf(stderr, "Erro: porta inválida %s\n", endereco.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "Servindo %s em 127.0.0.1:%d (espera máxima %d us)\n", arquivo_modelo.c_str(), porta, espera_us);
+    try
+    {
+        serving::serveTcp(agrupador, static_cast<uint16_t>(porta));
+    }
+    catch (const exception &erro)
+    {
+        fprintf(stderr, "Erro: %s\n", erro.what());
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * @brief Função principal - implementa treinamento e avaliação completos
  *
  * Fluxo de execução:
  * 1. Carrega dados de treinamento, teste e validação
  * 2. Cria e inicializa a rede neural
- * 3. Executa treinamento com monitoramento de progresso
- * 4. Avalia performance nos conjuntos de teste e validação
+ * 3. Treina com validação periódica e parada antecipada
+ * 4. Avalia performance nos conjuntos de teste e validação, e a precisão das
+ *    versões quantizadas (int8, fp16, bf16) e podadas (CSR) frente à rede em float
  * 5. Demonstra predições individuais
  *
+ * Opções de linha de comando:
+ * - --modelo <arquivo>: carrega um modelo salvo (mapeado em memória) e pula o treinamento
+ * - --salvar <arquivo>: caminho onde o modelo treinado é salvo (padrão: modelo.nnm)
+ * - --busca <épocas>: executa a busca de hiperparâmetros em paralelo e encerra
+ * - --servir <porta|->: serve predições do modelo (--modelo ou modelo.nnm) por TCP ou stdin
+ * - --espera <us>: espera máxima para formar um micro-lote no modo servidor (padrão: 500)
+ * - --ativacao <nome>: ativação das camadas ocultas de uma rede nova (leaky_relu, relu, tanh,
+ *   gelu, sigmoid ou identity; padrão: leaky_relu)
+ * - --inicializacao <esquema>: inicialização dos pesos de uma rede nova (uniform, xavier_uniform,
+ *   xavier_normal, he_uniform ou he_normal; padrão: uniform)
+ * - --semente <n>: semente da inicialização (padrão: 42)
+ * - --estado <arquivo>: grava o estado do treinamento (pesos, otimizador, época) a cada época
+ *   e retoma a partir dele se o arquivo já existir
+ *
  * @return int Código de saída (0 = sucesso, 1 = erro)
  */
-int main()
+int main(int argc, char *argv[])
 {
+    string arquivo_modelo;
+    string arquivo_saida = "modelo.nnm";
+    int epocas_busca = 0;
+    string endereco_servidor;
+    int espera_us = 500;
+    kernels::Activation ativacao_oculta = kernels::Activation::LeakyRelu;
+    initialization::InitializationOptions inicializacao;
+    string arquivo_estado;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        string opcao = argv[i];
+        // Toda opção leva um valor; sem ele, --modelo sozinho treinaria de novo e sobrescreveria o modelo
+        if (i + 1 >= argc)
+        {
+            printf("Opção sem valor: %s\n", opcao.c_str());
+            return 1;
+        }
+        if (opcao == "--modelo")
+            arquivo_modelo = argv[i + 1];
+        else if (opcao == "--salvar")
+            arquivo_saida = argv[i + 1];
+        else if (opcao == "--busca")
+            epocas_busca = atoi(argv[i + 1]);
+        else if (opcao == "--servir")
+            endereco_servidor = argv[i + 1];
+        else if (opcao == "--espera")
+            espera_us = atoi(argv[i + 1]);
+        else if (opcao == "--ativacao")
+        {
+            if (!kernels::parseActivation(argv[i + 1], ativacao_oculta) ||
+                ativacao_oculta == kernels::Activation::Softmax)
+            {
+                printf("Ativação inválida para camadas ocultas: %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (opcao == "--inicializacao")
+        {
+            if (!initialization::parseScheme(argv[i + 1], inicializacao.weights))
+            {
+                printf("Esquema de inicialização desconhecido: %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (opcao == "--semente")
+            inicializacao.seed = strtoull(argv[i + 1], nullptr, 10);
+        else if (opcao == "--estado")
+            arquivo_estado = argv[i + 1];
+        else
+        {
+            printf("Opção desconhecida: %s\n", opcao.c_str());
+            return 1;
+        }
+    }
+
+    // Valores máximos usados na normalização dos CSVs (idade, peso, altura)
+    const Normalizer normalizador({100.0f, 250.0f, 200.0f});
+
+    if (!endereco_servidor.empty())
+    {
+        return servirModelo(arquivo_modelo.empty() ? "modelo.nnm" : arquivo_modelo, endereco_servidor, espera_us,
+                            normalizador);
+    }
+
     printf("=== Sistema de Predição de Risco Cardiovascular ===\n");
     printf("Rede Neural em C++ - Treinamento e Inferência\n\n");
 
@@ -191,9 +538,9 @@ int main()
     // =====================================
     printf("Carregando conjuntos de dados...\n");
 
-    vector<vector<float>> dados_treinamento = lerCSV("data/training_data.csv");
-    vector<vector<float>> dados_teste = lerCSV("data/test_data.csv");
-    vector<vector<float>> dados_validacao = lerCSV("data/validation_data.csv");
+    Dataset dados_treinamento = lerCSV("data/training_data.csv");
+    Dataset dados_teste = lerCSV("data/test_data.csv");
+    Dataset dados_validacao = lerCSV("data/validation_data.csv");
 
     if (dados_treinamento.empty())
     {
@@ -207,12 +554,17 @@ int main()
     printf("  Teste: %zu amostras\n", dados_teste.size());
     printf("  Validação: %zu amostras\n", dados_validacao.size());
 
+    if (epocas_busca > 0)
+    {
+        buscarHiperparametros(dados_treinamento, dados_validacao, epocas_busca);
+        return 0;
+    }
+
     // =====================================
     // 2. CRIAÇÃO DA REDE NEURAL
     // =====================================
     printf("\nCriando rede neural...\n");
 
-    Normalizer *normalizer = new Normalizer({100.0f, 250.0f, 200.0f}); // Valores máximos para normalização
 
     // Arquitetura: 3 entradas -> 2 camadas ocultas de 8 neurônios -> 1 saída
     const int entradas = 3; // idade, peso, altura (normalizados)
@@ -220,83 +572,75 @@ int main()
     const int camadas_ocultas = 2;
     const int neuronios_por_camada = 4;
 
-    NeuralNetwork *rede = new NeuralNetwork(entradas, saidas, camadas_ocultas, neuronios_por_camada);
-
-    printf("Arquitetura da rede:\n");
-    printf("  Entradas: %d neurônios\n", rede->getInputSize());
-    printf("  Camadas ocultas: %d (com %d neurônios cada)\n", camadas_ocultas, neuronios_por_camada);
-    printf("  Saídas: %d neurônio\n", rede->getOutputSize());
-
-    // =====================================
-    // 3. TREINAMENTO DA REDE
-    // =====================================
-    printf("\nIniciando treinamento...\n");
-
-    const int epocas = 100;
-    const int tamanho_lote = 32;
-
-    const int epocas_rastreadas = 100;
-
-    auto inicio_treinamento = chrono::high_resolution_clock::now();
-
-    for (int epoca = 0; epoca < epocas; ++epoca)
+    shared_ptr<NeuralNetwork> rede;
+    if (!arquivo_modelo.empty())
     {
-        // Enable delta tracking for first few epochs
-        if (epoca < epocas_rastreadas)
+        auto inicio_carga = chrono::high_resolution_clock::now();
+        try
         {
-            rede->enableDeltaTracking();
-            printf("Época %d: Rastreando deltas...\n", epoca);
+            rede = NeuralNetwork::load(arquivo_modelo);
         }
-        else if (epoca == epocas_rastreadas)
+        catch (const exception &erro)
         {
-            rede->disableDeltaTracking();
-            printf("Rastreamento de deltas desativado. Continuando treinamento normal...\n");
+            printf("Erro: Não foi possível carregar o modelo %s: %s\n", arquivo_modelo.c_str(), erro.what());
+            return 1;
         }
+        auto fim_carga = chrono::high_resolution_clock::now();
 
-        rede->setEpoch(epoca);
-        rede->train(dados_treinamento, tamanho_lote);
-
-        // Progress report
-        if (epoca % 100 == 0 || epoca < epocas_rastreadas)
-        {
-            float perda_media = 0.0f;
-            int amostras_teste = min(100, (int)dados_treinamento.size());
+        printf("Modelo carregado de %s em %.3f ms.\n", arquivo_modelo.c_str(),
+               chrono::duration<double, milli>(fim_carga - inicio_carga).count());
+    }
+    else
+    {
+        rede = make_shared<NeuralNetwork>(entradas, saidas, camadas_ocultas, neuronios_por_camada);
+        for (int camada = 1; camada <= camadas_ocultas; ++camada)
+            rede->setActivation(camada, ativacao_oculta);
+        // Xavier e He partem de vieses nulos
+        if (inicializacao.weights != initialization::Scheme::Uniform)
+            inicializacao.biasRange = 0.0f;
+        rede->initialize(inicializacao);
+    }
 
-            for (int i = 0; i < amostras_teste; ++i)
-            {
-                const auto &amostra = dados_treinamento[i];
-                vector<float> entradas(amostra.begin(), amostra.begin() + 3);
-                vector<float> alvo = {amostra.back()};
+    printf("Arquitetura da rede:\n");
+    printf("  Entradas: %d neurônios\n", rede->getInputSize());
+    printf("  Camadas ocultas: %d (com %zu neurônios cada, ativação %s)\n", rede->getHiddenLayerCount(),
+           rede->getHiddenLayerCount() ? rede->getLayerSizes()[1] : (size_t)0,
+           kernels::activationName(rede->getActivation(1)));
+    printf("  Saídas: %d neurônio (ativação %s)\n", rede->getOutputSize(),
+           kernels::activationName(rede->getActivation(rede->getHiddenLayerCount() + 1)));
 
-                rede->forward(entradas);
-                perda_media += rede->calculateLoss(alvo);
-            }
-            perda_media /= amostras_teste;
+    // =====================================
+    // 3. TREINAMENTO DA REDE
+    // =====================================
+    if (arquivo_modelo.empty())
+    {
+        treinarRede(rede.get(), dados_treinamento, dados_validacao, arquivo_estado);
 
-            printf("Época %d/%d: Perda média = %.4f\n", epoca, epocas, perda_media);
-        }
+        rede->save(arquivo_saida);
+        printf("Modelo salvo em %s\n", arquivo_saida.c_str());
     }
 
-    auto fim_treinamento = chrono::high_resolution_clock::now();
-    auto duracao = chrono::duration_cast<chrono::milliseconds>(fim_treinamento - inicio_treinamento);
-
-    printf("Treinamento concluído em %.2f segundos.\n", duracao.count() / 1000.0);
-
     // =====================================
     // 4. AVALIAÇÃO DA REDE
     // =====================================
     printf("\n=== AVALIAÇÃO DE PERFORMANCE ===\n");
 
     // Avalia nos diferentes conjuntos de dados
-    avaliarRede(rede, dados_teste, "teste");
-    avaliarRede(rede, dados_validacao, "validação");
+    avaliarRede(rede.get(), dados_teste, "teste");
+    avaliarRede(rede.get(), dados_validacao, "validação");
+
+    if (!dados_teste.empty())
+    {
+        avaliarQuantizacao(*rede, dados_teste);
+        avaliarPoda(*rede, dados_treinamento, dados_validacao, dados_teste);
+    }
 
     // =====================================
     // 5. DEMONSTRAÇÃO DE PREDIÇÕES
     // =====================================
     if (!dados_teste.empty())
     {
-        demonstrarPredicoes(rede, dados_teste, 8);
+        demonstrarPredicoes(rede.get(), dados_teste, 8);
     }
 
     // =====================================
@@ -304,36 +648,61 @@ int main()
     // =====================================
     printf("\n--- Teste com Dados Personalizados ---\n");
 
+    // Os conjuntos de dados já vêm normalizados; para os exemplos com valores
+    // brutos a normalização passa a fazer parte do modelo
+    if (!rede->getInputNormalizer())
+    {
+        rede->setInputNormalizer(normalizador);
+    }
+
+    // Com a topologia de produção, as predições usam a versão estática da rede
+    // (sem alocações); outras topologias seguem pela rede dinâmica
+    unique_ptr<RedeProducao> rede_producao;
+    const vector<size_t> tamanhos_producao(RedeProducao::layerSizes.begin(), RedeProducao::layerSizes.end());
+    if (rede->getLayerSizes() == tamanhos_producao)
+    {
+        rede_producao = make_unique<RedeProducao>(*rede);
+    }
+
+    auto prever = [&](const vector<float> &entradas_brutas)
+    {
+        if (!rede_producao)
+            return rede->forward(entradas_brutas)[0];
+
+        float risco;
+        rede_producao->forward(entradas_brutas.data(), &risco);
+        return risco;
+    };
+
     // Exemplo: pessoa jovem, peso normal, altura média
     vector<float> exemplo1 = {25.0f, 70.0f, 175.0f}; // 25 anos, 70kg, 175cm
-    vector<float> exemplo1Normalizado = normalizer->normalize(exemplo1);
-    vector<float> resultado1 = rede->forward(exemplo1Normalizado);
-    printf("Pessoa jovem (25a, 70kg, 175cm): Risco CVD = %.2f%%\n", resultado1[0] * 100);
+    float resultado1 = prever(exemplo1);
+    printf("Pessoa jovem (25a, 70kg, 175cm): Risco CVD = %.2f%%\n", resultado1 * 100);
 
     // Exemplo: pessoa mais velha, sobrepeso, altura média
     vector<float> exemplo2 = {60.0f, 90.0f, 170.0f}; // 60 anos, 90kg, 170cm
-    vector<float> exemplo2Normalizado = normalizer->normalize(exemplo2);
-    vector<float> resultado2 = rede->forward(exemplo2Normalizado);
-    printf("Pessoa mais velha (60a, 90kg, 170cm): Risco CVD = %.2f%%\n", resultado2[0] * 100);
+    float resultado2 = prever(exemplo2);
+    printf("Pessoa mais velha (60a, 90kg, 170cm): Risco CVD = %.2f%%\n", resultado2 * 100);
 
     // Exemplo: pai
     vector<float> exemplo3 = {57.0f, 79.0f, 170.0f}; // 57 anos, 79kg, 170cm
-    vector<float> exemplo3Normalizado = normalizer->normalize(exemplo3);
-    vector<float> resultado3 = rede->forward(exemplo3Normalizado);
-    printf("Pessoa (57a, 79kg, 170cm): Risco CVD = %.2f%%\n", resultado3[0] * 100);
+    float resultado3 = prever(exemplo3);
+    printf("Pessoa (57a, 79kg, 170cm): Risco CVD = %.2f%%\n", resultado3 * 100);
 
     // Exemplo: mãe
     vector<float> exemplo4 = {50.0f, 58.0f, 159.0f}; // 50 anos, 58kg, 159cm
-    vector<float> exemplo4Normalizado = normalizer->normalize(exemplo4);
-    vector<float> resultado4 = rede->forward(exemplo4Normalizado);
-    printf("Pessoa (50a, 58kg, 159cm): Risco CVD = %.2f%%\n", resultado4[0] * 100);
+    float resultado4 = prever(exemplo4);
+    printf("Pessoa (50a, 58kg, 159cm): Risco CVD = %.2f%%\n", resultado4 * 100);
 
     // =====================================
     // 7. LIMPEZA E FINALIZAÇÃO
     // =====================================
-    printf("\nExportando deltas para análise...\n");
-    rede->exportDeltasToCSV("deltas.csv");
-    delete rede;
+    if (arquivo_modelo.empty())
+    {
+        printf("\nFinalizando gravação dos deltas...\n");
+        rede->flushDeltas();
+        printf("Deltas gravados em deltas.bin (visualize com: python3 visualize_deltas.py --input deltas.bin)\n");
+    }
 
     printf("\n=== Execução Finalizada com Sucesso ===\n");
     printf("A rede neural foi treinada e avaliada.\n");
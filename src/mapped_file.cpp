@@ -0,0 +1,79 @@
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace io
+{
+    MappedFile::MappedFile(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error("Could not open file " + path);
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            close(fd);
+            throw runtime_error("Could not read file " + path);
+        }
+
+        length = static_cast<size_t>(info.st_size);
+        address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (address == MAP_FAILED)
+            throw runtime_error("Could not map file " + path);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        munmap(address, length);
+    }
+
+    void MappedFile::adviseSequential() const
+    {
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+
+    void MappedFile::release(size_t offset, size_t size) const
+    {
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t first = (offset + pageSize - 1) / pageSize * pageSize;
+        const size_t last = min(offset + size, length) / pageSize * pageSize;
+        if (first < last)
+            madvise(static_cast<char *>(address) + first, last - first, MADV_DONTNEED);
+    }
+
+    namespace
+    {
+        bool syncPath(const string &path, int flags)
+        {
+            int fd = open(path.c_str(), flags);
+            if (fd < 0)
+                return false;
+            const bool synced = fsync(fd) == 0;
+            close(fd);
+            return synced;
+        }
+    }
+
+    bool commitFile(const string &temporaryPath, const string &path)
+    {
+        const size_t slash = path.rfind('/');
+        const string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+
+        if (!syncPath(temporaryPath, O_WRONLY) || rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            unlink(temporaryPath.c_str());
+            return false;
+        }
+        return syncPath(directory, O_RDONLY | O_DIRECTORY);
+    }
+}
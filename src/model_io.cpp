@@ -0,0 +1,149 @@
+#include "model_io.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+using namespace std;
+
+namespace model_io
+{
+    namespace
+    {
+        // Keeps hostile headers from requesting absurd allocations.
+        const uint32_t maxLayerCount = 4096;
+
+        uint64_t alignUp(uint64_t offset)
+        {
+            return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+        }
+
+        // End of a blob of count floats starting at offset, aligned for the
+        // next one. Layer sizes come from files too, so a size that would
+        // wrap the 64-bit offsets is rejected rather than computed.
+        uint64_t blobEnd(uint64_t offset, uint64_t count)
+        {
+            const uint64_t limit = numeric_limits<uint64_t>::max() - blobAlignment;
+            if (count > limit / sizeof(float) || offset > limit - count * sizeof(float))
+                throw invalid_argument("Layer sizes are too large for a model file");
+            return alignUp(offset + count * sizeof(float));
+        }
+
+        // 32-bit words between the header and the first blob.
+        size_t headerWords(size_t layerCount, uint32_t version)
+        {
+            return layerCount + (version >= 2 ? 1 : 0) + (version >= 3 ? layerCount : 0);
+        }
+    }
+
+    ModelLayout computeLayout(const vector<size_t> &layerSizes, InputStage inputStage, uint32_t version)
+    {
+        if (layerSizes.size() < 2)
+            throw invalid_argument("A model needs at least an input and an output layer");
+
+        ModelLayout layout;
+        uint64_t offset = alignUp(sizeof(FileHeader) + headerWords(layerSizes.size(), version) * sizeof(uint32_t));
+
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            layout.biases.push_back({offset, layerSizes[l]});
+            offset = blobEnd(offset, layerSizes[l]);
+
+            const uint64_t nextSize = (l + 1 < layerSizes.size()) ? layerSizes[l + 1] : 0;
+            if (nextSize && layerSizes[l] > numeric_limits<uint64_t>::max() / nextSize)
+                throw invalid_argument("Layer sizes are too large for a model file");
+            const uint64_t weightCount = layerSizes[l] * nextSize;
+            layout.weights.push_back({offset, weightCount});
+            offset = blobEnd(offset, weightCount);
+        }
+
+        const uint64_t stageCount = inputStage != InputStage::None ? layerSizes.front() : 0;
+        layout.inputOffsets = {offset, stageCount};
+        offset = blobEnd(offset, stageCount);
+        layout.inputScales = {offset, stageCount};
+        offset = blobEnd(offset, stageCount);
+
+        layout.fileSize = offset;
+        return layout;
+    }
+
+    ModelTopology readTopology(const io::MappedFile &file)
+    {
+        FileHeader header;
+        if (file.size() < sizeof(header))
+            throw runtime_error("Model file is truncated");
+        memcpy(&header, file.data(), sizeof(header));
+
+        if (memcmp(header.magic, modelMagic, sizeof(modelMagic)) != 0)
+            throw runtime_error("Not a model file");
+        if (header.version < 1 || header.version > modelVersion)
+            throw runtime_error("Unsupported model file version " + to_string(header.version));
+        if (header.endianTag != endianTag || header.floatSize != sizeof(float))
+            throw runtime_error("Model file was written on an incompatible platform");
+        if (header.layerCount < 2 || header.layerCount > maxLayerCount)
+            throw runtime_error("Model file has an invalid layer count");
+        const size_t stageWords = header.version >= 2 ? 1 : 0;
+        if (file.size() < sizeof(header) + headerWords(header.layerCount, header.version) * sizeof(uint32_t))
+            throw runtime_error("Model file is truncated");
+
+        vector<size_t> layerSizes(header.layerCount);
+        const unsigned char *sizes = file.data() + sizeof(header);
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            uint32_t size;
+            memcpy(&size, sizes + l * sizeof(size), sizeof(size));
+            if (size == 0)
+                throw runtime_error("Model file has an empty layer");
+            layerSizes[l] = size;
+        }
+
+        InputStage inputStage = InputStage::None;
+        if (stageWords)
+        {
+            uint32_t stage;
+            memcpy(&stage, sizes + layerSizes.size() * sizeof(stage), sizeof(stage));
+            if (stage > static_cast<uint32_t>(InputStage::AffineClamped))
+                throw runtime_error("Model file has an unknown input stage");
+            inputStage = static_cast<InputStage>(stage);
+        }
+
+        vector<kernels::Activation> activations(layerSizes.size(), kernels::Activation::LeakyRelu);
+        activations.front() = kernels::Activation::Identity;
+        activations.back() = kernels::Activation::Sigmoid;
+        if (header.version >= 3)
+        {
+            const unsigned char *words = sizes + (layerSizes.size() + stageWords) * sizeof(uint32_t);
+            for (size_t l = 0; l < activations.size(); ++l)
+            {
+                uint32_t activation;
+                memcpy(&activation, words + l * sizeof(activation), sizeof(activation));
+                if (activation >= kernels::activationCount)
+                    throw runtime_error("Model file has an unknown activation");
+                activations[l] = static_cast<kernels::Activation>(activation);
+            }
+        }
+
+        if (header.fileSize != file.size() ||
+            computeLayout(layerSizes, inputStage, header.version).fileSize != file.size())
+            throw runtime_error("Model file size doesn't match its topology");
+
+        return {header.version, layerSizes, inputStage, activations};
+    }
+
+    void writeModelFile(const string &path, const vector<unsigned char> &image)
+    {
+        const string temporaryPath = path + ".tmp";
+        {
+            ofstream file(temporaryPath, ios::binary | ios::trunc);
+            if (!file.is_open())
+                throw runtime_error("Could not open file for model export: " + temporaryPath);
+
+            file.write(reinterpret_cast<const char *>(image.data()), image.size());
+            if (!file.flush())
+                throw runtime_error("Could not write model file: " + temporaryPath);
+        }
+
+        if (!io::commitFile(temporaryPath, path))
+            throw runtime_error("Could not replace model file: " + path);
+    }
+}
@@ -1,60 +1,133 @@
 #include "neural_network.hpp"
+#include "kernels.hpp"
+#include "model_io.hpp"
+#include "instrumentation.hpp"
+#include "sparse_network.hpp"
 #include <stdexcept>
 #include <algorithm>
 #include <math.h>
-#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
 
 using namespace neural_network;
 using namespace layers;
 
 namespace neural_network
 {
-    NeuralNetwork::NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount)
+    namespace
     {
-        if (inputSize <= 0 || outputSize <= 0 || hiddenLayerCount < 0)
+        // Rows of the batch processed together; keeps both ping-pong
+        // activation tiles resident in cache for typical layer widths.
+        const size_t batchChunkSize = 256;
+        // Parameter count above which initialize() fans out over every
+        // core even when the network has no training threads yet.
+        const size_t parallelInitializationSize = 1 << 22;
+
+        // Turns one row of output logits into outputs and, when deltas is
+        // set, dLoss/dlogit; returns the row's loss. Sigmoid outputs score
+        // binary cross-entropy from the logit, softmax categorical
+        // cross-entropy through log-softmax (both with delta output - target),
+        // anything else half the squared error. outputs may alias logits.
+        template <kernels::Activation A>
+        float scoreOutputs(const float *logits, const float *expected, size_t n, float *outputs, float *deltas)
         {
-            throw invalid_argument("Invalid network dimensions");
+            float loss = 0.0f;
+            if constexpr (A == kernels::Activation::Sigmoid)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const float logit = logits[i];
+                    outputs[i] = nodes::sigmoid(logit);
+                    if (deltas)
+                        deltas[i] = outputs[i] - expected[i];
+                    loss += nodes::sigmoidCrossEntropy(logit, expected[i]);
+                }
+                return loss / n;
+            }
+            else if constexpr (A == kernels::Activation::Softmax)
+            {
+                const float peak = *max_element(logits, logits + n);
+                float sum = 0.0f;
+                for (size_t i = 0; i < n; ++i)
+                    sum += exp(logits[i] - peak);
+                const float logSum = peak + log(sum);
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const float logProbability = logits[i] - logSum;
+                    outputs[i] = exp(logProbability);
+                    if (deltas)
+                        deltas[i] = outputs[i] - expected[i];
+                    loss -= expected[i] * logProbability;
+                }
+                return loss;
+            }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    float derivative;
+                    outputs[i] = kernels::activate<A>(logits[i], derivative);
+                    const float error = outputs[i] - expected[i];
+                    if (deltas)
+                        deltas[i] = error * derivative;
+                    loss += 0.5f * error * error;
+                }
+                return loss / n;
+            }
         }
+    }
+
+    NeuralNetwork::NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount)
+        : NeuralNetwork(inputSize, outputSize, hiddenLayerCount, calculateHiddenLayerSize(inputSize, outputSize))
+    {
+    }
+
+    NeuralNetwork::NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount, int hiddenLayerSize)
+        : NeuralNetwork(checkedLayerSizes(inputSize, outputSize, hiddenLayerCount, hiddenLayerSize), true)
+    {
+        initialize(initialization::InitializationOptions());
+    }
 
-        inputLayer = make_shared<InputLayer>(inputSize);
-        outputLayer = make_shared<OutputLayer>(outputSize);
+    NeuralNetwork::NeuralNetwork(const vector<size_t> &layerSizes, bool allocateParameters)
+    {
+        // Parameters and their gradients all come from one block.
+        if (allocateParameters)
+            arena = make_shared<memory::Arena>(arenaSize(layerSizes, 2));
 
-        int hiddenSize = calculateHiddenLayerSize(inputSize, outputSize);
-        hiddenLayers.reserve(hiddenLayerCount);
+        inputLayer = make_shared<InputLayer>(layerSizes.front(), arena, allocateParameters);
+        outputLayer = make_shared<OutputLayer>(layerSizes.back(), arena, allocateParameters);
 
-        for (int i = 0; i < hiddenLayerCount; ++i)
+        hiddenLayers.reserve(layerSizes.size() - 2);
+        for (size_t l = 1; l + 1 < layerSizes.size(); ++l)
         {
-            hiddenLayers.push_back(make_shared<HiddenLayer>(hiddenSize));
+            hiddenLayers.push_back(make_shared<HiddenLayer>(layerSizes[l], arena, allocateParameters));
         }
 
         createConnections();
+        optimizer = make_unique<optimization::Sgd>();
+
+        context = createInferenceContext();
+        setThreadCount(1);
 
         trackDeltas = false;
         currentEpoch = 0;
         currentSample = 0;
     }
 
-    NeuralNetwork::NeuralNetwork(int inputSize, int outputSize, int hiddenLayerCount, int hiddenLayerSize)
+    vector<size_t> NeuralNetwork::checkedLayerSizes(int inputSize, int outputSize, int hiddenLayerCount,
+                                                    int hiddenLayerSize)
     {
         if (inputSize <= 0 || outputSize <= 0 || hiddenLayerCount < 0 || hiddenLayerSize <= 0)
         {
             throw invalid_argument("Invalid network dimensions");
         }
 
-        inputLayer = make_shared<InputLayer>(inputSize);
-        outputLayer = make_shared<OutputLayer>(outputSize);
-
-        hiddenLayers.reserve(hiddenLayerCount);
-        for (int i = 0; i < hiddenLayerCount; ++i)
-        {
-            hiddenLayers.push_back(make_shared<HiddenLayer>(hiddenLayerSize));
-        }
-
-        createConnections();
-
-        trackDeltas = false;
-        currentEpoch = 0;
-        currentSample = 0;
+        vector<size_t> layerSizes(hiddenLayerCount + 2, hiddenLayerSize);
+        layerSizes.front() = inputSize;
+        layerSizes.back() = outputSize;
+        return layerSizes;
     }
 
     void NeuralNetwork::createConnections()
@@ -81,307 +154,1032 @@ namespace neural_network
         }
     }
 
-    int NeuralNetwork::calculateHiddenLayerSize(int inputSize, int outputSize) const
+    int NeuralNetwork::calculateHiddenLayerSize(int inputSize, int outputSize)
     {
         return max(1, (inputSize + outputSize) * 2 / 3);
     }
 
-    void NeuralNetwork::updateLayer(shared_ptr<InputLayer> layer, float learningRate)
+    size_t NeuralNetwork::arenaSize(const vector<size_t> &layerSizes, size_t copies)
     {
-        for (auto &edge : layer->edges)
+        size_t total = 0;
+        for (size_t l = 0; l < layerSizes.size(); ++l)
         {
-            edge->weight -= learningRate * edge->sourceNode->value * edge->targetNode->delta;
-        }
-        for (auto &node : layer->nodes)
-        {
-            node->bias -= learningRate * node->delta;
+            total += copies * memory::Arena::paddedSize(layerSizes[l]);
+            if (l + 1 < layerSizes.size())
+                total += copies * memory::Arena::paddedSize(layerSizes[l] * layerSizes[l + 1]);
         }
+        return total;
+    }
+
+    void NeuralNetwork::prepareGradients()
+    {
+        // The default context doubles as the first training worker.
+        context.workspace.allocateGradients();
+        if (inputLayer->hasGradients())
+            return;
+
+        auto gradientArena = make_shared<memory::Arena>(arenaSize(getLayerSizes(), 1));
+        for (size_t l = 0; l < hiddenLayers.size() + 2; ++l)
+            layerAt(l).allocateGradients(gradientArena);
+    }
+
+    const Layer &NeuralNetwork::layerAt(size_t index) const
+    {
+        if (index == 0)
+            return *inputLayer;
+        if (index <= hiddenLayers.size())
+            return *hiddenLayers[index - 1];
+        return *outputLayer;
+    }
+
+    Layer &NeuralNetwork::layerAt(size_t index)
+    {
+        return const_cast<Layer &>(static_cast<const NeuralNetwork *>(this)->layerAt(index));
+    }
+
+    const ParameterBuffer &NeuralNetwork::weightsFrom(size_t index) const
+    {
+        return (index == 0) ? inputLayer->weights : hiddenLayers[index - 1]->weights;
+    }
+
+    ParameterBuffer &NeuralNetwork::weightsFrom(size_t index)
+    {
+        return (index == 0) ? inputLayer->weights : hiddenLayers[index - 1]->weights;
+    }
+
+    ParameterBuffer &NeuralNetwork::weightGradientsFrom(size_t index)
+    {
+        return (index == 0) ? inputLayer->weightGradients : hiddenLayers[index - 1]->weightGradients;
+    }
+
+    Workspace &NeuralNetwork::trainingWorkspace(size_t worker)
+    {
+        return (worker == 0) ? context.workspace : extraWorkspaces[worker - 1];
+    }
+
+    void NeuralNetwork::checkContext(const InferenceContext &context) const
+    {
+        // Runs on every inference call, so compare in place rather than
+        // through getLayerSizes().
+        const Workspace &workspace = context.workspace;
+        bool matches = workspace.getLayerCount() == hiddenLayers.size() + 2;
+        for (size_t l = 0; matches && l < workspace.getLayerCount(); ++l)
+            matches = workspace.values[l].size() == layerAt(l).getNodeCount();
+
+        if (!matches)
+            throw invalid_argument("Inference context was created for a different network topology");
+    }
+
+    vector<size_t> NeuralNetwork::getLayerSizes() const
+    {
+        vector<size_t> sizes;
+        sizes.push_back(inputLayer->getNodeCount());
+        for (const auto &hiddenLayer : hiddenLayers)
+            sizes.push_back(hiddenLayer->getNodeCount());
+        sizes.push_back(outputLayer->getNodeCount());
+        return sizes;
+    }
+
+    const ParameterBuffer &NeuralNetwork::getWeights(size_t index) const
+    {
+        if (index > hiddenLayers.size())
+            throw out_of_range("Layer index out of range");
+        return weightsFrom(index);
+    }
+
+    const ParameterBuffer &NeuralNetwork::getBiases(size_t index) const
+    {
+        if (index > hiddenLayers.size() + 1)
+            throw out_of_range("Layer index out of range");
+        return layerAt(index).biases;
     }
 
-    void NeuralNetwork::updateLayer(shared_ptr<HiddenLayer> layer, float learningRate)
+    void NeuralNetwork::initialize(const initialization::InitializationOptions &options)
     {
-        for (auto &edge : layer->edges)
+        const size_t layerCount = hiddenLayers.size() + 2;
+        size_t parameterCount = 0;
+        for (size_t l = 0; l + 1 < layerCount; ++l)
+            parameterCount += weightsFrom(l).size() + layerAt(l + 1).getNodeCount();
+
+        unique_ptr<threading::ThreadPool> transientPool;
+        threading::ThreadPool *pool = threadPool.get();
+        if (!pool && parameterCount >= parallelInitializationSize && thread::hardware_concurrency() > 1)
         {
-            edge->weight -= learningRate * edge->sourceNode->value * edge->targetNode->delta;
+            transientPool = make_unique<threading::ThreadPool>(thread::hardware_concurrency());
+            pool = transientPool.get();
         }
-        for (auto &node : layer->nodes)
+
+        // Stream 2l draws the weights leaving layer l, 2l + 1 the biases of
+        // layer l; the input layer's biases are never used and stay zero.
+        for (size_t l = 0; l < layerCount; ++l)
         {
-            node->bias -= learningRate * node->delta;
+            if (l + 1 < layerCount)
+                initialization::fillWeights(weightsFrom(l).data(), layerAt(l).getNodeCount(),
+                                            layerAt(l + 1).getNodeCount(), options, 2 * l, pool);
+            if (l == 0)
+                continue;
+
+            ParameterBuffer &biases = layerAt(l).biases;
+            if (options.biasRange > 0.0f)
+                initialization::fillUniform(biases.data(), biases.size(), -options.biasRange, options.biasRange,
+                                            initialization::CounterRng(options.seed, 2 * l + 1), pool);
+            else
+                fill(biases.begin(), biases.end(), 0.0f);
         }
+        pruningMasks.clear();
     }
 
-    void NeuralNetwork::updateLayer(shared_ptr<OutputLayer> layer, float learningRate)
+    void NeuralNetwork::prune(float sparsity)
     {
-        for (auto &node : layer->nodes)
+        const size_t layerCount = hiddenLayers.size() + 2;
+        vector<vector<float>> masks(layerCount - 1);
+
+        for (size_t l = 0; l + 1 < layerCount; ++l)
         {
-            node->bias -= learningRate * node->delta;
+            ParameterBuffer &weights = weightsFrom(l);
+            const float threshold = magnitudeThreshold(weights.data(), weights.size(), sparsity);
+
+            // An earlier mask stays in force, so pruning only ever grows.
+            masks[l].resize(weights.size());
+            for (size_t i = 0; i < weights.size(); ++i)
+            {
+                const bool kept = fabs(weights[i]) > threshold && (pruningMasks.empty() || pruningMasks[l][i] != 0.0f);
+                masks[l][i] = kept ? 1.0f : 0.0f;
+                if (!kept)
+                    weights[i] = 0.0f;
+            }
         }
+        pruningMasks = move(masks);
     }
 
-    void NeuralNetwork::applyGradients(float learningRate)
+    void NeuralNetwork::setActivation(size_t index, kernels::Activation activation)
     {
-        this->updateLayer(this->inputLayer, learningRate);
-
-        for (auto &hiddenLayer : this->hiddenLayers)
+        const size_t outputIndex = hiddenLayers.size() + 1;
+        if (index == 0 || index > outputIndex)
+            throw out_of_range("Layer index out of range");
+        if (static_cast<size_t>(activation) >= kernels::activationCount)
+            throw invalid_argument("Unknown activation");
+        if (activation == kernels::Activation::Softmax)
         {
-            this->updateLayer(hiddenLayer, learningRate);
+            if (index != outputIndex)
+                throw invalid_argument("Softmax is only supported on the output layer");
+            if (outputLayer->getNodeCount() < 2)
+                throw invalid_argument("Softmax needs at least two outputs");
         }
+        layerAt(index).activation = activation;
+    }
 
-        this->updateLayer(this->outputLayer, learningRate);
+    kernels::Activation NeuralNetwork::getActivation(size_t index) const
+    {
+        if (index > hiddenLayers.size() + 1)
+            throw out_of_range("Layer index out of range");
+        return layerAt(index).activation;
     }
 
-    void NeuralNetwork::backpropagate(vector<float> &expected, float learningRate)
+    void NeuralNetwork::setInputNormalizer(const Normalizer &normalizer)
     {
-        for (size_t i = 0; i < outputLayer->nodes.size(); ++i)
+        if (normalizer.getFeatureCount() != static_cast<size_t>(getInputSize()))
+            throw invalid_argument("Normalizer feature count doesn't match network input size");
+        inputNormalizer = make_unique<Normalizer>(normalizer);
+    }
+
+    void NeuralNetwork::clearInputNormalizer()
+    {
+        inputNormalizer.reset();
+    }
+
+    void NeuralNetwork::appendParameters(vector<float> &parameters) const
+    {
+        const size_t layerCount = hiddenLayers.size() + 2;
+        for (size_t l = 0; l < layerCount; ++l)
         {
-            outputLayer->nodes[i]->delta = outputLayer->nodes[i]->value - expected[i];
+            if (l + 1 < layerCount)
+                parameters.insert(parameters.end(), weightsFrom(l).begin(), weightsFrom(l).end());
+            parameters.insert(parameters.end(), layerAt(l).biases.begin(), layerAt(l).biases.end());
         }
+    }
+
+    vector<float> NeuralNetwork::getParameters() const
+    {
+        vector<float> parameters;
+        appendParameters(parameters);
+        return parameters;
+    }
 
-        for (size_t l = hiddenLayers.size(); l-- > 0;)
+    void NeuralNetwork::setParameters(const vector<float> &parameters)
+    {
+        // Same layout as appendParameters(), input biases included.
+        const size_t layerCount = hiddenLayers.size() + 2;
+        size_t total = 0;
+        for (size_t l = 0; l < layerCount; ++l)
+            total += (l + 1 < layerCount ? weightsFrom(l).size() : 0) + layerAt(l).biases.size();
+        if (parameters.size() != total)
+            throw invalid_argument("Parameter count doesn't match network topology");
+
+        const float *source = parameters.data();
+        for (size_t l = 0; l < layerCount; ++l)
         {
-            for (auto &node : hiddenLayers[l]->nodes)
+            if (l + 1 < layerCount)
             {
-                float sum = 0.0f;
-                for (auto &edge : hiddenLayers[l]->edges)
-                {
-                    if (edge->sourceNode == node)
-                    {
-                        sum += edge->weight * edge->targetNode->delta;
-                    }
-                }
-                node->delta = sum * node->reluDerivative();
+                ParameterBuffer &weights = weightsFrom(l);
+                copy(source, source + weights.size(), weights.begin());
+                source += weights.size();
             }
+            ParameterBuffer &biases = layerAt(l).biases;
+            copy(source, source + biases.size(), biases.begin());
+            source += biases.size();
         }
+    }
+
+    void NeuralNetwork::captureTrainingState(checkpointing::TrainingState &state) const
+    {
+        state.layerSizes = getLayerSizes();
+        state.parameters.clear();
+        appendParameters(state.parameters);
+        state.optimizerName = optimizer->getName();
+        state.optimizerSteps = optimizer->getStepCount();
+        state.optimizerState.clear();
+        optimizer->saveState(state.optimizerState);
+        state.epoch = currentEpoch;
+    }
+
+    void NeuralNetwork::restoreTrainingState(const checkpointing::TrainingState &state)
+    {
+        if (state.layerSizes != getLayerSizes())
+            throw invalid_argument("Checkpoint topology doesn't match the network");
+        if (state.optimizerName != optimizer->getName())
+            throw invalid_argument("Checkpoint was taken with optimizer " + state.optimizerName + ", not " +
+                                   optimizer->getName());
+
+        setParameters(state.parameters);
+        optimizer->loadState(parameterGroups(), state.optimizerState, state.optimizerSteps);
+        currentEpoch = state.epoch;
+    }
+
+    void NeuralNetwork::setThreadCount(int threadCount)
+    {
+        if (threadCount <= 0)
+            throw invalid_argument("Thread count must be positive");
+
+        threadPool.reset();
+        if (threadCount > 1)
+            threadPool = make_unique<threading::ThreadPool>(threadCount);
+
+        extraWorkspaces.clear();
+        if (threadCount > 1)
+            extraWorkspaces.assign(threadCount - 1, Workspace(getLayerSizes()));
+    }
+
+    void NeuralNetwork::forwardSample(Workspace &workspace, const float *inputs, bool training) const
+    {
+        NN_PROFILE_SCOPE(Forward);
+        // Every layer writes the next one's activated values (bias, product
+        // and activation fused), so nothing needs clearing between samples.
+        // The output layer needs no derivatives: its delta is output - target.
+        const size_t outputIndex = workspace.getLayerCount() - 1;
+        auto derivativesOf = [&](size_t l)
+        { return training && l < outputIndex ? workspace.derivatives[l].data() : nullptr; };
+        auto logitsAt = [&](size_t l)
+        { return training && l == outputIndex; };
 
-        for (auto &node : inputLayer->nodes)
         {
-            float sum = 0.0f;
-            for (auto &edge : inputLayer->edges)
-            {
-                if (edge->sourceNode == node)
-                {
-                    sum += edge->weight * edge->targetNode->delta;
-                }
-            }
-            node->delta = sum;
+            NN_PROFILE_SCOPE(InputForward);
+            if (inputNormalizer)
+                inputNormalizer->normalize(inputs, 1, workspace.values[0].data());
+            else
+                copy(inputs, inputs + inputLayer->getNodeCount(), workspace.values[0].begin());
+            inputLayer->forward(workspace.values[0].data(), workspace.values[1].data(), derivativesOf(1),
+                                logitsAt(1));
         }
 
-        this->applyGradients(learningRate);
+        NN_PROFILE_SCOPE(HiddenForward);
+        for (size_t l = 0; l < hiddenLayers.size(); ++l)
+        {
+            hiddenLayers[l]->forward(workspace.values[l + 1].data(), workspace.values[l + 2].data(),
+                                     derivativesOf(l + 2), logitsAt(l + 2));
+        }
     }
 
-    void NeuralNetwork::captureDeltas(float loss)
+    void NeuralNetwork::backpropagateLayer(Workspace &workspace, size_t index, bool applyDerivative) const
     {
-        if (!trackDeltas)
-            return;
+        const kernels::KernelTable &k = kernels::active();
+        const memory::FloatSpan &values = workspace.values[index];
+        memory::FloatSpan &deltas = workspace.deltas[index];
+        const float *targetDeltas = workspace.deltas[index + 1].data();
+        const size_t targetCount = workspace.deltas[index + 1].size();
+        const float *row = weightsFrom(index).data();
+        float *gradientRow = workspace.weightGradients[index].data();
+
+        // Each weight row is read once for the delta while the matching
+        // gradient row accumulates this sample's contribution.
+        for (size_t i = 0; i < values.size(); ++i, row += targetCount, gradientRow += targetCount)
+        {
+            deltas[i] = k.dotAccumulate(row, targetDeltas, values[i], gradientRow, targetCount);
+        }
 
-        DeltaSnapshot snapshot;
-        snapshot.epoch = currentEpoch;
-        snapshot.sample = currentSample;
-        snapshot.loss = loss;
+        if (applyDerivative)
+            k.multiply(workspace.derivatives[index].data(), deltas.data(), deltas.size());
 
-        // Capture input layer deltas
-        for (const auto &node : inputLayer->nodes)
+        // Input biases never reach the forward pass, so they get no gradient.
+        if (index > 0)
+            k.axpy(1.0f, deltas.data(), workspace.biasGradients[index].data(), deltas.size());
+    }
+
+    float NeuralNetwork::backpropagate(Workspace &workspace, const float *expected) const
+    {
+        NN_PROFILE_SCOPE(Backpropagate);
+        const size_t outputIndex = workspace.getLayerCount() - 1;
+        memory::FloatSpan &outputs = workspace.values[outputIndex];
+        memory::FloatSpan &outputDeltas = workspace.deltas[outputIndex];
+
+        // The training forward pass left logits here: activate, score and
+        // take the output delta while each is in a register.
+        float loss;
         {
-            snapshot.inputDeltas.push_back(node->delta);
+            NN_PROFILE_SCOPE(Loss);
+            loss = kernels::withActivation(this->outputLayer->activation, [&](auto a)
+                                           { return scoreOutputs<decltype(a)::value>(
+                                                 outputs.data(), expected, outputs.size(), outputs.data(),
+                                                 outputDeltas.data()); });
         }
+        kernels::active().axpy(1.0f, outputDeltas.data(), workspace.biasGradients[outputIndex].data(),
+                               outputDeltas.size());
 
-        // Capture sample of input weights (first 5 edges)
-        int weightSample = inputLayer->edges.size();
-        for (int i = 0; i < weightSample; ++i)
+        // Hidden layers scale by the derivatives cached during the forward
+        // pass; the input layer has none.
+        for (size_t l = outputIndex; l-- > 0;)
         {
-            snapshot.inputWeights.push_back(inputLayer->edges[i]->weight);
+            this->backpropagateLayer(workspace, l, l > 0);
         }
+        return loss;
+    }
 
-        // Capture hidden layer deltas
-        for (const auto &hiddenLayer : hiddenLayers)
+    void NeuralNetwork::reduceGradients(size_t workerCount)
+    {
+        NN_PROFILE_SCOPE(ReduceGradients);
+        const kernels::KernelTable &k = kernels::active();
+        const size_t layerCount = hiddenLayers.size() + 2;
+
+        // Fixed worker order keeps the floating-point sums reproducible.
+        for (size_t w = 0; w < workerCount; ++w)
         {
-            vector<float> layerDeltas;
-            vector<float> layerWeights;
+            Workspace &worker = trainingWorkspace(w);
 
-            for (const auto &node : hiddenLayer->nodes)
+            for (size_t l = 0; l + 1 < layerCount; ++l)
             {
-                layerDeltas.push_back(node->delta);
+                ParameterBuffer &gradients = weightGradientsFrom(l);
+                k.axpy(1.0f, worker.weightGradients[l].data(), gradients.data(), gradients.size());
             }
 
-            // Sample weights
-            int hiddenWeightSample = hiddenLayer->edges.size();
-            for (int i = 0; i < hiddenWeightSample; ++i)
+            for (size_t l = 0; l < hiddenLayers.size(); ++l)
             {
-                layerWeights.push_back(hiddenLayer->edges[i]->weight);
+                k.axpy(1.0f, worker.biasGradients[l + 1].data(), hiddenLayers[l]->biasGradients.data(),
+                       hiddenLayers[l]->getNodeCount());
             }
+            k.axpy(1.0f, worker.biasGradients.back().data(), outputLayer->biasGradients.data(),
+                   outputLayer->getNodeCount());
 
-            snapshot.hiddenDeltas.push_back(layerDeltas);
-            snapshot.hiddenWeights.push_back(layerWeights);
+            worker.resetGradients();
         }
+    }
+
+    vector<optimization::ParameterGroup> NeuralNetwork::parameterGroups()
+    {
+        const size_t layerCount = hiddenLayers.size() + 2;
+        vector<optimization::ParameterGroup> groups;
+        groups.reserve(2 * layerCount - 2);
 
-        // Capture output layer deltas
-        for (const auto &node : outputLayer->nodes)
+        // Input biases are stored and saved but unused, so the optimizer
+        // never sees them.
+        for (size_t l = 0; l < layerCount; ++l)
         {
-            snapshot.outputDeltas.push_back(node->delta);
+            if (l + 1 < layerCount)
+            {
+                ParameterBuffer &weights = weightsFrom(l);
+                groups.push_back({weights.data(), weightGradientsFrom(l).data(), weights.size()});
+            }
+            if (l > 0)
+            {
+                Layer &layer = layerAt(l);
+                groups.push_back({layer.biases.data(), layer.biasGradients.data(), layer.getNodeCount()});
+            }
         }
-
-        deltaHistory.push_back(snapshot);
-        currentSample++;
+        return groups;
     }
 
-    void NeuralNetwork::resetNetwork()
+    void NeuralNetwork::applyGradients(const vector<optimization::ParameterGroup> &groups, float learningRate,
+                                       size_t batchCount)
     {
-        if (this->inputLayer)
-            this->inputLayer->resetValues();
+        if (batchCount == 0)
+            return;
+
+        NN_PROFILE_SCOPE(ApplyGradients);
+
+        // Gradients are summed over the batch; the optimizer applies their mean.
+        optimizer->step(groups, learningRate, 1.0f / static_cast<float>(batchCount));
 
-        for (auto &hiddenLayer : this->hiddenLayers)
+        const size_t layerCount = hiddenLayers.size() + 2;
+        if (!pruningMasks.empty())
         {
-            if (hiddenLayer)
-                hiddenLayer->resetValues();
+            const kernels::KernelTable &k = kernels::active();
+            for (size_t l = 0; l + 1 < layerCount; ++l)
+                k.multiply(pruningMasks[l].data(), weightsFrom(l).data(), pruningMasks[l].size());
         }
+        for (size_t l = 0; l < layerCount; ++l)
+        {
+            layerAt(l).resetGradients();
+            if (l + 1 < layerCount)
+            {
+                ParameterBuffer &gradients = weightGradientsFrom(l);
+                fill(gradients.begin(), gradients.end(), 0.0f);
+            }
+        }
+    }
+
+    void NeuralNetwork::setOptimizer(unique_ptr<optimization::Optimizer> optimizer)
+    {
+        this->optimizer = optimizer ? move(optimizer) : make_unique<optimization::Sgd>();
+    }
+
+    void NeuralNetwork::setLearningRateSchedule(unique_ptr<optimization::LearningRateSchedule> schedule)
+    {
+        this->schedule = move(schedule);
+    }
+
+    float NeuralNetwork::getLearningRate(float baseRate) const
+    {
+        return schedule ? schedule->rate(currentEpoch, baseRate) : baseRate;
+    }
 
-        if (this->outputLayer)
-            this->outputLayer->resetValues();
+    float NeuralNetwork::sampledWeight(size_t index) const
+    {
+        if (index > hiddenLayers.size())
+            return 0.0f;
+        const ParameterBuffer &weights = weightsFrom(index);
+        return weights.empty() ? 0.0f : weights[0];
+    }
+
+    void NeuralNetwork::resetNetwork()
+    {
+        for (auto &values : this->context.workspace.values)
+        {
+            fill(values.begin(), values.end(), 0.0f);
+        }
     }
 
     vector<float> NeuralNetwork::forward(const vector<float> &inputs)
     {
-        if (!this->inputLayer || !this->outputLayer)
+        if (inputs.size() != this->inputLayer->getNodeCount())
+            throw invalid_argument("Input size doesn't match layer size");
+
+        this->forwardSample(this->context.workspace, inputs.data());
+
+        const memory::FloatSpan &outputs = this->context.getOutputs();
+        return vector<float>(outputs.begin(), outputs.end());
+    }
+
+    void NeuralNetwork::forwardBatch(const float *inputs, size_t sampleCount, float *outputs)
+    {
+        this->forwardBatch(this->context, inputs, sampleCount, outputs);
+    }
+
+    InferenceContext NeuralNetwork::createInferenceContext() const
+    {
+        return InferenceContext(getLayerSizes());
+    }
+
+    void NeuralNetwork::forward(InferenceContext &context, const float *inputs, float *outputs) const
+    {
+        this->checkContext(context);
+        this->forwardSample(context.workspace, inputs);
+
+        const memory::FloatSpan &results = context.getOutputs();
+        copy(results.begin(), results.end(), outputs);
+    }
+
+    void NeuralNetwork::prepareBatchBuffers(InferenceContext &context) const
+    {
+        size_t maxHiddenSize = 0;
+        for (const auto &hiddenLayer : this->hiddenLayers)
+        {
+            maxHiddenSize = max(maxHiddenSize, hiddenLayer->getNodeCount());
+        }
+        for (auto &buffer : context.batchBuffers)
+        {
+            buffer.resize(batchChunkSize * maxHiddenSize);
+        }
+        if (this->inputNormalizer)
+            context.normalizedInputs.resize(batchChunkSize * this->getInputSize());
+    }
+
+    void NeuralNetwork::forwardChunk(InferenceContext &context, const float *inputs, size_t rowCount,
+                                     float *outputs, bool logits) const
+    {
+        const kernels::KernelTable &k = kernels::active();
+        const size_t outputSize = this->getOutputSize();
+
+        const float *sources = inputs;
+        if (this->inputNormalizer)
+        {
+            // Normalize one cache-resident chunk right before it is used.
+            this->inputNormalizer->normalize(sources, rowCount, context.normalizedInputs.data());
+            sources = context.normalizedInputs.data();
+        }
+        size_t sourceCount = this->getInputSize();
+        const float *weights = this->inputLayer->weights.data();
+
+        for (size_t l = 0; l < this->hiddenLayers.size(); ++l)
         {
-            throw runtime_error("Network not properly initialized");
+            const auto &hiddenLayer = this->hiddenLayers[l];
+            const size_t targetCount = hiddenLayer->getNodeCount();
+            float *targets = context.batchBuffers[l % 2].data();
+
+            k.denseBatch(sources, rowCount, sourceCount, weights, hiddenLayer->biases.data(), targetCount,
+                         hiddenLayer->activation, targets, nullptr);
+
+            sources = targets;
+            sourceCount = targetCount;
+            weights = hiddenLayer->weights.data();
         }
 
-        this->resetNetwork();
+        const kernels::Activation activation = logits ? kernels::Activation::Identity : this->outputLayer->activation;
+        k.denseBatch(sources, rowCount, sourceCount, weights, this->outputLayer->biases.data(), outputSize,
+                     activation, outputs, nullptr);
+    }
+
+    void NeuralNetwork::forwardBatch(InferenceContext &context, const float *inputs, size_t sampleCount,
+                                     float *outputs) const
+    {
+        this->checkContext(context);
 
-        this->inputLayer->setInputValues(inputs);
+        NN_PROFILE_SCOPE(ForwardBatch);
+        NN_PROFILE_COUNT(SamplesInferred, sampleCount);
 
-        this->inputLayer->forward();
+        const size_t inputSize = this->getInputSize();
+        const size_t outputSize = this->getOutputSize();
+        this->prepareBatchBuffers(context);
 
-        for (auto &hiddenLayer : this->hiddenLayers)
+        for (size_t start = 0; start < sampleCount; start += batchChunkSize)
         {
-            hiddenLayer->forward();
+            const size_t rowCount = min(batchChunkSize, sampleCount - start);
+            this->forwardChunk(context, inputs + start * inputSize, rowCount, outputs + start * outputSize, false);
         }
+    }
 
-        return outputLayer->getOutput();
+    Evaluation NeuralNetwork::evaluate(const datasets::Dataset &data, float margin, float *outputs)
+    {
+        return this->evaluate(this->context, data, margin, outputs);
+    }
+
+    Evaluation NeuralNetwork::evaluate(InferenceContext &context, const datasets::Dataset &data, float margin,
+                                       float *outputs) const
+    {
+        this->checkContext(context);
+        if (data.getFeatureCount() != static_cast<size_t>(this->getInputSize()) ||
+            data.getTargetCount() != static_cast<size_t>(this->getOutputSize()))
+            throw invalid_argument("Dataset shape doesn't match network");
+
+        Evaluation result;
+        result.sampleCount = data.size();
+        if (data.empty())
+            return result;
+
+        NN_PROFILE_SCOPE(ForwardBatch);
+        NN_PROFILE_COUNT(SamplesInferred, data.size());
+
+        const size_t inputSize = this->getInputSize();
+        const size_t outputSize = this->getOutputSize();
+        const float *inputs = data.featureMatrix().data;
+        const float *targets = data.targetMatrix().data;
+        this->prepareBatchBuffers(context);
+        context.logits.resize(batchChunkSize * outputSize);
+
+        double totalLoss = 0.0;
+        double totalError = 0.0;
+        for (size_t start = 0; start < data.size(); start += batchChunkSize)
+        {
+            const size_t rowCount = min(batchChunkSize, data.size() - start);
+            this->forwardChunk(context, inputs + start * inputSize, rowCount, context.logits.data(), true);
+
+            // Loss, error and margin from one read of each logit while the
+            // chunk is still in cache; without outputs they are activated in
+            // place.
+            const float *expected = targets + start * outputSize;
+            float *results = outputs ? outputs + start * outputSize : context.logits.data();
+            {
+                NN_PROFILE_SCOPE(Loss);
+                kernels::withActivation(this->outputLayer->activation, [&](auto a)
+                                        {
+                                            for (size_t r = 0; r < rowCount; ++r)
+                                            {
+                                                const size_t row = r * outputSize;
+                                                totalLoss += scoreOutputs<decltype(a)::value>(
+                                                    context.logits.data() + row, expected + row, outputSize,
+                                                    results + row, nullptr);
+                                            } });
+            }
+
+            for (size_t i = 0; i < rowCount * outputSize; ++i)
+            {
+                const float error = fabs(results[i] - expected[i]);
+                totalError += error;
+                if (error <= margin)
+                    ++result.withinMargin;
+            }
+        }
+
+        result.loss = totalLoss / data.size();
+        result.meanAbsoluteError = totalError / (data.size() * outputSize);
+        return result;
     }
 
     float NeuralNetwork::calculateLoss(const vector<float> &expected)
     {
-        if (expected.size() != this->outputLayer->nodes.size())
+        if (expected.size() != this->outputLayer->getNodeCount())
         {
             throw invalid_argument("Expected output size doesn't match network output size");
         }
 
+        return this->calculateLoss(this->context.getOutputs().data(), expected.data());
+    }
+
+    float NeuralNetwork::calculateLoss(const float *outputs, const float *expected) const
+    {
+        NN_PROFILE_SCOPE(Loss);
+        const size_t outputSize = this->getOutputSize();
         float totalLoss = 0.0f;
 
-        for (size_t i = 0; i < expected.size(); ++i)
+        // Keeps log() finite for outputs that rounded to exactly 0 or 1.
+        const float epsilon = 1e-7f;
+        switch (this->outputLayer->activation)
         {
-            float actual = this->outputLayer->nodes[i]->value;
+        case kernels::Activation::Sigmoid:
+            for (size_t i = 0; i < outputSize; ++i)
+            {
+                float actual = min(max(outputs[i], epsilon), 1.0f - epsilon);
 
-            totalLoss -= expected[i] * log(actual) + (1.0f - expected[i]) * log(1.0f - actual);
+                totalLoss -= expected[i] * log(actual) + (1.0f - expected[i]) * log(1.0f - actual);
+            }
+            return totalLoss / outputSize;
+        case kernels::Activation::Softmax:
+            for (size_t i = 0; i < outputSize; ++i)
+                totalLoss -= expected[i] * log(max(outputs[i], epsilon));
+            return totalLoss;
+        default:
+            for (size_t i = 0; i < outputSize; ++i)
+                totalLoss += 0.5f * (outputs[i] - expected[i]) * (outputs[i] - expected[i]);
+            return totalLoss / outputSize;
         }
+    }
 
-        return totalLoss / expected.size();
+    float NeuralNetwork::train(const datasets::Dataset &trainingData, int batchSize, float learningRate)
+    {
+        return this->train(trainingData.view(), batchSize, learningRate);
     }
 
-    void NeuralNetwork::train(vector<vector<float>> &trainingData, int batchSize)
+    NeuralNetwork::TrainingPass NeuralNetwork::beginPass(float learningRate)
     {
+        prepareGradients();
         currentSample = 0;
 
-        for (size_t i = 0; i < trainingData.size(); i += batchSize)
+        TrainingPass pass;
+        pass.groups = this->parameterGroups();
+        pass.rate = this->getLearningRate(learningRate);
+        pass.tracker = trackDeltas ? deltaTracker.get() : nullptr;
+        pass.workerLosses.assign(this->getThreadCount(), 0.0);
+        if (pass.tracker)
+            pass.tracker->prepare(this->getThreadCount());
+        return pass;
+    }
+
+    float NeuralNetwork::finishPass(const TrainingPass &pass) const
+    {
+        double totalLoss = 0.0;
+        for (double loss : pass.workerLosses)
+            totalLoss += loss;
+        return currentSample ? totalLoss / currentSample : 0.0f;
+    }
+
+    template <typename Samples>
+    void NeuralNetwork::trainBatch(TrainingPass &pass, const Samples &samples, size_t first, size_t count,
+                                   size_t batchIndex)
+    {
+        const size_t workerCount = min<size_t>(this->getThreadCount(), count);
+        // Position of `first` within the epoch, as the tracker numbers samples.
+        const size_t epochOffset = currentSample - first;
+
+        auto trainShard = [&](size_t w)
         {
-            size_t end = min(i + batchSize, trainingData.size());
+            Workspace &worker = this->trainingWorkspace(w);
+            const size_t shardBegin = first + count * w / workerCount;
+            const size_t shardEnd = first + count * (w + 1) / workerCount;
+            double shardLoss = 0.0;
 
-            for (size_t j = i; j < end; ++j)
+            for (size_t j = shardBegin; j < shardEnd; ++j)
             {
-                auto &row = trainingData[j];
-                vector<float> inputs(row.begin(), row.begin() + this->getInputSize());
-                vector<float> targets(row.begin() + this->getInputSize(), row.end());
+                const float *inputs = samples.featuresAt(j);
+                const float *targets = samples.targetsAt(j);
 
-                this->forward(inputs);
-                float loss = this->calculateLoss(targets);
-                this->backpropagate(targets, 0.001f);
+                this->forwardSample(worker, inputs, true);
+                const float loss = this->backpropagate(worker, targets);
+                shardLoss += loss;
 
                 // Capture deltas after backpropagation
-                captureDeltas(loss);
+                if (pass.tracker && pass.tracker->captures(epochOffset + j, batchIndex))
+                {
+                    NN_PROFILE_SCOPE(CaptureDeltas);
+                    NN_PROFILE_COUNT(DeltasCaptured, 1);
+                    pass.tracker->capture(w, epochOffset + j, loss, worker.deltas);
+                }
             }
+            pass.workerLosses[w] += shardLoss;
+        };
+
+        if (workerCount == 1)
+            trainShard(0);
+        else
+            threadPool->run(workerCount, trainShard);
+
+        this->reduceGradients(workerCount);
+
+        if (pass.tracker)
+        {
+            NN_PROFILE_SCOPE(CaptureDeltas);
+            pass.tracker->commit(workerCount, currentEpoch, currentSample, sampledWeight(0), sampledWeight(1));
         }
+        currentSample += count;
+
+        this->applyGradients(pass.groups, pass.rate, count);
+        NN_PROFILE_COUNT(SamplesTrained, count);
+        NN_PROFILE_COUNT(BatchesApplied, 1);
     }
 
-    void NeuralNetwork::exportDeltasToCSV(const string &filename)
+    float NeuralNetwork::train(const datasets::DatasetView &trainingData, int batchSize, float learningRate)
     {
-        ofstream file(filename);
-        if (!file.is_open())
+        if (batchSize <= 0)
+            throw invalid_argument("Batch size must be positive");
+
+        const datasets::Dataset &dataset = trainingData.getDataset();
+        if (!trainingData.empty() &&
+            (dataset.getFeatureCount() != (size_t)this->getInputSize() ||
+             dataset.getTargetCount() != (size_t)this->getOutputSize()))
+            throw invalid_argument("Training data shape doesn't match network input/output size");
+
+        TrainingPass pass;
+        // The epoch closes after the Train timer has recorded.
         {
-            throw runtime_error("Could not open file for delta export: " + filename);
+            NN_PROFILE_SCOPE(Train);
+            pass = this->beginPass(learningRate);
+
+            for (size_t i = 0; i < trainingData.size(); i += batchSize)
+            {
+                const size_t count = min<size_t>(batchSize, trainingData.size() - i);
+                this->trainBatch(pass, trainingData, i, count, i / batchSize);
+            }
         }
 
-        // Write header
-        file << "epoch,sample,loss,";
+        NN_PROFILE_CLOSE_EPOCH(currentEpoch);
+        return this->finishPass(pass);
+    }
+
+    float NeuralNetwork::train(datasets::BatchPipeline &pipeline, float learningRate)
+    {
+        if (pipeline.getFeatureCount() != (size_t)this->getInputSize() ||
+            pipeline.getTargetCount() != (size_t)this->getOutputSize())
+            throw invalid_argument("Training data shape doesn't match network input/output size");
+
+        TrainingPass pass;
+        {
+            NN_PROFILE_SCOPE(Train);
+            pass = this->beginPass(learningRate);
+
+            // The pipeline assembles the following batches while this one trains.
+            size_t batchIndex = 0;
+            while (const datasets::Batch *batch = pipeline.next())
+            {
+                this->trainBatch(pass, *batch, 0, batch->size(), batchIndex++);
+            }
+        }
+
+        NN_PROFILE_CLOSE_EPOCH(currentEpoch);
+        return this->finishPass(pass);
+    }
+
+    vector<shared_ptr<Node>> NeuralNetwork::getNodeView(size_t index) const
+    {
+        const Workspace &workspace = context.workspace;
+        if (index >= workspace.getLayerCount())
+            throw out_of_range("Layer index out of range");
+
+        const Layer &layer = layerAt(index);
+        vector<shared_ptr<Node>> view;
+        view.reserve(layer.getNodeCount());
 
-        // Input deltas
-        for (size_t i = 0; i < inputLayer->nodes.size(); ++i)
+        for (size_t i = 0; i < layer.getNodeCount(); ++i)
         {
-            file << "input_delta_" << i << ",";
+            auto node = make_shared<Node>(workspace.values[index][i], layer.biases[i]);
+            node->delta = workspace.deltas[index][i];
+            node->biasIndex = static_cast<int>(i);
+            view.push_back(node);
         }
+        return view;
+    }
+
+    vector<shared_ptr<Edge>> NeuralNetwork::getEdgeView(size_t index) const
+    {
+        if (index + 1 >= context.workspace.getLayerCount())
+            throw out_of_range("Layer has no outgoing edges");
+
+        vector<shared_ptr<Node>> sources = getNodeView(index);
+        vector<shared_ptr<Node>> targets = getNodeView(index + 1);
+        const ParameterBuffer &weights = weightsFrom(index);
+
+        vector<shared_ptr<Edge>> edges;
+        edges.reserve(weights.size());
 
-        // Hidden deltas
-        for (size_t layer = 0; layer < hiddenLayers.size(); ++layer)
+        for (size_t i = 0; i < sources.size(); ++i)
         {
-            for (size_t i = 0; i < hiddenLayers[layer]->nodes.size(); ++i)
+            for (size_t j = 0; j < targets.size(); ++j)
             {
-                file << "hidden" << layer << "_delta_" << i << ",";
+                size_t paramIndex = i * targets.size() + j;
+                auto edge = make_shared<Edge>(sources[i], targets[j], weights[paramIndex]);
+                edge->paramIndex = static_cast<int>(paramIndex);
+                edges.push_back(edge);
             }
         }
+        return edges;
+    }
 
-        // Output deltas
-        for (size_t i = 0; i < outputLayer->nodes.size(); ++i)
+    void NeuralNetwork::configureDeltaTracking(const tracking::TrackingOptions &options)
+    {
+        deltaTracker = make_unique<tracking::DeltaTracker>(getLayerSizes(), options);
+        trackDeltas = true;
+    }
+
+    void NeuralNetwork::enableDeltaTracking()
+    {
+        if (!deltaTracker)
+            deltaTracker = make_unique<tracking::DeltaTracker>(getLayerSizes());
+        trackDeltas = true;
+    }
+
+    void NeuralNetwork::setDeltaSink(unique_ptr<tracking::DeltaSink> sink)
+    {
+        if (!deltaTracker)
+            deltaTracker = make_unique<tracking::DeltaTracker>(getLayerSizes());
+        deltaTracker->setSink(move(sink));
+    }
+
+    void NeuralNetwork::flushDeltas()
+    {
+        if (deltaTracker)
+            deltaTracker->flush();
+    }
+
+    void NeuralNetwork::clearDeltaHistory()
+    {
+        if (deltaTracker)
+            deltaTracker->clear();
+    }
+
+    void NeuralNetwork::exportDeltasToCSV(const string &filename)
+    {
+        tracking::DeltaLayout layout = {getLayerSizes(), tracking::TrackingMode::Samples};
+        if (deltaTracker)
+            layout = deltaTracker->getLayout();
+
+        tracking::CsvDeltaSink sink(filename);
+        sink.begin(layout);
+
+        size_t recordCount = 0;
+        if (deltaTracker)
         {
-            file << "output_delta_" << i << ",";
+            deltaTracker->forEach([&](const tracking::DeltaRecord &record, const float *values)
+                                  {
+                                      sink.write(&record, values, 1);
+                                      ++recordCount; });
         }
 
-        // Sample weights
-        file << "input_weight_0,hidden0_weight_0";
-        file << "\n";
+        sink.finish();
+        printf("Deltas exported to %s (%zu snapshots)\n", filename.c_str(), recordCount);
+    }
 
-        // Write data
-        for (const auto &snapshot : deltaHistory)
+    void NeuralNetwork::save(const string &path) const
+    {
+        vector<unsigned char> image;
+        saveImage(image);
+        model_io::writeModelFile(path, image);
+    }
+
+    void NeuralNetwork::saveImage(vector<unsigned char> &image) const
+    {
+        const vector<size_t> layerSizes = getLayerSizes();
+        model_io::InputStage inputStage = model_io::InputStage::None;
+        if (inputNormalizer)
+            inputStage = inputNormalizer->isClamped() ? model_io::InputStage::AffineClamped
+                                                      : model_io::InputStage::Affine;
+        const model_io::ModelLayout layout = model_io::computeLayout(layerSizes, inputStage);
+
+        image.assign(layout.fileSize, 0);
+
+        model_io::FileHeader header;
+        memcpy(header.magic, model_io::modelMagic, sizeof(header.magic));
+        header.version = model_io::modelVersion;
+        header.endianTag = model_io::endianTag;
+        header.layerCount = layerSizes.size();
+        header.floatSize = sizeof(float);
+        header.fileSize = layout.fileSize;
+        memcpy(image.data(), &header, sizeof(header));
+
+        for (size_t l = 0; l < layerSizes.size(); ++l)
         {
-            // Write leading columns
-            file << snapshot.epoch << "," << snapshot.sample << "," << snapshot.loss;
+            uint32_t size = layerSizes[l];
+            memcpy(image.data() + sizeof(header) + l * sizeof(size), &size, sizeof(size));
 
-            // Input deltas (add a leading comma for the first item)
-            for (float delta : snapshot.inputDeltas)
-            {
-                file << "," << delta;
-            }
+            const ParameterBuffer &biases = layerAt(l).biases;
+            memcpy(image.data() + layout.biases[l].offset, biases.data(), biases.size() * sizeof(float));
 
-            // Hidden deltas (add a leading comma for the first item)
-            for (const auto &layerDeltas : snapshot.hiddenDeltas)
+            if (l + 1 < layerSizes.size())
             {
-                for (float delta : layerDeltas)
-                {
-                    file << "," << delta;
-                }
+                const ParameterBuffer &weights = weightsFrom(l);
+                memcpy(image.data() + layout.weights[l].offset, weights.data(), weights.size() * sizeof(float));
             }
+        }
 
-            // Output deltas (add a leading comma for the first item)
-            for (float delta : snapshot.outputDeltas)
-            {
-                file << "," << delta;
-            }
+        const uint32_t stage = static_cast<uint32_t>(inputStage);
+        unsigned char *words = image.data() + sizeof(header) + layerSizes.size() * sizeof(uint32_t);
+        memcpy(words, &stage, sizeof(stage));
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            const uint32_t activation = static_cast<uint32_t>(layerAt(l).activation);
+            memcpy(words + (l + 1) * sizeof(activation), &activation, sizeof(activation));
+        }
+        if (inputNormalizer)
+        {
+            const vector<float> &offsets = inputNormalizer->getOffsets();
+            const vector<float> &scales = inputNormalizer->getScales();
+            memcpy(image.data() + layout.inputOffsets.offset, offsets.data(), offsets.size() * sizeof(float));
+            memcpy(image.data() + layout.inputScales.offset, scales.data(), scales.size() * sizeof(float));
+        }
+    }
 
-            // Sample weights (add a leading comma for the first item)
-            if (!snapshot.inputWeights.empty())
-                file << "," << snapshot.inputWeights[0];
+    shared_ptr<NeuralNetwork> NeuralNetwork::load(const string &path, LoadMode mode)
+    {
+        auto file = make_shared<io::MappedFile>(path);
+        const model_io::ModelTopology topology = model_io::readTopology(*file);
+        const vector<size_t> &layerSizes = topology.layerSizes;
+        const model_io::ModelLayout layout = model_io::computeLayout(layerSizes, topology.inputStage,
+                                                                     topology.version);
+
+        // Only the layer skeleton is built: parameters are bound to the file
+        // (or one parameter-only arena) below, and gradients wait for the
+        // first train().
+        shared_ptr<NeuralNetwork> network(new NeuralNetwork(layerSizes, false));
+        shared_ptr<memory::Arena> parameters;
+        if (mode == LoadMode::Copy)
+            parameters = make_shared<memory::Arena>(arenaSize(layerSizes, 1));
+
+        // Blob offsets are 64-byte aligned and mmap returns page-aligned
+        // memory, so the casts below are correctly aligned.
+        auto bind = [&](ParameterBuffer &buffer, const model_io::BlobRange &blob)
+        {
+            float *source = reinterpret_cast<float *>(file->data() + blob.offset);
+            if (mode == LoadMode::Map)
+                buffer.alias(source, blob.count, file);
             else
-                file << ",0"; // Note: Comma is now before the value
+            {
+                buffer.alias(parameters->allocate(blob.count), blob.count, parameters);
+                copy(source, source + blob.count, buffer.begin());
+            }
+        };
 
-            // Second sample weight (add a leading comma for the second item)
-            if (!snapshot.hiddenWeights.empty() && !snapshot.hiddenWeights[0].empty())
-                file << "," << snapshot.hiddenWeights[0][0];
-            else
-                file << ",0"; // Note: Comma is now before the value
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            if (l > 0)
+                network->setActivation(l, topology.activations[l]);
+            bind(network->layerAt(l).biases, layout.biases[l]);
+            if (l + 1 < layerSizes.size())
+                bind(network->weightsFrom(l), layout.weights[l]);
+        }
 
-            file << "\n";
+        // The input stage is tiny, so it is always copied.
+        if (topology.inputStage != model_io::InputStage::None)
+        {
+            const float *offsets = reinterpret_cast<const float *>(file->data() + layout.inputOffsets.offset);
+            const float *scales = reinterpret_cast<const float *>(file->data() + layout.inputScales.offset);
+            network->setInputNormalizer(Normalizer(vector<float>(offsets, offsets + layout.inputOffsets.count),
+                                                   vector<float>(scales, scales + layout.inputScales.count),
+                                                   topology.inputStage == model_io::InputStage::AffineClamped));
         }
 
-        file.close();
-        printf("Deltas exported to %s (%zu snapshots)\n", filename.c_str(), deltaHistory.size());
+        return network;
+    }
+
+    float scoreLogits(kernels::Activation activation, const float *logits, const float *expected, size_t n,
+                      float *outputs, float *deltas)
+    {
+        return kernels::withActivation(activation, [&](auto a)
+                                       { return scoreOutputs<decltype(a)::value>(logits, expected, n, outputs,
+                                                                                 deltas); });
     }
-}
\ No newline at end of file
+}
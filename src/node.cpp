@@ -12,6 +12,7 @@ namespace nodes
         this->sourceNode = sourceNode;
         this->targetNode = targetNode;
         this->weight = weight;
+        this->paramIndex = -1;
     }
 
     Node::Node()
@@ -19,6 +20,7 @@ namespace nodes
         this->value = 0.0f;
         this->bias = 0.0f;
         this->delta = 0.0f;
+        this->biasIndex = -1;
     }
 
     Node::Node(float value, float bias)
@@ -26,27 +28,27 @@ namespace nodes
         this->value = value;
         this->bias = bias;
         this->delta = 0.0f;
+        this->biasIndex = -1;
     }
 
     void Node::sigmoid()
     {
-        this->value = 1.0f / (1.0f + exp(-this->value));
+        this->value = nodes::sigmoid(this->value);
     }
 
     float Node::sigmoidDerivative()
     {
-        float s = this->value;
-        return s * (1 - s);
+        return nodes::sigmoidDerivative(this->value);
     }
 
     void Node::relu()
     {
-        this->value = (this->value > 0.0f) ? this->value : 0.01f * this->value;
+        this->value = nodes::relu(this->value);
     }
 
     float Node::reluDerivative()
     {
-        return (this->value > 0.0f) ? 1.0f : 0.01f;
+        return nodes::reluDerivative(this->value);
     }
 
     void Node::addBias()
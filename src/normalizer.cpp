@@ -1,28 +1,117 @@
 #include "normalizer.hpp"
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
-#include <cstdio>
-#include <sstream>
-#include <array>
 
 using namespace std;
 
-Normalizer::Normalizer(const vector<float> maxValues)
+Normalizer::Normalizer(const vector<float> &maxValues) : offsets(maxValues.size(), 0.0f), clampToUnit(true)
 {
-    this->maxValues = maxValues;
+    scales.reserve(maxValues.size());
+    for (float maxValue : maxValues)
+    {
+        if (maxValue == 0.0f || !isfinite(maxValue))
+            throw invalid_argument("Normalizer maximum values must be finite and non-zero");
+        scales.push_back(1.0f / maxValue);
+    }
 }
 
-vector<float> Normalizer::normalize(vector<float> &features) const
+Normalizer::Normalizer(const vector<float> &offsets, const vector<float> &scales, bool clampToUnit)
+    : offsets(offsets), scales(scales), clampToUnit(clampToUnit)
 {
-    vector<float> normalized(features.size());
+    if (offsets.size() != scales.size())
+        throw invalid_argument("Normalizer needs one offset and one scale per feature");
+}
+
+Normalizer Normalizer::fitMinMax(const datasets::Dataset &data)
+{
+    if (data.empty())
+        throw invalid_argument("Cannot fit a normalizer to an empty dataset");
+
+    const size_t featureCount = data.getFeatureCount();
+    const datasets::MatrixView features = data.featureMatrix();
+    vector<float> low(features.row(0), features.row(0) + featureCount);
+    vector<float> high = low;
 
-    for (size_t i = 0; i < features.size(); ++i)
+    for (size_t r = 1; r < features.rows; ++r)
     {
-        float actual = features[i];
-        float maxVal = maxValues[i];
+        const float *row = features.row(r);
+        for (size_t f = 0; f < featureCount; ++f)
+        {
+            low[f] = min(low[f], row[f]);
+            high[f] = max(high[f], row[f]);
+        }
+    }
+
+    // A constant feature maps to 0.
+    vector<float> scales(featureCount);
+    for (size_t f = 0; f < featureCount; ++f)
+        scales[f] = high[f] > low[f] ? 1.0f / (high[f] - low[f]) : 1.0f;
+    return Normalizer(low, scales, true);
+}
 
-        float normalizedValue = min(max(actual / maxVal, 0.0f), 1.0f);
+Normalizer Normalizer::fitStandard(const datasets::Dataset &data)
+{
+    if (data.empty())
+        throw invalid_argument("Cannot fit a normalizer to an empty dataset");
+
+    const size_t featureCount = data.getFeatureCount();
+    const datasets::MatrixView features = data.featureMatrix();
+    vector<double> sums(featureCount, 0.0);
+    vector<double> squares(featureCount, 0.0);
+
+    for (size_t r = 0; r < features.rows; ++r)
+    {
+        const float *row = features.row(r);
+        for (size_t f = 0; f < featureCount; ++f)
+        {
+            sums[f] += row[f];
+            squares[f] += static_cast<double>(row[f]) * row[f];
+        }
+    }
 
-        normalized[i] = normalizedValue;
+    vector<float> means(featureCount);
+    vector<float> scales(featureCount);
+    for (size_t f = 0; f < featureCount; ++f)
+    {
+        const double mean = sums[f] / features.rows;
+        const double variance = max(0.0, squares[f] / features.rows - mean * mean);
+        means[f] = static_cast<float>(mean);
+        scales[f] = variance > 0.0 ? static_cast<float>(1.0 / sqrt(variance)) : 1.0f;
     }
+    return Normalizer(means, scales, false);
+}
+
+vector<float> Normalizer::normalize(const vector<float> &features) const
+{
+    if (features.size() != offsets.size())
+        throw invalid_argument("Feature count doesn't match normalizer");
+
+    vector<float> normalized(features.size());
+    normalize(features.data(), 1, normalized.data());
     return normalized;
 }
+
+void Normalizer::normalize(const float *inputs, size_t rowCount, float *outputs) const
+{
+    const size_t featureCount = offsets.size();
+    const float *offset = offsets.data();
+    const float *scale = scales.data();
+
+    for (size_t r = 0; r < rowCount; ++r)
+    {
+        const float *source = inputs + r * featureCount;
+        float *target = outputs + r * featureCount;
+
+        if (clampToUnit)
+        {
+            for (size_t f = 0; f < featureCount; ++f)
+                target[f] = min(max((source[f] - offset[f]) * scale[f], 0.0f), 1.0f);
+        }
+        else
+        {
+            for (size_t f = 0; f < featureCount; ++f)
+                target[f] = (source[f] - offset[f]) * scale[f];
+        }
+    }
+}
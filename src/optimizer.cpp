@@ -0,0 +1,218 @@
+#include "optimizer.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace optimization
+{
+    void Optimizer::prepareState(const vector<ParameterGroup> &groups, size_t buffers)
+    {
+        if (!state.empty())
+        {
+            if (state.size() != groups.size())
+                throw invalid_argument("Optimizer parameter groups changed between steps");
+            for (size_t g = 0; g < groups.size(); ++g)
+            {
+                if (state[g].size() < buffers || (!state[g].empty() && state[g].front().size() != groups[g].count))
+                    throw invalid_argument("Optimizer parameter groups changed between steps");
+            }
+            return;
+        }
+
+        size_t total = 0;
+        for (const ParameterGroup &group : groups)
+            total += buffers * memory::Arena::paddedSize(group.count);
+
+        arena = make_unique<memory::Arena>(total);
+        state.resize(groups.size());
+        // Buffer-major order keeps e.g. all first moments of a group next
+        // to each other.
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            for (size_t b = 0; b < buffers; ++b)
+                state[g].emplace_back(arena->allocate(groups[g].count), groups[g].count);
+        }
+    }
+
+    void Optimizer::reset()
+    {
+        state.clear();
+        arena.reset();
+        stepCount = 0;
+    }
+
+    void Optimizer::saveState(vector<float> &values) const
+    {
+        for (const vector<memory::FloatSpan> &buffers : state)
+        {
+            for (const memory::FloatSpan &buffer : buffers)
+                values.insert(values.end(), buffer.data(), buffer.data() + buffer.size());
+        }
+    }
+
+    void Optimizer::loadState(const vector<ParameterGroup> &groups, const vector<float> &values, long stepCount)
+    {
+        reset();
+        this->stepCount = stepCount;
+        if (values.empty())
+            return;
+
+        size_t parameterCount = 0;
+        for (const ParameterGroup &group : groups)
+            parameterCount += group.count;
+        if (parameterCount == 0 || values.size() % parameterCount != 0)
+            throw invalid_argument("Optimizer state doesn't match the parameter groups");
+
+        prepareState(groups, values.size() / parameterCount);
+        const float *source = values.data();
+        for (vector<memory::FloatSpan> &buffers : state)
+        {
+            for (memory::FloatSpan &buffer : buffers)
+            {
+                copy(source, source + buffer.size(), buffer.data());
+                source += buffer.size();
+            }
+        }
+    }
+
+    Sgd::Sgd(float momentum, bool nesterov, float weightDecay)
+        : momentum(momentum), nesterov(nesterov), weightDecay(weightDecay)
+    {
+        if (momentum < 0.0f || momentum >= 1.0f)
+            throw invalid_argument("Momentum must be in [0, 1)");
+        if (nesterov && momentum == 0.0f)
+            throw invalid_argument("Nesterov momentum needs a positive momentum");
+    }
+
+    void Sgd::step(const vector<ParameterGroup> &groups, float learningRate, float gradientScale)
+    {
+        ++stepCount;
+
+        if (momentum == 0.0f && weightDecay == 0.0f)
+        {
+            // Stateless path: one fused axpy per group.
+            const kernels::KernelTable &k = kernels::active();
+            for (const ParameterGroup &group : groups)
+                k.axpy(-learningRate * gradientScale, group.gradients, group.values, group.count);
+            return;
+        }
+
+        prepareState(groups, momentum > 0.0f ? 1 : 0);
+
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            const ParameterGroup &group = groups[g];
+            float *velocity = momentum > 0.0f ? state[g][0].data() : nullptr;
+
+            for (size_t i = 0; i < group.count; ++i)
+            {
+                float gradient = group.gradients[i] * gradientScale + weightDecay * group.values[i];
+                if (velocity)
+                {
+                    velocity[i] = momentum * velocity[i] + gradient;
+                    gradient = nesterov ? gradient + momentum * velocity[i] : velocity[i];
+                }
+                group.values[i] -= learningRate * gradient;
+            }
+        }
+    }
+
+    const char *Sgd::getName() const
+    {
+        if (momentum == 0.0f)
+            return "sgd";
+        return nesterov ? "nesterov" : "momentum";
+    }
+
+    Adam::Adam(float beta1, float beta2, float epsilon, float weightDecay, bool decoupledWeightDecay)
+        : beta1(beta1), beta2(beta2), epsilon(epsilon), weightDecay(weightDecay),
+          decoupledWeightDecay(decoupledWeightDecay)
+    {
+        if (beta1 < 0.0f || beta1 >= 1.0f || beta2 < 0.0f || beta2 >= 1.0f)
+            throw invalid_argument("Adam betas must be in [0, 1)");
+        if (epsilon <= 0.0f)
+            throw invalid_argument("Adam epsilon must be positive");
+    }
+
+    void Adam::step(const vector<ParameterGroup> &groups, float learningRate, float gradientScale)
+    {
+        prepareState(groups, 2);
+        ++stepCount;
+
+        // Bias corrections folded into the step size and epsilon.
+        const float correction1 = 1.0f - pow(beta1, static_cast<float>(stepCount));
+        const float correction2 = 1.0f - pow(beta2, static_cast<float>(stepCount));
+        const float stepSize = learningRate * sqrt(correction2) / correction1;
+        const float scaledEpsilon = epsilon * sqrt(correction2);
+        const float coupledDecay = decoupledWeightDecay ? 0.0f : weightDecay;
+        const float decoupledFactor = decoupledWeightDecay ? 1.0f - learningRate * weightDecay : 1.0f;
+
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            const ParameterGroup &group = groups[g];
+            float *first = state[g][0].data();
+            float *second = state[g][1].data();
+
+            for (size_t i = 0; i < group.count; ++i)
+            {
+                const float gradient = group.gradients[i] * gradientScale + coupledDecay * group.values[i];
+                first[i] = beta1 * first[i] + (1.0f - beta1) * gradient;
+                second[i] = beta2 * second[i] + (1.0f - beta2) * gradient * gradient;
+                group.values[i] = group.values[i] * decoupledFactor -
+                                  stepSize * first[i] / (sqrt(second[i]) + scaledEpsilon);
+            }
+        }
+    }
+
+    const char *Adam::getName() const
+    {
+        return decoupledWeightDecay ? "adamw" : "adam";
+    }
+
+    unique_ptr<Optimizer> makeAdamW(float weightDecay, float beta1, float beta2)
+    {
+        return make_unique<Adam>(beta1, beta2, 1e-8f, weightDecay, true);
+    }
+
+    StepSchedule::StepSchedule(int stepSize, float gamma) : stepSize(stepSize), gamma(gamma)
+    {
+        if (stepSize <= 0)
+            throw invalid_argument("Step size must be positive");
+    }
+
+    float StepSchedule::rate(int epoch, float baseRate) const
+    {
+        return baseRate * pow(gamma, static_cast<float>(max(0, epoch) / stepSize));
+    }
+
+    CosineSchedule::CosineSchedule(int totalEpochs, float minimumRate)
+        : totalEpochs(totalEpochs), minimumRate(minimumRate)
+    {
+        if (totalEpochs <= 0)
+            throw invalid_argument("Total epochs must be positive");
+    }
+
+    float CosineSchedule::rate(int epoch, float baseRate) const
+    {
+        const float progress = min(1.0f, max(0.0f, static_cast<float>(epoch) / totalEpochs));
+        const float pi = 3.14159265358979f;
+        return minimumRate + 0.5f * (baseRate - minimumRate) * (1.0f + cos(pi * progress));
+    }
+
+    WarmupSchedule::WarmupSchedule(int warmupEpochs, unique_ptr<LearningRateSchedule> after)
+        : warmupEpochs(warmupEpochs), after(move(after))
+    {
+        if (warmupEpochs < 0)
+            throw invalid_argument("Warmup epochs must not be negative");
+    }
+
+    float WarmupSchedule::rate(int epoch, float baseRate) const
+    {
+        if (epoch < warmupEpochs)
+            return baseRate * static_cast<float>(epoch + 1) / (warmupEpochs + 1);
+        return after ? after->rate(epoch - warmupEpochs, baseRate) : baseRate;
+    }
+}
@@ -0,0 +1,157 @@
+#include "quantized_network.hpp"
+#include "half_float.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace neural_network
+{
+    namespace
+    {
+        // Samples per block in forwardBatch(); bounds the scratch size.
+        const size_t blockRows = 256;
+    }
+
+    const char *precisionName(Precision precision)
+    {
+        switch (precision)
+        {
+        case Precision::Int8:
+            return "int8";
+        case Precision::Float16:
+            return "fp16";
+        default:
+            return "bf16";
+        }
+    }
+
+    QuantizedNetwork::QuantizedNetwork(const NeuralNetwork &network, Precision precision)
+        : InferenceCopy(network), precision(precision)
+    {
+        const vector<size_t> sizes = network.getLayerSizes();
+        if (sizes.size() < 2)
+            throw invalid_argument("Network has no layers to quantize");
+
+        for (size_t l = 0; l + 1 < sizes.size(); ++l)
+        {
+            const ParameterBuffer &weights = network.getWeights(l);
+            const ParameterBuffer &biases = network.getBiases(l + 1);
+
+            QuantizedLayer layer;
+            layer.sourceCount = sizes[l];
+            layer.targetCount = sizes[l + 1];
+            layer.activation = network.getActivation(l + 1);
+            layer.biases.assign(biases.begin(), biases.end());
+
+            if (precision == Precision::Int8)
+            {
+                // The range always includes zero so zero weights stay exact.
+                const auto range = minmax_element(weights.begin(), weights.end());
+                const float low = min(0.0f, *range.first);
+                const float high = max(0.0f, *range.second);
+                layer.scale = high > low ? (high - low) / 255.0f : 1.0f;
+                layer.zeroPoint = static_cast<int32_t>(lround(-128.0f - low / layer.scale));
+                layer.zeroPoint = max(-128, min(127, layer.zeroPoint));
+
+                layer.int8Weights.reserve(weights.size() + kernels::reducedPadding);
+                for (float w : weights)
+                {
+                    long q = lround(w / layer.scale) + layer.zeroPoint;
+                    layer.int8Weights.push_back(static_cast<int8_t>(max(-128L, min(127L, q))));
+                }
+                layer.int8Weights.resize(weights.size() + kernels::reducedPadding, 0);
+            }
+            else
+            {
+                layer.halfWeights.reserve(weights.size() + kernels::reducedPadding);
+                for (float w : weights)
+                    layer.halfWeights.push_back(precision == Precision::Float16 ? numeric::floatToHalf(w)
+                                                                                : numeric::floatToBFloat16(w));
+                layer.halfWeights.resize(weights.size() + kernels::reducedPadding, 0);
+            }
+
+            maxWidth = max(maxWidth, layer.targetCount);
+            layers.push_back(move(layer));
+        }
+    }
+
+    kernels::ReducedWeights QuantizedNetwork::QuantizedLayer::weights(Precision precision) const
+    {
+        const void *data = precision == Precision::Int8 ? static_cast<const void *>(int8Weights.data())
+                                                        : static_cast<const void *>(halfWeights.data());
+        return {data, precision, scale, zeroPoint};
+    }
+
+    void QuantizedNetwork::forward(const float *inputs, float *outputs) const
+    {
+        this->forwardBatch(inputs, 1, outputs);
+    }
+
+    void QuantizedNetwork::forwardBatch(const float *inputs, size_t sampleCount, float *outputs) const
+    {
+        const kernels::KernelTable &k = kernels::active();
+        const size_t inputSize = getInputSize();
+        const size_t outputSize = getOutputSize();
+        const size_t rows = min(sampleCount, blockRows);
+        vector<float> scratch(2 * rows * maxWidth);
+        vector<float> normalized(normalizeScratchSize(rows, inputSize));
+
+        for (size_t first = 0; first < sampleCount; first += blockRows)
+        {
+            const size_t count = min(blockRows, sampleCount - first);
+            const float *sources = normalizeInputs(inputs + first * inputSize, count, normalized.data());
+            for (size_t l = 0; l < layers.size(); ++l)
+            {
+                const QuantizedLayer &layer = layers[l];
+                float *targets = (l + 1 == layers.size()) ? outputs + first * outputSize
+                                                          : scratch.data() + (l % 2) * rows * maxWidth;
+                k.denseReduced(sources, count, layer.sourceCount, layer.weights(precision), layer.biases.data(),
+                               layer.targetCount, layer.activation, targets);
+                sources = targets;
+            }
+        }
+    }
+
+    vector<size_t> QuantizedNetwork::getLayerSizes() const
+    {
+        vector<size_t> sizes = {layers.front().sourceCount};
+        for (const QuantizedLayer &layer : layers)
+            sizes.push_back(layer.targetCount);
+        return sizes;
+    }
+
+    size_t QuantizedNetwork::getParameterBytes() const
+    {
+        size_t bytes = 0;
+        for (const QuantizedLayer &layer : layers)
+        {
+            const size_t weightBytes = precision == Precision::Int8 ? sizeof(int8_t) : sizeof(uint16_t);
+            bytes += layer.sourceCount * layer.targetCount * weightBytes + layer.biases.size() * sizeof(float);
+            if (precision == Precision::Int8)
+                bytes += sizeof(layer.scale) + sizeof(layer.zeroPoint);
+        }
+        return bytes;
+    }
+
+    QuantizationReport compareAccuracy(const NeuralNetwork &reference, const QuantizedNetwork &quantized,
+                                       const datasets::Dataset &data)
+    {
+        const CopyDrift drift = measureDrift(reference, quantized.getLayerSizes(),
+                                             [&](const float *inputs, size_t count, float *outputs)
+                                             { quantized.forwardBatch(inputs, count, outputs); },
+                                             data);
+
+        QuantizationReport report;
+        report.precision = quantized.getPrecision();
+        report.sampleCount = drift.sampleCount;
+        report.maxAbsoluteError = drift.maxAbsoluteError;
+        report.meanAbsoluteError = drift.meanAbsoluteError;
+        report.floatLoss = drift.referenceLoss;
+        report.quantizedLoss = drift.copyLoss;
+        report.floatBytes = reference.getParameters().size() * sizeof(float);
+        report.quantizedBytes = quantized.getParameterBytes();
+        return report;
+    }
+}
@@ -0,0 +1,301 @@
+#include "sparse_network.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace neural_network
+{
+    namespace
+    {
+        const size_t laneCount = kernels::sparseLanes;
+    }
+
+    float magnitudeThreshold(const float *weights, size_t n, float sparsity)
+    {
+        if (sparsity < 0.0f || sparsity > 1.0f)
+            throw invalid_argument("Sparsity must be in [0, 1]");
+
+        const size_t pruned = static_cast<size_t>(sparsity * n);
+        if (pruned == 0)
+            return -1.0f;
+
+        vector<float> magnitudes(n);
+        for (size_t i = 0; i < n; ++i)
+            magnitudes[i] = fabs(weights[i]);
+        nth_element(magnitudes.begin(), magnitudes.begin() + (pruned - 1), magnitudes.end());
+        return magnitudes[pruned - 1];
+    }
+
+    SparseNetwork::SparseNetwork(const NeuralNetwork &network, float sparsity) : InferenceCopy(network)
+    {
+        const vector<size_t> sizes = network.getLayerSizes();
+        if (sizes.size() < 2)
+            throw invalid_argument("Network has no layers to convert");
+        maxWidth = sizes.front();
+
+        for (size_t l = 0; l + 1 < sizes.size(); ++l)
+        {
+            const ParameterBuffer &weights = network.getWeights(l);
+            const ParameterBuffer &biases = network.getBiases(l + 1);
+            const float threshold = magnitudeThreshold(weights.data(), weights.size(), sparsity);
+
+            SparseLayer layer;
+            layer.sourceCount = sizes[l];
+            layer.targetCount = sizes[l + 1];
+            layer.activation = network.getActivation(l + 1);
+            layer.biases.assign(biases.begin(), biases.end());
+
+            layer.rowOffsets.reserve(layer.sourceCount + 1);
+            layer.rowOffsets.push_back(0);
+            for (size_t i = 0; i < layer.sourceCount; ++i)
+            {
+                const float *row = weights.data() + i * layer.targetCount;
+                for (size_t j = 0; j < layer.targetCount; ++j)
+                {
+                    if (row[j] != 0.0f && fabs(row[j]) > threshold)
+                    {
+                        layer.targets.push_back(j);
+                        layer.weights.push_back(row[j]);
+                    }
+                }
+                layer.rowOffsets.push_back(layer.weights.size());
+            }
+
+            maxWidth = max(maxWidth, layer.targetCount);
+            layers.push_back(move(layer));
+        }
+    }
+
+    void SparseNetwork::forward(const float *inputs, float *outputs) const
+    {
+        this->forwardBatch(inputs, 1, outputs);
+    }
+
+    void SparseNetwork::loadLanes(const float *inputs, size_t count, float *rowScratch, float *lanes) const
+    {
+        const size_t inputSize = getInputSize();
+        inputs = normalizeInputs(inputs, count, rowScratch);
+        for (size_t i = 0; i < inputSize; ++i)
+        {
+            for (size_t r = 0; r < laneCount; ++r)
+                lanes[i * laneCount + r] = r < count ? inputs[r * inputSize + i] : 0.0f;
+        }
+    }
+
+    void SparseNetwork::forwardBatch(const float *inputs, size_t sampleCount, float *outputs) const
+    {
+        const kernels::KernelTable &k = kernels::active();
+        const size_t inputSize = getInputSize();
+        const size_t outputSize = getOutputSize();
+        vector<float> rowScratch(normalizeScratchSize(laneCount, inputSize));
+        vector<float> scratch(2 * maxWidth * laneCount);
+
+        for (size_t first = 0; first < sampleCount; first += laneCount)
+        {
+            const size_t count = min(laneCount, sampleCount - first);
+            float *sources = scratch.data();
+            loadLanes(inputs + first * inputSize, count, rowScratch.data(), sources);
+
+            for (size_t l = 0; l < layers.size(); ++l)
+            {
+                const SparseLayer &layer = layers[l];
+                float *targets = scratch.data() + ((l + 1) % 2) * maxWidth * laneCount;
+                k.sparseForward(sources, layer.sourceCount, layer.view(), layer.biases.data(), layer.targetCount,
+                                layer.activation, targets, nullptr);
+                sources = targets;
+            }
+
+            for (size_t r = 0; r < count; ++r)
+            {
+                float *row = outputs + (first + r) * outputSize;
+                for (size_t j = 0; j < outputSize; ++j)
+                    row[j] = sources[j * laneCount + r];
+            }
+        }
+    }
+
+    float SparseNetwork::train(const datasets::Dataset &data, int batchSize, float learningRate)
+    {
+        if (batchSize < 1)
+            throw invalid_argument("Batch size must be positive");
+        if (data.getFeatureCount() != static_cast<size_t>(getInputSize()) ||
+            data.getTargetCount() != static_cast<size_t>(getOutputSize()))
+            throw invalid_argument("Dataset shape doesn't match network");
+
+        const kernels::KernelTable &k = kernels::active();
+        const size_t inputSize = getInputSize();
+        const size_t outputSize = getOutputSize();
+        const size_t depth = layers.size();
+        const kernels::Activation outputActivation = layers.back().activation;
+
+        // Per node index l (0 = input): values in laneCount, and for the layers
+        // after it the activation derivatives and deltas. The output layer
+        // holds logits; scoreLogits() activates them.
+        vector<vector<float>> values(depth + 1), derivatives(depth + 1), deltas(depth + 1);
+        vector<vector<float>> weightGradients(depth), biasGradients(depth);
+        values[0].resize(inputSize * laneCount);
+        for (size_t l = 0; l < depth; ++l)
+        {
+            const size_t n = layers[l].targetCount * laneCount;
+            values[l + 1].resize(n);
+            derivatives[l + 1].resize(n);
+            deltas[l + 1].resize(n);
+            weightGradients[l].resize(layers[l].weights.size());
+            biasGradients[l].resize(layers[l].targetCount);
+        }
+        vector<float> rowScratch(normalizeScratchSize(laneCount, inputSize));
+        vector<float> logits(outputSize), rowDeltas(outputSize);
+
+        const float *inputs = data.featureMatrix().data;
+        const datasets::MatrixView targets = data.targetMatrix();
+        double totalLoss = 0.0;
+
+        for (size_t batchStart = 0; batchStart < data.size(); batchStart += batchSize)
+        {
+            const size_t batchEnd = min(data.size(), batchStart + batchSize);
+            for (size_t l = 0; l < depth; ++l)
+            {
+                fill(weightGradients[l].begin(), weightGradients[l].end(), 0.0f);
+                fill(biasGradients[l].begin(), biasGradients[l].end(), 0.0f);
+            }
+
+            for (size_t first = batchStart; first < batchEnd; first += laneCount)
+            {
+                const size_t count = min(laneCount, batchEnd - first);
+                loadLanes(inputs + first * inputSize, count, rowScratch.data(), values[0].data());
+
+                for (size_t l = 0; l < depth; ++l)
+                {
+                    const SparseLayer &layer = layers[l];
+                    const bool output = l + 1 == depth;
+                    k.sparseForward(values[l].data(), layer.sourceCount, layer.view(), layer.biases.data(),
+                                    layer.targetCount, output ? kernels::Activation::Identity : layer.activation,
+                                    values[l + 1].data(), output ? nullptr : derivatives[l + 1].data());
+                }
+
+                // Unused laneCount keep a zero delta, so they add nothing below.
+                vector<float> &outputDeltas = deltas[depth];
+                fill(outputDeltas.begin(), outputDeltas.end(), 0.0f);
+                for (size_t r = 0; r < count; ++r)
+                {
+                    for (size_t j = 0; j < outputSize; ++j)
+                        logits[j] = values[depth][j * laneCount + r];
+                    totalLoss += scoreLogits(outputActivation, logits.data(), targets.row(first + r), outputSize,
+                                             logits.data(), rowDeltas.data());
+                    for (size_t j = 0; j < outputSize; ++j)
+                        outputDeltas[j * laneCount + r] = rowDeltas[j];
+                }
+
+                for (size_t l = depth; l-- > 0;)
+                {
+                    const SparseLayer &layer = layers[l];
+                    const vector<float> &targetDeltas = deltas[l + 1];
+                    for (size_t j = 0; j < layer.targetCount; ++j)
+                    {
+                        const float *delta = targetDeltas.data() + j * laneCount;
+                        biasGradients[l][j] += accumulate(delta, delta + laneCount, 0.0f);
+                    }
+                    k.sparseBackward(values[l].data(), targetDeltas.data(), layer.sourceCount, layer.view(),
+                                     weightGradients[l].data(), l ? deltas[l].data() : nullptr);
+                    if (l)
+                        k.multiply(derivatives[l].data(), deltas[l].data(), deltas[l].size());
+                }
+            }
+
+            const float step = -learningRate / (batchEnd - batchStart);
+            for (size_t l = 0; l < depth; ++l)
+            {
+                SparseLayer &layer = layers[l];
+                k.axpy(step, weightGradients[l].data(), layer.weights.data(), layer.weights.size());
+                k.axpy(step, biasGradients[l].data(), layer.biases.data(), layer.biases.size());
+            }
+        }
+
+        return data.empty() ? 0.0f : totalLoss / data.size();
+    }
+
+    vector<size_t> SparseNetwork::getLayerSizes() const
+    {
+        vector<size_t> sizes = {layers.front().sourceCount};
+        for (const SparseLayer &layer : layers)
+            sizes.push_back(layer.targetCount);
+        return sizes;
+    }
+
+    size_t SparseNetwork::getEdgeCount() const
+    {
+        size_t edges = 0;
+        for (const SparseLayer &layer : layers)
+            edges += layer.weights.size();
+        return edges;
+    }
+
+    float SparseNetwork::getDensity() const
+    {
+        size_t dense = 0;
+        for (const SparseLayer &layer : layers)
+            dense += layer.sourceCount * layer.targetCount;
+        return dense ? static_cast<float>(getEdgeCount()) / dense : 0.0f;
+    }
+
+    size_t SparseNetwork::getParameterBytes() const
+    {
+        size_t bytes = 0;
+        for (const SparseLayer &layer : layers)
+        {
+            bytes += layer.rowOffsets.size() * sizeof(uint32_t) + layer.targets.size() * sizeof(uint32_t) +
+                     layer.weights.size() * sizeof(float) + layer.biases.size() * sizeof(float);
+        }
+        return bytes;
+    }
+
+    vector<shared_ptr<Edge>> SparseNetwork::getEdgeView(size_t index) const
+    {
+        if (index >= layers.size())
+            throw out_of_range("Layer has no outgoing edges");
+        const SparseLayer &layer = layers[index];
+
+        vector<shared_ptr<Node>> sources;
+        for (size_t i = 0; i < layer.sourceCount; ++i)
+            sources.push_back(make_shared<Node>(0.0f, index ? layers[index - 1].biases[i] : 0.0f));
+        vector<shared_ptr<Node>> targets;
+        for (size_t j = 0; j < layer.targetCount; ++j)
+            targets.push_back(make_shared<Node>(0.0f, layer.biases[j]));
+
+        vector<shared_ptr<Edge>> edges;
+        edges.reserve(layer.weights.size());
+        for (size_t i = 0; i < layer.sourceCount; ++i)
+        {
+            for (uint32_t e = layer.rowOffsets[i]; e < layer.rowOffsets[i + 1]; ++e)
+            {
+                auto edge = make_shared<Edge>(sources[i], targets[layer.targets[e]], layer.weights[e]);
+                edge->paramIndex = static_cast<int>(i * layer.targetCount + layer.targets[e]);
+                edges.push_back(edge);
+            }
+        }
+        return edges;
+    }
+
+    SparsityReport compareAccuracy(const NeuralNetwork &reference, const SparseNetwork &sparse,
+                                   const datasets::Dataset &data)
+    {
+        const CopyDrift drift = measureDrift(reference, sparse.getLayerSizes(),
+                                             [&](const float *inputs, size_t count, float *outputs)
+                                             { sparse.forwardBatch(inputs, count, outputs); },
+                                             data);
+
+        SparsityReport report;
+        report.density = sparse.getDensity();
+        report.sampleCount = drift.sampleCount;
+        report.maxAbsoluteError = drift.maxAbsoluteError;
+        report.meanAbsoluteError = drift.meanAbsoluteError;
+        report.denseLoss = drift.referenceLoss;
+        report.sparseLoss = drift.copyLoss;
+        report.denseBytes = reference.getParameters().size() * sizeof(float);
+        report.sparseBytes = sparse.getParameterBytes();
+        return report;
+    }
+}
@@ -0,0 +1,85 @@
+#include "sweep.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+using namespace neural_network;
+
+namespace training
+{
+    vector<SweepConfiguration> makeGrid(const vector<int> &hiddenLayerCounts, const vector<int> &hiddenLayerSizes,
+                                        const vector<float> &learningRates, const vector<int> &batchSizes)
+    {
+        vector<SweepConfiguration> grid;
+        grid.reserve(hiddenLayerCounts.size() * hiddenLayerSizes.size() * learningRates.size() * batchSizes.size());
+
+        for (int hiddenLayerCount : hiddenLayerCounts)
+            for (int hiddenLayerSize : hiddenLayerSizes)
+                for (float learningRate : learningRates)
+                    for (int batchSize : batchSizes)
+                        grid.push_back({hiddenLayerCount, hiddenLayerSize, learningRate, batchSize});
+        return grid;
+    }
+
+    vector<SweepResult> runSweep(const vector<SweepConfiguration> &configurations,
+                                 const datasets::Dataset &trainingData, const datasets::Dataset &validationData,
+                                 const SweepOptions &options)
+    {
+        for (const SweepConfiguration &configuration : configurations)
+        {
+            if (configuration.hiddenLayerCount < 0 || configuration.hiddenLayerSize <= 0)
+                throw invalid_argument("Invalid network dimensions in sweep");
+            if (configuration.batchSize <= 0)
+                throw invalid_argument("Batch size must be positive");
+        }
+
+        vector<SweepResult> results(configurations.size());
+        if (configurations.empty())
+            return results;
+
+        const size_t threadCount = options.threadCount ? options.threadCount
+                                                       : max(1u, thread::hardware_concurrency());
+        threading::ThreadPool pool(min(threadCount, configurations.size()));
+        pool.run(configurations.size(), [&](size_t r)
+                 {
+                     const SweepConfiguration &configuration = configurations[r];
+                     SweepResult &result = results[r];
+                     result.configuration = configuration;
+
+                     auto network = make_unique<NeuralNetwork>(
+                         trainingData.getFeatureCount(), trainingData.getTargetCount(),
+                         configuration.hiddenLayerCount, configuration.hiddenLayerSize);
+                     if (options.configure)
+                         options.configure(*network, configuration);
+
+                     TrainingOptions trainingOptions = options.training;
+                     trainingOptions.learningRate = configuration.learningRate;
+                     trainingOptions.batchSize = configuration.batchSize;
+                     if (!trainingOptions.checkpointPath.empty())
+                         trainingOptions.checkpointPath += "." + to_string(r);
+                     if (!trainingOptions.statePath.empty())
+                         trainingOptions.statePath += "." + to_string(r);
+
+                     const auto start = chrono::steady_clock::now();
+                     auto elapsed = [&]
+                     { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+                     Trainer trainer(*network, trainingOptions);
+                     trainer.setEpochCallback([&](const EpochReport &report)
+                                              {
+                                                  if (result.epochToTarget < 0 && report.evaluated &&
+                                                      options.targetLoss > 0.0f &&
+                                                      report.validationLoss <= options.targetLoss)
+                                                  {
+                                                      result.epochToTarget = report.epoch;
+                                                      result.secondsToTarget = elapsed();
+                                                  } });
+
+                     result.training = trainer.fit(trainingData, validationData);
+                     result.seconds = elapsed(); });
+
+        return results;
+    }
+}
@@ -0,0 +1,107 @@
+#include "thread_pool.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace threading
+{
+    ThreadPool::ThreadPool(size_t threadCount)
+    {
+        if (threadCount == 0)
+            throw invalid_argument("Thread count must be positive");
+
+        task = nullptr;
+        taskCount = 0;
+        nextTask = 0;
+        pendingTasks = 0;
+        generation = 0;
+        stopping = false;
+
+        workers.reserve(threadCount - 1);
+        for (size_t i = 1; i < threadCount; ++i)
+        {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    void ThreadPool::runTasks(unique_lock<mutex> &guard)
+    {
+        while (nextTask < taskCount)
+        {
+            size_t index = nextTask++;
+            guard.unlock();
+
+            try
+            {
+                (*task)(index);
+            }
+            catch (...)
+            {
+                guard.lock();
+                if (!failure)
+                    failure = current_exception();
+                guard.unlock();
+            }
+
+            guard.lock();
+            if (--pendingTasks == 0)
+                finished.notify_all();
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        unique_lock<mutex> guard(lock);
+        unsigned long seenGeneration = generation;
+
+        while (true)
+        {
+            wake.wait(guard, [&]
+                      { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+
+            seenGeneration = generation;
+            runTasks(guard);
+        }
+    }
+
+    void ThreadPool::run(size_t taskCount, const function<void(size_t)> &task)
+    {
+        if (taskCount == 0)
+            return;
+
+        unique_lock<mutex> guard(lock);
+        this->task = &task;
+        this->taskCount = taskCount;
+        this->nextTask = 0;
+        this->pendingTasks = taskCount;
+        this->failure = nullptr;
+        ++generation;
+        wake.notify_all();
+
+        runTasks(guard);
+        finished.wait(guard, [&]
+                      { return pendingTasks == 0; });
+
+        this->task = nullptr;
+        exception_ptr error = failure;
+        failure = nullptr;
+        guard.unlock();
+
+        if (error)
+            rethrow_exception(error);
+    }
+}
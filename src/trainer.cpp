@@ -0,0 +1,149 @@
+#include "trainer.hpp"
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using namespace neural_network;
+
+namespace training
+{
+    Trainer::Trainer(NeuralNetwork &network, const TrainingOptions &options)
+        : network(network), options(options), context(network.createInferenceContext())
+    {
+        if (options.maxEpochs <= 0)
+            throw invalid_argument("Maximum epoch count must be positive");
+        if (options.batchSize <= 0)
+            throw invalid_argument("Batch size must be positive");
+        if (options.evaluationInterval <= 0)
+            throw invalid_argument("Evaluation interval must be positive");
+        if (options.patience < 0)
+            throw invalid_argument("Patience must not be negative");
+        if (options.stateInterval <= 0)
+            throw invalid_argument("State interval must be positive");
+    }
+
+    float Trainer::evaluate(const datasets::Dataset &data)
+    {
+        if (data.empty())
+            throw invalid_argument("Cannot evaluate an empty dataset");
+        return network.evaluate(context, data).loss;
+    }
+
+    TrainingResult Trainer::fit(const datasets::Dataset &trainingData, const datasets::Dataset &validationData)
+    {
+        datasets::BatchPipeline pipeline(make_unique<datasets::DatasetBatchSource>(
+            trainingData, options.batchSize, options.shuffle, options.seed));
+        return fit(pipeline, validationData);
+    }
+
+    TrainingResult Trainer::fit(datasets::BatchPipeline &trainingData, const datasets::Dataset &validationData)
+    {
+        TrainingResult result;
+        vector<float> bestParameters;
+        int staleEvaluations = 0;
+        int firstEpoch = 0;
+
+        // The best model is saved the same way, so an improving epoch
+        // only pays for the copy.
+        unique_ptr<checkpointing::ModelWriter> modelWriter;
+        vector<unsigned char> modelImage;
+        if (!options.checkpointPath.empty())
+            modelWriter = make_unique<checkpointing::ModelWriter>(options.checkpointPath);
+
+        unique_ptr<checkpointing::CheckpointWriter> stateWriter;
+        checkpointing::TrainingState snapshot;
+        if (!options.statePath.empty())
+        {
+            if (checkpointing::checkpointExists(options.statePath))
+            {
+                snapshot = checkpointing::readCheckpoint(options.statePath);
+                network.restoreTrainingState(snapshot);
+                firstEpoch = snapshot.nextEpoch;
+                result.epochsRun = firstEpoch;
+                result.bestEpoch = snapshot.bestEpoch;
+                result.bestLoss = snapshot.bestLoss;
+                staleEvaluations = snapshot.staleEvaluations;
+                bestParameters = move(snapshot.bestParameters);
+            }
+            stateWriter = make_unique<checkpointing::CheckpointWriter>(options.statePath);
+        }
+
+        // A run that already stopped early stays stopped.
+        const bool exhausted = options.patience > 0 && staleEvaluations >= options.patience;
+        result.stoppedEarly = exhausted && firstEpoch < options.maxEpochs;
+        if (!exhausted && firstEpoch < options.maxEpochs)
+            trainingData.startEpoch(firstEpoch);
+
+        for (int epoch = firstEpoch; epoch < options.maxEpochs && !exhausted; ++epoch)
+        {
+            network.setEpoch(epoch);
+            const float trainingLoss = network.train(trainingData, options.learningRate);
+            result.epochsRun = epoch + 1;
+
+            const bool lastEpoch = epoch + 1 == options.maxEpochs;
+            if (!lastEpoch)
+                trainingData.startEpoch(epoch + 1);
+
+            EpochReport report = {epoch, trainingLoss, false, 0.0f, false, staleEvaluations};
+            if (!validationData.empty() && ((epoch + 1) % options.evaluationInterval == 0 || lastEpoch))
+            {
+                report.evaluated = true;
+                report.validationLoss = evaluate(validationData);
+
+                // A non-finite loss never counts as an improvement.
+                report.improved = isfinite(report.validationLoss) &&
+                                  (result.bestEpoch < 0 || report.validationLoss < result.bestLoss - options.minDelta);
+                if (report.improved)
+                {
+                    result.bestEpoch = epoch;
+                    result.bestLoss = report.validationLoss;
+                    staleEvaluations = 0;
+                    if (options.restoreBest)
+                        bestParameters = network.getParameters();
+                    if (modelWriter)
+                    {
+                        network.saveImage(modelImage);
+                        modelWriter->submit(modelImage);
+                    }
+                }
+                else
+                {
+                    ++staleEvaluations;
+                }
+                report.staleEvaluations = staleEvaluations;
+            }
+
+            result.history.push_back(report);
+            if (epochCallback)
+                epochCallback(report);
+
+            const bool stopping = options.patience > 0 && staleEvaluations >= options.patience;
+            if (stateWriter && ((epoch + 1) % options.stateInterval == 0 || lastEpoch || stopping))
+            {
+                // Only the copy happens here; the writer hands back an idle
+                // buffer set, so this rarely allocates after the first time.
+                network.captureTrainingState(snapshot);
+                snapshot.nextEpoch = epoch + 1;
+                snapshot.bestEpoch = result.bestEpoch;
+                snapshot.bestLoss = result.bestLoss;
+                snapshot.staleEvaluations = staleEvaluations;
+                snapshot.bestParameters.assign(bestParameters.begin(), bestParameters.end());
+                stateWriter->submit(snapshot);
+            }
+
+            if (stopping)
+            {
+                result.stoppedEarly = !lastEpoch;
+                break;
+            }
+        }
+
+        if (modelWriter)
+            modelWriter->flush();
+        if (stateWriter)
+            stateWriter->flush();
+        if (options.restoreBest && !bestParameters.empty())
+            network.setParameters(bestParameters);
+        return result;
+    }
+}
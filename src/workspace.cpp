@@ -0,0 +1,110 @@
+#include "workspace.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace neural_network
+{
+    Workspace::Workspace(const vector<size_t> &layerSizes, bool weightGradients)
+    {
+        size_t total = 0;
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            total += 4 * memory::Arena::paddedSize(layerSizes[l]);
+            if (weightGradients && l + 1 < layerSizes.size())
+                total += memory::Arena::paddedSize(layerSizes[l] * layerSizes[l + 1]);
+        }
+        arena = make_unique<memory::Arena>(total);
+
+        values.reserve(layerSizes.size());
+        derivatives.reserve(layerSizes.size());
+        deltas.reserve(layerSizes.size());
+        biasGradients.reserve(layerSizes.size());
+
+        auto span = [this](size_t count)
+        { return memory::FloatSpan(arena->allocate(count), count); };
+
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            values.push_back(span(layerSizes[l]));
+            derivatives.push_back(span(layerSizes[l]));
+            deltas.push_back(span(layerSizes[l]));
+            biasGradients.push_back(span(layerSizes[l]));
+        }
+        if (weightGradients)
+            allocateGradients();
+    }
+
+    void Workspace::allocateGradients()
+    {
+        if (hasGradients())
+            return;
+
+        // A workspace built without them gets one extra arena block here.
+        for (size_t l = 0; l + 1 < values.size(); ++l)
+        {
+            const size_t count = values[l].size() * values[l + 1].size();
+            weightGradients.push_back(memory::FloatSpan(arena->allocate(count), count));
+        }
+    }
+
+    Workspace::Workspace(const Workspace &other)
+    {
+        *this = other;
+    }
+
+    Workspace &Workspace::operator=(const Workspace &other)
+    {
+        if (this == &other)
+            return *this;
+
+        *this = Workspace(other.getLayerSizes(), other.hasGradients());
+
+        auto copySpans = [](const vector<memory::FloatSpan> &from, vector<memory::FloatSpan> &to)
+        {
+            for (size_t i = 0; i < from.size(); ++i)
+                copy(from[i].begin(), from[i].end(), to[i].begin());
+        };
+        copySpans(other.values, values);
+        copySpans(other.derivatives, derivatives);
+        copySpans(other.deltas, deltas);
+        copySpans(other.weightGradients, weightGradients);
+        copySpans(other.biasGradients, biasGradients);
+        return *this;
+    }
+
+    vector<size_t> Workspace::getLayerSizes() const
+    {
+        vector<size_t> sizes;
+        sizes.reserve(values.size());
+        for (const auto &layer : values)
+            sizes.push_back(layer.size());
+        return sizes;
+    }
+
+    void Workspace::resetGradients()
+    {
+        for (auto &gradients : weightGradients)
+            fill(gradients.begin(), gradients.end(), 0.0f);
+        for (auto &gradients : biasGradients)
+            fill(gradients.begin(), gradients.end(), 0.0f);
+    }
+
+    InferenceContext::InferenceContext(const vector<size_t> &layerSizes)
+        : workspace(layerSizes, false)
+    {
+    }
+
+    bool InferenceContext::matches(const vector<size_t> &layerSizes) const
+    {
+        if (layerSizes.size() != workspace.getLayerCount())
+            return false;
+
+        for (size_t l = 0; l < layerSizes.size(); ++l)
+        {
+            if (workspace.values[l].size() != layerSizes[l])
+                return false;
+        }
+        return true;
+    }
+}
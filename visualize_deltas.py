@@ -12,6 +12,8 @@ import matplotlib.pyplot as plt
 import numpy as np
 import argparse
 
+from scripts.delta_log import DeltaLog, is_delta_log
+
 
 def plot_delta_distribution(df, output_file='delta_distribution.png'):
     """Plota a distribuição dos deltas por camada"""
@@ -185,13 +187,19 @@ def print_statistics(df):
 
 def main():
     parser = argparse.ArgumentParser(description='Visualizar deltas da rede neural')
-    parser.add_argument('--input', default='deltas.csv', help='Arquivo CSV com os deltas')
+    parser.add_argument('--input', default='deltas.bin',
+                        help='Log binário (deltas.bin) ou CSV com os deltas; o log pode ser lido durante o treinamento')
     parser.add_argument('--output-dir', default='.', help='Diretório para salvar os gráficos')
     args = parser.parse_args()
     
     # Carrega dados
     print(f"Carregando dados de: {args.input}")
-    df = pd.read_csv(args.input)
+    if is_delta_log(args.input):
+        log = DeltaLog(args.input)
+        print(f"Log binário ({log.mode}), camadas: {log.layer_sizes}")
+        df = log.to_dataframe()
+    else:
+        df = pd.read_csv(args.input)
     
     print(f"Total de amostras: {len(df)}")
     print(f"Épocas: {df['epoch'].min()} - {df['epoch'].max()}")